@@ -0,0 +1,77 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Bump allocator owned by a compilation. Everything allocated from it is
+// released at once when the arena is destroyed; destructors are never run,
+// so only trivially destructible payloads (or objects whose destructor does
+// nothing that matters) may live here.
+class Arena {
+public:
+    Arena() = default;
+    ~Arena();
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* allocate(size_t size, size_t align) {
+        size_t aligned = (used + align - 1) & ~(align - 1);
+        if (aligned + size > capacity) {
+            return allocateSlow(size, align);
+        }
+        used = aligned + size;
+        bytesUsed += size;
+        return current + aligned;
+    }
+
+    template <typename T, typename... Args>
+    T* make(Args&&... args) {
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    template <typename T>
+    T* copyArray(const T* items, size_t count) {
+        static_assert(std::is_trivially_copyable<T>::value, "arena arrays hold trivial types");
+        if (count == 0) return nullptr;
+        T* result = static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+        std::memcpy(result, items, sizeof(T) * count);
+        return result;
+    }
+
+    std::string_view copyString(std::string_view text) {
+        return std::string_view(copyArray(text.data(), text.size()), text.size());
+    }
+
+    // Takes over all blocks of another arena (e.g. one filled by a worker
+    // thread), leaving it empty
+    void adopt(Arena& other);
+
+    // Bytes handed out to callers, excluding alignment padding
+    size_t getBytesUsed() const { return bytesUsed; }
+
+    // Bytes obtained from the system
+    size_t getBytesReserved() const { return bytesReserved; }
+
+private:
+    static constexpr size_t initialBlockSize = 64 * 1024;
+    static constexpr size_t maxBlockSize = 4 * 1024 * 1024;
+
+    std::vector<char*> blocks;
+    char* current = nullptr;
+    size_t used = 0;
+    size_t capacity = 0;
+    size_t nextBlockSize = initialBlockSize;
+    size_t bytesUsed = 0;
+    size_t bytesReserved = 0;
+
+    void* allocateSlow(size_t size, size_t align);
+};
+
+#endif
@@ -1,94 +1,233 @@
 #ifndef AST_H
 #define AST_H
 
-#include <string>
-#include <vector>
-#include <memory>
+#include "arena.h"
+#include <cstdint>
+#include <string_view>
 
+// AST nodes are allocated from the compilation's Arena and never
+// destroyed individually: the whole tree goes away with the arena. Child
+// lists are fixed arrays in the same arena, and names and string values
+// are views into the source buffer (or the arena), so nothing in a node
+// owns heap memory.
+//
+// Nodes carry a kind tag instead of a vtable. Every concrete class has a
+// classof() so isa/dyn_cast/cast below can test it, and ast_visitor.h
+// dispatches on the tag with a single switch.
 namespace AST {
 
+enum class ExprKind : uint8_t {
+    Number,
+    String,
+    Variable,
+    Binary,
+    Unary,
+    Call,
+    Grouping,
+    Assign,
+    Squad,
+    Index,
+    IndexAssign,
+    Length,
+};
+
+enum class StmtKind : uint8_t {
+    Yap,
+    Sus,
+    Bet,
+    Bruh,
+    Sigma,
+    Cook,
+    ExprStmt,
+    VarDecl,
+    Solulu,
+    Yoink,
+    Yeet,
+};
+
+enum class BinaryOp : uint8_t {
+    Add,
+    Sub,
+    Mul,
+    Div,
+    Mod,
+    Less,
+    LessEqual,
+    Greater,
+    GreaterEqual,
+    Equal,
+    NotEqual,
+    And,
+    Or,
+};
+
+enum class UnaryOp : uint8_t {
+    Negate,
+    Not,
+};
+
+inline const char* spelling(BinaryOp op) {
+    switch (op) {
+        case BinaryOp::Add: return "+";
+        case BinaryOp::Sub: return "-";
+        case BinaryOp::Mul: return "*";
+        case BinaryOp::Div: return "/";
+        case BinaryOp::Mod: return "%";
+        case BinaryOp::Less: return "<";
+        case BinaryOp::LessEqual: return "<=";
+        case BinaryOp::Greater: return ">";
+        case BinaryOp::GreaterEqual: return ">=";
+        case BinaryOp::Equal: return "==";
+        case BinaryOp::NotEqual: return "!=";
+        case BinaryOp::And: return "&&";
+        case BinaryOp::Or: return "||";
+    }
+    return "?";
+}
+
+inline const char* spelling(UnaryOp op) {
+    return op == UnaryOp::Negate ? "-" : "!";
+}
+
+template <typename To, typename From>
+bool isa(const From* node) {
+    return To::classof(node);
+}
+
+template <typename To, typename From>
+To* cast(From* node) {
+    return static_cast<To*>(node);
+}
+
+template <typename To, typename From>
+const To* cast(const From* node) {
+    return static_cast<const To*>(node);
+}
+
+template <typename To, typename From>
+To* dyn_cast(From* node) {
+    return node && To::classof(node) ? static_cast<To*>(node) : nullptr;
+}
+
+template <typename To, typename From>
+const To* dyn_cast(const From* node) {
+    return node && To::classof(node) ? static_cast<const To*>(node) : nullptr;
+}
+
+// Immutable array of child nodes stored in the arena
+template <typename T>
+class NodeList {
+    T* items = nullptr;
+    uint32_t count = 0;
+public:
+    NodeList() = default;
+    NodeList(T* items, size_t count)
+        : items(items), count(static_cast<uint32_t>(count)) {}
+
+    T* begin() const { return items; }
+    T* end() const { return items + count; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    T operator[](size_t i) const { return items[i]; }
+};
+
 // Forward declarations
 class ExprAST;
-using ExprPtr = std::unique_ptr<ExprAST>;
-using ExprList = std::vector<ExprPtr>;
+using ExprPtr = ExprAST*;
+using ExprList = NodeList<ExprPtr>;
 
 // Base class for all expressions
 class ExprAST {
+    ExprKind kind;
+protected:
+    explicit ExprAST(ExprKind kind) : kind(kind) {}
 public:
-    virtual ~ExprAST() = default;
+    ExprKind getKind() const { return kind; }
 };
 
 // Number literal expression
 class NumberExprAST : public ExprAST {
     union {
         double doubleVal;
-        int intVal;
+        int64_t intVal;
     };
     bool isFloat;
 public:
+    static bool classof(const ExprAST* node) { return node->getKind() == ExprKind::Number; }
+
     // Single argument constructors
-    explicit NumberExprAST(double val) : doubleVal(val), isFloat(true) {}
-    explicit NumberExprAST(int val) : intVal(val), isFloat(false) {}
-    
+    explicit NumberExprAST(double val) : ExprAST(ExprKind::Number), doubleVal(val), isFloat(true) {}
+    explicit NumberExprAST(int64_t val) : ExprAST(ExprKind::Number), intVal(val), isFloat(false) {}
+
     // Two argument constructors for explicit type control
-    NumberExprAST(double val, bool isFloat) : doubleVal(val), isFloat(isFloat) {}
-    NumberExprAST(int val, bool isFloat) : intVal(val), isFloat(isFloat) {}
-    
+    NumberExprAST(double val, bool isFloat) : ExprAST(ExprKind::Number), doubleVal(val), isFloat(isFloat) {}
+    NumberExprAST(int64_t val, bool isFloat) : ExprAST(ExprKind::Number), intVal(val), isFloat(isFloat) {}
+
     double getDoubleValue() const { return isFloat ? doubleVal : static_cast<double>(intVal); }
-    int getIntValue() const { return isFloat ? static_cast<int>(doubleVal) : intVal; }
+    int64_t getIntValue() const { return isFloat ? static_cast<int64_t>(doubleVal) : intVal; }
     bool isFloatingPoint() const { return isFloat; }
 };
 
 // String literal expression
 class StringExprAST : public ExprAST {
-    std::string value;
+    std::string_view value;
 public:
-    StringExprAST(const std::string& val) : value(val) {}
-    const std::string& getValue() const { return value; }
+    static bool classof(const ExprAST* node) { return node->getKind() == ExprKind::String; }
+
+    StringExprAST(std::string_view val) : ExprAST(ExprKind::String), value(val) {}
+    std::string_view getValue() const { return value; }
 };
 
 // Variable reference expression
 class VariableExprAST : public ExprAST {
-    std::string name;
+    std::string_view name;
 public:
-    VariableExprAST(const std::string& n) : name(n) {}
-    const std::string& getName() const { return name; }
+    static bool classof(const ExprAST* node) { return node->getKind() == ExprKind::Variable; }
+
+    VariableExprAST(std::string_view n) : ExprAST(ExprKind::Variable), name(n) {}
+    std::string_view getName() const { return name; }
 };
 
 // Binary operation expression
 class BinaryExprAST : public ExprAST {
-    char op;
+    BinaryOp op;
     ExprPtr lhs, rhs;
 public:
-    BinaryExprAST(char op, ExprPtr lhs, ExprPtr rhs)
-        : op(op), lhs(std::move(lhs)), rhs(std::move(rhs)) {}
-    
-    char getOp() const { return op; }
-    const ExprPtr& getLHS() const { return lhs; }
-    const ExprPtr& getRHS() const { return rhs; }
+    static bool classof(const ExprAST* node) { return node->getKind() == ExprKind::Binary; }
+
+    BinaryExprAST(BinaryOp op, ExprPtr lhs, ExprPtr rhs)
+        : ExprAST(ExprKind::Binary), op(op), lhs(lhs), rhs(rhs) {}
+
+    BinaryOp getOp() const { return op; }
+    ExprAST* getLHS() const { return lhs; }
+    ExprAST* getRHS() const { return rhs; }
 };
 
 // Unary operation expression
 class UnaryExprAST : public ExprAST {
-    char op;
+    UnaryOp op;
     ExprPtr operand;
 public:
-    UnaryExprAST(char op, ExprPtr operand)
-        : op(op), operand(std::move(operand)) {}
-    
-    char getOp() const { return op; }
-    const ExprPtr& getOperand() const { return operand; }
+    static bool classof(const ExprAST* node) { return node->getKind() == ExprKind::Unary; }
+
+    UnaryExprAST(UnaryOp op, ExprPtr operand)
+        : ExprAST(ExprKind::Unary), op(op), operand(operand) {}
+
+    UnaryOp getOp() const { return op; }
+    ExprAST* getOperand() const { return operand; }
 };
 
 // Function call expression
 class CallExprAST : public ExprAST {
-    std::string callee;
+    std::string_view callee;
     ExprList args;
 public:
-    CallExprAST(const std::string& callee, ExprList args)
-        : callee(callee), args(std::move(args)) {}
-    
-    const std::string& getCallee() const { return callee; }
+    static bool classof(const ExprAST* node) { return node->getKind() == ExprKind::Call; }
+
+    CallExprAST(std::string_view callee, ExprList args)
+        : ExprAST(ExprKind::Call), callee(callee), args(args) {}
+
+    std::string_view getCallee() const { return callee; }
     const ExprList& getArgs() const { return args; }
 };
 
@@ -96,27 +235,34 @@ public:
 class GroupingExprAST : public ExprAST {
     ExprPtr expression;
 public:
+    static bool classof(const ExprAST* node) { return node->getKind() == ExprKind::Grouping; }
+
     GroupingExprAST(ExprPtr expr)
-        : expression(std::move(expr)) {}
-    
-    const ExprPtr& getExpression() const { return expression; }
+        : ExprAST(ExprKind::Grouping), expression(expr) {}
+
+    ExprAST* getExpression() const { return expression; }
 };
 
 // Base class for all statements
 class StmtAST {
+    StmtKind kind;
+protected:
+    explicit StmtAST(StmtKind kind) : kind(kind) {}
 public:
-    virtual ~StmtAST() = default;
+    StmtKind getKind() const { return kind; }
 };
 
-using StmtPtr = std::unique_ptr<StmtAST>;
-using StmtList = std::vector<StmtPtr>;
+using StmtPtr = StmtAST*;
+using StmtList = NodeList<StmtPtr>;
 
 // Define statement classes
 class YapStmtAST : public StmtAST {
-    std::vector<ExprPtr> args;
+    ExprList args;
 public:
-    YapStmtAST(std::vector<ExprPtr> args) : args(std::move(args)) {}
-    const std::vector<ExprPtr>& getArgs() const { return args; }
+    static bool classof(const StmtAST* node) { return node->getKind() == StmtKind::Yap; }
+
+    YapStmtAST(ExprList args) : StmtAST(StmtKind::Yap), args(args) {}
+    const ExprList& getArgs() const { return args; }
 };
 
 class SusStmtAST : public StmtAST {
@@ -124,12 +270,15 @@ class SusStmtAST : public StmtAST {
     StmtList thenBlock;
     StmtList elseBlock;
 public:
+    static bool classof(const StmtAST* node) { return node->getKind() == StmtKind::Sus; }
+
     SusStmtAST(ExprPtr cond, StmtList thenB, StmtList elseB)
-        : condition(std::move(cond)),
-          thenBlock(std::move(thenB)),
-          elseBlock(std::move(elseB)) {}
-          
-    const ExprPtr& getCondition() const { return condition; }
+        : StmtAST(StmtKind::Sus),
+          condition(cond),
+          thenBlock(thenB),
+          elseBlock(elseB) {}
+
+    ExprAST* getCondition() const { return condition; }
     const StmtList& getThenBlock() const { return thenBlock; }
     const StmtList& getElseBlock() const { return elseBlock; }
 };
@@ -139,67 +288,259 @@ class BetStmtAST : public StmtAST {
     ExprPtr condition;
     StmtPtr increment;
     StmtList body;
+    bool parallel;  // goated bet: iterations may run at the same time
 public:
-    BetStmtAST(StmtPtr init, ExprPtr cond, StmtPtr inc, StmtList body)
-        : init(std::move(init)),
-          condition(std::move(cond)),
-          increment(std::move(inc)),
-          body(std::move(body)) {}
-          
-    const StmtPtr& getInit() const { return init; }
-    const ExprPtr& getCondition() const { return condition; }
-    const StmtPtr& getIncrement() const { return increment; }
+    static bool classof(const StmtAST* node) { return node->getKind() == StmtKind::Bet; }
+
+    BetStmtAST(StmtPtr init, ExprPtr cond, StmtPtr inc, StmtList body, bool parallel = false)
+        : StmtAST(StmtKind::Bet),
+          init(init),
+          condition(cond),
+          increment(inc),
+          body(body),
+          parallel(parallel) {}
+
+    StmtAST* getInit() const { return init; }
+    ExprAST* getCondition() const { return condition; }
+    StmtAST* getIncrement() const { return increment; }
     const StmtList& getBody() const { return body; }
+    bool isParallel() const { return parallel; }
 };
 
 class BruhAST : public StmtAST {
-    std::string name;
-    std::vector<std::string> args;
+    std::string_view name;
+    NodeList<std::string_view> args;
     StmtList body;
 public:
-    BruhAST(const std::string& name, 
-            std::vector<std::string> args,
+    static bool classof(const StmtAST* node) { return node->getKind() == StmtKind::Bruh; }
+
+    BruhAST(std::string_view name,
+            NodeList<std::string_view> args,
             StmtList body)
-        : name(name), args(std::move(args)), body(std::move(body)) {}
+        : StmtAST(StmtKind::Bruh), name(name), args(args), body(body) {}
+
+    std::string_view getName() const { return name; }
+    const NodeList<std::string_view>& getParams() const { return args; }
+    const StmtList& getBody() const { return body; }
+};
+
+// Class declaration: pookie fields and bruh methods, in source order
+class SigmaAST : public StmtAST {
+    std::string_view name;
+    StmtList members;
+public:
+    static bool classof(const StmtAST* node) { return node->getKind() == StmtKind::Sigma; }
+
+    SigmaAST(std::string_view name, StmtList members)
+        : StmtAST(StmtKind::Sigma), name(name), members(members) {}
+
+    std::string_view getName() const { return name; }
+    const StmtList& getMembers() const { return members; }
 };
 
 class CookAST : public StmtAST {
     StmtList body;
 public:
-    CookAST(StmtList body) : body(std::move(body)) {}
+    static bool classof(const StmtAST* node) { return node->getKind() == StmtKind::Cook; }
+
+    CookAST(StmtList body) : StmtAST(StmtKind::Cook), body(body) {}
     const StmtList& getBody() const { return body; }
 };
 
+// Whole translation unit: top-level bruh, sigma and cook declarations in
+// source order. Exactly one of them is the cook block.
+class ProgramAST {
+    StmtList declarations;
+    CookAST* cook;
+public:
+    ProgramAST(StmtList declarations, CookAST* cook)
+        : declarations(declarations), cook(cook) {}
+
+    const StmtList& getDeclarations() const { return declarations; }
+    CookAST* getCook() const { return cook; }
+};
+
 // Expression statement
 class ExprStmtAST : public StmtAST {
     ExprPtr expr;
 public:
-    ExprStmtAST(ExprPtr e) : expr(std::move(e)) {}
-    const ExprPtr& getExpr() const { return expr; }
+    static bool classof(const StmtAST* node) { return node->getKind() == StmtKind::ExprStmt; }
+
+    ExprStmtAST(ExprPtr e) : StmtAST(StmtKind::ExprStmt), expr(e) {}
+    ExprAST* getExpr() const { return expr; }
 };
 
 // Variable declaration statement
 class VarDeclStmtAST : public StmtAST {
-    std::string name;
+    std::string_view name;
     ExprPtr initializer;
 public:
-    VarDeclStmtAST(const std::string& n, ExprPtr init)
-        : name(n), initializer(std::move(init)) {}
-    const std::string& getName() const { return name; }
-    const ExprPtr& getInitializer() const { return initializer; }
+    static bool classof(const StmtAST* node) { return node->getKind() == StmtKind::VarDecl; }
+
+    VarDeclStmtAST(std::string_view n, ExprPtr init)
+        : StmtAST(StmtKind::VarDecl), name(n), initializer(init) {}
+    std::string_view getName() const { return name; }
+    ExprAST* getInitializer() const { return initializer; }
+};
+
+// Return statement: solulu value; or a bare solulu;
+class SoluluStmtAST : public StmtAST {
+    ExprPtr value;
+public:
+    static bool classof(const StmtAST* node) { return node->getKind() == StmtKind::Solulu; }
+
+    SoluluStmtAST(ExprPtr value) : StmtAST(StmtKind::Solulu), value(value) {}
+    ExprAST* getValue() const { return value; }  // Null for a bare solulu
 };
 
 // Assignment expression
 class AssignExprAST : public ExprAST {
-    std::string name;
+    std::string_view name;
+    ExprPtr value;
+public:
+    static bool classof(const ExprAST* node) { return node->getKind() == ExprKind::Assign; }
+
+    AssignExprAST(std::string_view n, ExprPtr val)
+        : ExprAST(ExprKind::Assign), name(n), value(val) {}
+    std::string_view getName() const { return name; }
+    ExprAST* getValue() const { return value; }
+};
+
+// Squad literal: [a, b, c]. squad(n) is a CallExprAST, like a yap call.
+class SquadExprAST : public ExprAST {
+    ExprList elements;
+public:
+    static bool classof(const ExprAST* node) { return node->getKind() == ExprKind::Squad; }
+
+    SquadExprAST(ExprList elements) : ExprAST(ExprKind::Squad), elements(elements) {}
+    const ExprList& getElements() const { return elements; }
+};
+
+// Element of a squad variable: name[index]
+class IndexExprAST : public ExprAST {
+    std::string_view name;
+    ExprPtr index;
+public:
+    static bool classof(const ExprAST* node) { return node->getKind() == ExprKind::Index; }
+
+    IndexExprAST(std::string_view name, ExprPtr index)
+        : ExprAST(ExprKind::Index), name(name), index(index) {}
+    std::string_view getName() const { return name; }
+    ExprAST* getIndex() const { return index; }
+};
+
+// Element assignment: name[index] = value
+class IndexAssignExprAST : public ExprAST {
+    std::string_view name;
+    ExprPtr index;
     ExprPtr value;
 public:
-    AssignExprAST(const std::string& n, ExprPtr val)
-        : name(n), value(std::move(val)) {}
-    const std::string& getName() const { return name; }
-    const ExprPtr& getValue() const { return value; }
+    static bool classof(const ExprAST* node) { return node->getKind() == ExprKind::IndexAssign; }
+
+    IndexAssignExprAST(std::string_view name, ExprPtr index, ExprPtr value)
+        : ExprAST(ExprKind::IndexAssign), name(name), index(index), value(value) {}
+    std::string_view getName() const { return name; }
+    ExprAST* getIndex() const { return index; }
+    ExprAST* getValue() const { return value; }
+};
+
+// Element count of a squad variable: name.length
+class LengthExprAST : public ExprAST {
+    std::string_view name;
+public:
+    static bool classof(const ExprAST* node) { return node->getKind() == ExprKind::Length; }
+
+    LengthExprAST(std::string_view name) : ExprAST(ExprKind::Length), name(name) {}
+    std::string_view getName() const { return name; }
+};
+
+// Insertion: yoink name[index] = value; an index equal to the length appends
+class YoinkStmtAST : public StmtAST {
+    std::string_view name;
+    ExprPtr index;
+    ExprPtr value;
+public:
+    static bool classof(const StmtAST* node) { return node->getKind() == StmtKind::Yoink; }
+
+    YoinkStmtAST(std::string_view name, ExprPtr index, ExprPtr value)
+        : StmtAST(StmtKind::Yoink), name(name), index(index), value(value) {}
+    std::string_view getName() const { return name; }
+    ExprAST* getIndex() const { return index; }
+    ExprAST* getValue() const { return value; }
+};
+
+// Removal: yeet name[index];
+class YeetStmtAST : public StmtAST {
+    std::string_view name;
+    ExprPtr index;
+public:
+    static bool classof(const StmtAST* node) { return node->getKind() == StmtKind::Yeet; }
+
+    YeetStmtAST(std::string_view name, ExprPtr index) : StmtAST(StmtKind::Yeet), name(name), index(index) {}
+    std::string_view getName() const { return name; }
+    ExprAST* getIndex() const { return index; }
+};
+
+// Builder that lets the parser allocate the tree in an arena
+class TreeBuilder {
+    Arena& arena;
+public:
+    using Expr = ExprPtr;
+    using Stmt = StmtPtr;
+    using ExprList = AST::ExprList;
+    using StmtList = AST::StmtList;
+    using NameList = NodeList<std::string_view>;
+    using Root = CookAST*;
+    using Program = ProgramAST*;
+
+    TreeBuilder(Arena& arena) : arena(arena) {}
+
+    static constexpr std::nullptr_t none() { return nullptr; }
+
+    Expr intLiteral(int64_t value) { return arena.make<NumberExprAST>(value); }
+    Expr floatLiteral(double value) { return arena.make<NumberExprAST>(value); }
+    Expr string(std::string_view value) { return arena.make<StringExprAST>(value); }
+    Expr variable(std::string_view name) { return arena.make<VariableExprAST>(name); }
+    Expr binary(BinaryOp op, Expr lhs, Expr rhs) { return arena.make<BinaryExprAST>(op, lhs, rhs); }
+    Expr unary(UnaryOp op, Expr operand) { return arena.make<UnaryExprAST>(op, operand); }
+    Expr grouping(Expr expr) { return arena.make<GroupingExprAST>(expr); }
+    Expr assign(std::string_view name, Expr value) { return arena.make<AssignExprAST>(name, value); }
+    Expr call(std::string_view callee, ExprList args) { return arena.make<CallExprAST>(callee, args); }
+    Expr squad(ExprList elements) { return arena.make<SquadExprAST>(elements); }
+    Expr index(std::string_view name, Expr index) { return arena.make<IndexExprAST>(name, index); }
+    Expr indexAssign(std::string_view name, Expr index, Expr value) {
+        return arena.make<IndexAssignExprAST>(name, index, value);
+    }
+    Expr length(std::string_view name) { return arena.make<LengthExprAST>(name); }
+
+    Stmt yap(ExprList args) { return arena.make<YapStmtAST>(args); }
+    Stmt sus(Expr cond, StmtList thenBlock, StmtList elseBlock) {
+        return arena.make<SusStmtAST>(cond, thenBlock, elseBlock);
+    }
+    Stmt bet(Stmt init, Expr cond, Stmt increment, StmtList body, bool parallel) {
+        return arena.make<BetStmtAST>(init, cond, increment, body, parallel);
+    }
+    Stmt bruh(std::string_view name, NameList params, StmtList body) {
+        return arena.make<BruhAST>(name, params, body);
+    }
+    Stmt exprStmt(Expr expr) { return arena.make<ExprStmtAST>(expr); }
+    Stmt varDecl(std::string_view name, Expr init) { return arena.make<VarDeclStmtAST>(name, init); }
+    Stmt solulu(Expr value) { return arena.make<SoluluStmtAST>(value); }
+    Stmt yoink(std::string_view name, Expr index, Expr value) { return arena.make<YoinkStmtAST>(name, index, value); }
+    Stmt yeet(std::string_view name, Expr index) { return arena.make<YeetStmtAST>(name, index); }
+
+    Stmt sigma(std::string_view name, StmtList members) { return arena.make<SigmaAST>(name, members); }
+
+    Root cook(StmtList body) { return arena.make<CookAST>(body); }
+    Program program(StmtList declarations, Root cook) { return arena.make<ProgramAST>(declarations, cook); }
+
+    ExprList exprList(const Expr* items, size_t count) { return ExprList(arena.copyArray(items, count), count); }
+    StmtList stmtList(const Stmt* items, size_t count) { return StmtList(arena.copyArray(items, count), count); }
+    NameList nameList(const std::string_view* names, size_t count) {
+        return NameList(arena.copyArray(names, count), count);
+    }
 };
 
-} 
+}
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,58 @@
+#ifndef AST_VISITOR_H
+#define AST_VISITOR_H
+
+#include "ast.h"
+
+namespace AST {
+
+// Single dispatch point for passes over the tree. Derived classes provide
+// one visitX(XAST*) method per node kind and reach it through visit();
+// the switch on the node's kind tag replaces a chain of dynamic_casts and
+// is resolved statically, so nothing here is virtual.
+//
+//   class Printer : public AST::Visitor<Printer> { ... };
+template <typename Derived, typename ExprResult = void, typename StmtResult = void>
+class Visitor {
+public:
+    ExprResult visit(ExprAST* expr) {
+        switch (expr->getKind()) {
+            case ExprKind::Number: return derived().visitNumber(cast<NumberExprAST>(expr));
+            case ExprKind::String: return derived().visitString(cast<StringExprAST>(expr));
+            case ExprKind::Variable: return derived().visitVariable(cast<VariableExprAST>(expr));
+            case ExprKind::Binary: return derived().visitBinary(cast<BinaryExprAST>(expr));
+            case ExprKind::Unary: return derived().visitUnary(cast<UnaryExprAST>(expr));
+            case ExprKind::Call: return derived().visitCall(cast<CallExprAST>(expr));
+            case ExprKind::Grouping: return derived().visitGrouping(cast<GroupingExprAST>(expr));
+            case ExprKind::Assign: return derived().visitAssign(cast<AssignExprAST>(expr));
+            case ExprKind::Squad: return derived().visitSquad(cast<SquadExprAST>(expr));
+            case ExprKind::Index: return derived().visitIndex(cast<IndexExprAST>(expr));
+            case ExprKind::IndexAssign: return derived().visitIndexAssign(cast<IndexAssignExprAST>(expr));
+            case ExprKind::Length: return derived().visitLength(cast<LengthExprAST>(expr));
+        }
+        __builtin_unreachable();
+    }
+
+    StmtResult visit(StmtAST* stmt) {
+        switch (stmt->getKind()) {
+            case StmtKind::Yap: return derived().visitYap(cast<YapStmtAST>(stmt));
+            case StmtKind::Sus: return derived().visitSus(cast<SusStmtAST>(stmt));
+            case StmtKind::Bet: return derived().visitBet(cast<BetStmtAST>(stmt));
+            case StmtKind::Bruh: return derived().visitBruh(cast<BruhAST>(stmt));
+            case StmtKind::Sigma: return derived().visitSigma(cast<SigmaAST>(stmt));
+            case StmtKind::Cook: return derived().visitCook(cast<CookAST>(stmt));
+            case StmtKind::ExprStmt: return derived().visitExprStmt(cast<ExprStmtAST>(stmt));
+            case StmtKind::VarDecl: return derived().visitVarDecl(cast<VarDeclStmtAST>(stmt));
+            case StmtKind::Solulu: return derived().visitSolulu(cast<SoluluStmtAST>(stmt));
+            case StmtKind::Yoink: return derived().visitYoink(cast<YoinkStmtAST>(stmt));
+            case StmtKind::Yeet: return derived().visitYeet(cast<YeetStmtAST>(stmt));
+        }
+        __builtin_unreachable();
+    }
+
+private:
+    Derived& derived() { return static_cast<Derived&>(*this); }
+};
+
+}
+
+#endif
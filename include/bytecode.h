@@ -0,0 +1,113 @@
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include "ast.h"
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Instruction set of the bytecode VM (see vm.h). An instruction is an
+// opcode word followed by its operand words, spelled out by the second
+// column: r register, s string, f function, j jump target (code offset).
+// Values are typed statically the way CodeGen types them, so arithmetic
+// and comparisons come in integer (I) and double (D) variants. Truth
+// values are integers 0 or 1.
+//
+// Besides plain comparisons, each comparison has fused forms for the
+// branches of fr and bet: Jump<cmp> and JumpNot<cmp> branch on the result
+// directly, and AddJump<cmp> a b c j does a += b, then jumps if a <cmp> c,
+// which is a whole `i = i + 1, i < n` loop back-edge.
+//
+// Squad registers hold a Squad* (see squad.h); the Squad ops check their
+// index and throw on one out of bounds. String registers hold a word of
+// brainrot_rt.h: LoadString makes one of a string table entry, and the
+// other String ops call the runtime.
+#define BYTECODE_COMPARISON_OPS(X, name)                                  \
+    X(name##I, "rrr") X(name##D, "rrr")                                   \
+    X(Jump##name##I, "rrj") X(Jump##name##D, "rrj")                       \
+    X(JumpNot##name##I, "rrj") X(JumpNot##name##D, "rrj")                 \
+    X(AddJump##name##I, "rrrj") X(AddJump##name##D, "rrrj")
+
+#define BYTECODE_OPS(X)                                                   \
+    X(Move, "rr")                                                         \
+    X(AddI, "rrr") X(SubI, "rrr") X(MulI, "rrr") X(ModI, "rrr")           \
+    X(AddD, "rrr") X(SubD, "rrr") X(MulD, "rrr") X(DivD, "rrr")           \
+    X(ModD, "rrr")                                                        \
+    X(IntToDouble, "rr") X(NegI, "rr") X(NegD, "rr") X(Not, "rr")         \
+    X(IntToBool, "rr") X(DoubleToBool, "rr")                              \
+    BYTECODE_COMPARISON_OPS(X, Lt) BYTECODE_COMPARISON_OPS(X, Le)         \
+    BYTECODE_COMPARISON_OPS(X, Gt) BYTECODE_COMPARISON_OPS(X, Ge)         \
+    BYTECODE_COMPARISON_OPS(X, Eq) BYTECODE_COMPARISON_OPS(X, Ne)         \
+    X(Jump, "j") X(JumpIfTrue, "rj") X(JumpIfFalse, "rj")                 \
+    X(Call, "rfr")         /* dst, function, first argument */            \
+    X(TailCall, "fr")      /* function, first argument */                 \
+    X(Return, "r")                                                        \
+    X(PrintString, "s") X(PrintInt, "r")                                  \
+    X(PrintDouble, "r")    /* %.6f, as yap statements print */            \
+    X(PrintFloat, "r")     /* %f, as yap calls print */                   \
+    X(PrintNewline, "")                                                   \
+    X(TakePrinted, "r")    /* Characters printed since the last one */ \
+    X(NewSquad, "rr")      /* dst, length */                              \
+    X(SquadGet, "rrr")     /* dst, squad, index */                        \
+    X(SquadSet, "rrr")     /* squad, index, value */                      \
+    X(SquadLength, "rr")   /* dst, squad */                               \
+    X(SquadInsert, "rrr")  /* squad, index, value */                      \
+    X(SquadRemove, "rr")   /* squad, index */                             \
+    X(DoubleToInt, "rr")   /* Truncates, for squad indices */             \
+    X(LoadString, "rs")                                                   \
+    X(PrintStr, "r")                                                      \
+    X(ConcatS, "rrr")                                                     \
+    X(IntToString, "rr") X(DoubleToString, "rr")                          \
+    X(CompareS, "rrr")     /* dst = -1, 0 or 1 */                         \
+    X(StringLength, "rr")
+
+enum class Op : uint32_t {
+#define BYTECODE_OP(name, operands) name,
+    BYTECODE_OPS(BYTECODE_OP)
+#undef BYTECODE_OP
+    Count
+};
+
+// Operand kinds of an instruction, one character per operand word
+const char* operandKinds(Op op);
+
+// A function's frame is its registers: parameters and variables first,
+// then constants, then temporaries. A call copies the arguments into the
+// parameters, clears the other variables and copies in the constants.
+// No frame has more than maxRegisters.
+constexpr uint32_t maxRegisters = 1u << 20;
+
+struct BytecodeFunction {
+    std::string name;
+    uint32_t params = 0;
+    uint32_t variables = 0;             // Including the parameters
+    uint32_t registers = 0;
+    uint32_t entry = 0;                 // Offset of the first instruction
+    uint32_t length = 0;                // Code words
+    std::vector<uint64_t> constants;    // Raw bits of int64 or double values
+};
+
+// A compiled program. main (the cook block) is the last function.
+struct Bytecode {
+    std::vector<BytecodeFunction> functions;
+    std::vector<std::string> strings;
+    std::vector<uint32_t> code;
+
+    // Flat binary form for caching. The payload is stored with a checksum,
+    // so deserialize rejects a damaged entry rather than run it, and then
+    // verifies what it read.
+    std::string serialize() const;
+    static std::optional<Bytecode> deserialize(std::string_view data);
+
+    // Checks the structure only: that every operand is in range and every
+    // jump lands on an instruction of its own function. Registers carry
+    // no types, so this cannot tell a number from a squad or a string.
+    bool verify() const;
+};
+
+// Compiles a program to bytecode, reporting the same errors as CodeGen
+Bytecode compileBytecode(AST::ProgramAST* program);
+
+#endif
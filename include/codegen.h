@@ -2,6 +2,9 @@
 #define CODEGEN_H
 
 #include "ast.h"
+#include "ast_visitor.h"
+#include "object_cache.h"
+#include "types.h"
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/Module.h>
@@ -10,27 +13,206 @@
 #include <llvm/IR/Type.h>
 #include <llvm/IR/Verifier.h>
 #include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h>
 #include <llvm/Support/raw_ostream.h>
+#include <llvm/Support/ToolOutputFile.h>
+#include <llvm/Target/TargetMachine.h>
+#include <llvm/IR/PassTimingInfo.h>
+#include <condition_variable>
 #include <memory>
 #include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
 
-class CodeGen {
+// How generated code is optimized before the JIT compiles it
+struct CodeGenOptions {
+    unsigned optLevel = 0;        // -O0 .. -O3
+    bool timePasses = false;      // Report time spent in each pass on stderr
+    std::string remarksFile;      // YAML optimization remarks, if not empty
+    std::string cacheDir;         // Reuse compiled objects across runs, if not empty
+    uint64_t cacheMaxBytes = 256ull << 20;
+    bool lazy = false;            // Compile each function on its first call
+    bool speculate = false;       // Lazy, plus compile callees in the background
+};
+
+// File formats the ahead-of-time path can write
+enum class OutputKind {
+    Object,     // Native object file
+    Assembly,   // Target assembly
+    LLVMIR      // Textual LLVM IR
+};
+
+class CodeGen : private AST::Visitor<CodeGen, llvm::Value*, void> {
 public:
-    CodeGen();
-    void generateCode(AST::CookAST* ast);
+    explicit CodeGen(const CodeGenOptions& options = {});
+    ~CodeGen();
+    void generateCode(AST::ProgramAST* program);
     void executeCode();
+    // Runs the program straight from the object cache, before anything is
+    // parsed. Returns false on a miss; executeCode then fills the cache.
+    bool executeCached(std::string_view source);
+    // Writes the module to path ("-" is stdout) instead of running it
+    bool emitFile(const std::string& path, OutputKind kind);
+
+    // Tiered execution (see interpreter.h): compile pieces of a program the
+    // interpreter is running, each into a fresh module of this JIT. Function
+    // entries take their arguments as an array. Loop entries take the
+    // interpreter's variable slots and return 1 if the loop hit a solulu,
+    // whose value is left in the slot after the variables. Values are
+    // passed as cells typed by the program's ProgramTypes: the bits of an
+    // integer or double, a truth value as 0 or 1, a string word or a Squad
+    // pointer.
+    using TierCell = uint64_t;
+    using TierFunction = TierCell (*)(const TierCell* args);
+    using TierLoop = int32_t (*)(TierCell* slots);
+    // One entry per function, or none if compiling failed
+    std::vector<TierFunction> compileFunctions(const ProgramTypes& types,
+                                               const std::vector<AST::BruhAST*>& bruhs);
+    TierLoop compileLoop(const ProgramTypes& types, const FunctionTypes& owner,
+                         const std::vector<AST::BruhAST*>& callees, AST::BetStmtAST* loop,
+                         const std::vector<std::string_view>& slots);
 
 private:
+    CodeGenOptions options;
+    std::unique_ptr<llvm::ToolOutputFile> remarksOutput;
+    std::unique_ptr<llvm::TimePassesHandler> passTimer;
+    std::optional<llvm::orc::JITTargetMachineBuilder> targetBuilder;
+    std::unique_ptr<llvm::TargetMachine> targetMachine;  // Optimizer cost models, object files
+    std::unique_ptr<DiskObjectCache> objectCache;  // Outlives the JIT that uses it
     std::unique_ptr<llvm::LLVMContext> context;
     std::unique_ptr<llvm::Module> module;
     std::unique_ptr<llvm::IRBuilder<>> builder;
     std::unique_ptr<llvm::orc::LLJIT> jit;
-    std::map<std::string, llvm::AllocaInst*> namedValues;
+    // Variables in scope: an alloca slot, or an SSA value for parameters
+    // the function never assigns to
+    std::map<std::string, llvm::Value*, std::less<>> namedValues;
+    std::map<std::string, llvm::Function*, std::less<>> functions;
+    // Inferred types of the program, and of the function being generated
+    ProgramTypes programTypes;
+    const ProgramTypes* types = nullptr;
+    const FunctionTypes* currentTypes = nullptr;
+
+    // The layout of squad.h's Squad, and while generating the unchecked
+    // version of a loop (see emitVersionedLoop), the squads it indexes:
+    // their data and length, loaded before the loop, and the counters
+    // known to index them in bounds
+    llvm::StructType* squadType = nullptr;
+    struct HoistedSquad {
+        llvm::Value* data = nullptr;
+        llvm::Value* length = nullptr;
+        std::vector<std::string_view> counters;
+    };
+    std::map<std::string, HoistedSquad, std::less<>> hoistedSquads;
+
+    // Strings are brainrot_rt.h's words, wrapped in a struct of their own
+    // so they keep apart from integers; and the module's literals, one
+    // constant per text
+    llvm::StructType* stringType = nullptr;
+    std::map<std::string, llvm::Constant*, std::less<>> stringPool;
 
+    // --speculate: callees waiting to be compiled in the background
+    std::thread speculationThread;
+    std::mutex speculationMutex;
+    std::condition_variable speculationReady;
+    std::vector<llvm::orc::SymbolStringPtr> speculationQueue;
+    bool stopSpeculating = false;
+
+    // Tiered execution: modules compiled so far, and while compiling a loop
+    // entry, the interpreter's slots it reads and writes
+    unsigned tierModules = 0;
+    llvm::Value* osrFrame = nullptr;
+    const std::vector<std::string_view>* osrSlots = nullptr;
+
+    bool createJIT();
+    void runMain();
     llvm::Function* createPrintFunction();
-    void generateStmt(AST::StmtAST* stmt);
-    llvm::Value* generateExpr(AST::ExprAST* expr);
+    void optimizeModule(llvm::Module& module);
+    void speculateCallees(llvm::Module& module);
+    void speculationLoop();
+    void declareRuntime();
+    void startTierModule(const std::string& name);
+    bool addTierModule();
+    void storeFrame();
+    llvm::Value* loadCell(llvm::Value* cells, size_t index, llvm::Type* type);
+    void storeCell(llvm::Value* cells, size_t index, llvm::Value* value);
+    llvm::Value* toCell(llvm::Value* value);
+    void emitLoop(AST::BetStmtAST* stmt);
+    bool emitVersionedLoop(AST::BetStmtAST* stmt);
+    void emitParallelLoop(AST::BetStmtAST* stmt);
+    void generateStmt(AST::StmtAST* stmt) { visit(stmt); }
+    llvm::Value* generateExpr(AST::ExprAST* expr) { return visit(expr); }
     llvm::Value* getFormatString(llvm::Value* exprValue);
+    // One argument of yap: a value to format, or literal text
+    struct PrintPiece {
+        llvm::Value* value = nullptr;
+        std::string_view text;
+    };
+    llvm::Value* emitPrint(const std::vector<PrintPiece>& pieces);
+    llvm::Value* toBool(llvm::Value* value);
+    llvm::Value* toDouble(llvm::Value* value);
+    llvm::Type* typeOf(ValueType type);
+    llvm::Value* convert(llvm::Value* value, llvm::Type* type);
+    llvm::Value* toExitCode(llvm::Value* value);
+    llvm::Value* defaultValue(llvm::Type* type);
+    static bool isSquadValue(llvm::Value* value);
+    bool isString(llvm::Value* value) const { return value->getType() == stringType; }
+    void requireNumber(llvm::Value* value);
+    llvm::Value* toIndex(llvm::Value* value);
+    llvm::Constant* stringConstant(std::string_view text);
+    llvm::Value* toStringWord(llvm::Value* value);
+    llvm::Value* fromStringWord(llvm::Value* word);
+    llvm::Value* generateStringBinary(AST::BinaryOp op, llvm::Value* L, llvm::Value* R);
+    llvm::Value* generateRemainder(llvm::Value* L, llvm::Value* R);
+    llvm::Function* failHelper(const char* name, const char* message);
+
+    // Squads: loads, the checked element address, and the helpers in the
+    // module that allocate, resize and report errors
+    llvm::Value* loadVariable(std::string_view name);
+    llvm::Value* loadSquad(std::string_view name);
+    llvm::Value* loadSquadField(llvm::Value* squad, unsigned field);
+    llvm::Value* squadElement(std::string_view name, AST::ExprAST* indexExpr, llvm::Value* index);
+    llvm::Function* createHelper(const char* name, llvm::Type* result, llvm::ArrayRef<llvm::Type*> params);
+    llvm::Function* squadNew();
+    llvm::Function* squadInsert();
+    llvm::Function* squadRemove();
+    llvm::Function* squadFail();
+    void declareFunction(AST::BruhAST* bruh);
+    void generateFunction(AST::BruhAST* bruh);
+    llvm::Value* generateLogical(AST::BinaryExprAST* expr);
+
+    // Per-node code generation, dispatched by AST::Visitor
+    friend class AST::Visitor<CodeGen, llvm::Value*, void>;
+    llvm::Value* visitNumber(AST::NumberExprAST* expr);
+    llvm::Value* visitString(AST::StringExprAST* expr);
+    llvm::Value* visitVariable(AST::VariableExprAST* expr);
+    llvm::Value* visitBinary(AST::BinaryExprAST* expr);
+    llvm::Value* visitUnary(AST::UnaryExprAST* expr);
+    llvm::Value* visitCall(AST::CallExprAST* expr);
+    llvm::Value* visitGrouping(AST::GroupingExprAST* expr);
+    llvm::Value* visitAssign(AST::AssignExprAST* expr);
+    llvm::Value* visitSquad(AST::SquadExprAST* expr);
+    llvm::Value* visitIndex(AST::IndexExprAST* expr);
+    llvm::Value* visitIndexAssign(AST::IndexAssignExprAST* expr);
+    llvm::Value* visitLength(AST::LengthExprAST* expr);
+
+    void visitYap(AST::YapStmtAST* stmt);
+    void visitSus(AST::SusStmtAST* stmt);
+    void visitBet(AST::BetStmtAST* stmt);
+    void visitBruh(AST::BruhAST* stmt);
+    void visitSigma(AST::SigmaAST* stmt);
+    void visitCook(AST::CookAST* stmt);
+    void visitExprStmt(AST::ExprStmtAST* stmt);
+    void visitVarDecl(AST::VarDeclStmtAST* stmt);
+    void visitSolulu(AST::SoluluStmtAST* stmt);
+    void visitYoink(AST::YoinkStmtAST* stmt);
+    void visitYeet(AST::YeetStmtAST* stmt);
 };
 
+// Links an object file into an executable with the system compiler driver
+bool linkExecutable(const std::string& objectPath, const std::string& outputPath);
+
 #endif
\ No newline at end of file
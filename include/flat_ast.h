@@ -0,0 +1,181 @@
+#ifndef FLAT_AST_H
+#define FLAT_AST_H
+
+#include "ast.h"
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Data-oriented alternative to the pointer-linked AST in ast.h. Nodes live
+// in contiguous arrays and refer to each other by 32-bit index; literals,
+// names and child lists live in side tables. Children are always created
+// before their parents, so walking the node array front to back visits the
+// tree in post-order without chasing a single pointer, and every table is
+// plain data that can be written out and read back byte for byte.
+namespace AST {
+
+using NodeIndex = uint32_t;
+constexpr NodeIndex noNode = UINT32_MAX;
+
+enum class FlatKind : uint8_t {
+    // Expressions
+    IntLiteral,    // a = int pool index
+    FloatLiteral,  // a = float pool index
+    String,        // a = string pool index
+    Variable,      // a = name (string pool index)
+    Binary,        // a = BinaryOp, b = lhs, c = rhs
+    Unary,         // a = UnaryOp, b = operand
+    Grouping,      // a = expression
+    Assign,        // a = name, b = value
+    Call,          // a = callee name, b = argument list
+    Squad,         // a = element list
+    Index,         // a = name, b = index
+    IndexAssign,   // a = name, b = index, c = value
+    Length,        // a = name
+
+    // Statements
+    Yap,           // a = argument list
+    Sus,           // a = condition, b = then list, c = else list
+    Bet,           // a = init, b = condition, c = increment, d = body list
+    GoatedBet,     // As Bet
+    Bruh,          // a = name, b = parameter name list, c = body list
+    Sigma,         // a = name, b = member list
+    ExprStmt,      // a = expression
+    VarDecl,       // a = name, b = initializer
+    Solulu,        // a = value, or noNode for a bare solulu
+    Yoink,         // a = name, b = index, c = value
+    Yeet,          // a = name, b = index
+    Cook,          // a = body list
+    Program,       // a = declaration list, b = cook
+};
+
+// Operands of one node; their meaning depends on the node's kind
+struct FlatNode {
+    uint32_t a = noNode;
+    uint32_t b = noNode;
+    uint32_t c = noNode;
+    uint32_t d = noNode;
+};
+
+class FlatAST {
+public:
+    // Node arrays, indexed by NodeIndex
+    std::vector<FlatKind> kinds;
+    std::vector<FlatNode> nodes;
+
+    // Side tables
+    std::vector<int64_t> ints;
+    std::vector<double> floats;
+    std::vector<uint32_t> stringOffsets;  // Into stringData
+    std::vector<uint32_t> stringLengths;
+    std::string stringData;
+
+    // Child lists: a list index points at a count followed by that many
+    // node (or, for parameter lists, string) indices
+    std::vector<uint32_t> lists;
+
+    NodeIndex root = noNode;
+
+    size_t size() const { return kinds.size(); }
+    FlatKind kind(NodeIndex node) const { return kinds[node]; }
+    const FlatNode& operator[](NodeIndex node) const { return nodes[node]; }
+
+    std::string_view string(uint32_t index) const {
+        return std::string_view(stringData).substr(stringOffsets[index], stringLengths[index]);
+    }
+
+    uint32_t listSize(uint32_t list) const { return lists[list]; }
+    const uint32_t* listItems(uint32_t list) const { return lists.data() + list + 1; }
+
+    NodeIndex add(FlatKind kind, FlatNode node);
+    uint32_t addInt(int64_t value);
+    uint32_t addFloat(double value);
+    uint32_t addList(const uint32_t* items, size_t count);
+
+    // Interns a string, returning the index of an existing equal entry
+    uint32_t addString(std::string_view text);
+
+    // Bytes held by all tables
+    size_t memoryUsage() const;
+
+    // Binary round trip of every table
+    void serialize(std::ostream& out) const;
+    static FlatAST deserialize(std::istream& in);
+
+    // One line per node, in array order
+    void dump(std::ostream& out) const;
+
+private:
+    std::unordered_map<std::string_view, uint32_t> internedStrings;
+};
+
+// Builder that lets the parser emit a FlatAST directly
+class FlatBuilder {
+    FlatAST& ast;
+public:
+    using Expr = NodeIndex;
+    using Stmt = NodeIndex;
+    using ExprList = uint32_t;
+    using StmtList = uint32_t;
+    using NameList = uint32_t;
+    using Root = NodeIndex;
+    using Program = NodeIndex;
+
+    FlatBuilder(FlatAST& ast) : ast(ast) {}
+
+    static constexpr NodeIndex none() { return noNode; }
+
+    Expr intLiteral(int64_t value) { return ast.add(FlatKind::IntLiteral, {ast.addInt(value)}); }
+    Expr floatLiteral(double value) { return ast.add(FlatKind::FloatLiteral, {ast.addFloat(value)}); }
+    Expr string(std::string_view value) { return ast.add(FlatKind::String, {ast.addString(value)}); }
+    Expr variable(std::string_view name) { return ast.add(FlatKind::Variable, {ast.addString(name)}); }
+    Expr binary(BinaryOp op, Expr lhs, Expr rhs) { return ast.add(FlatKind::Binary, {uint32_t(op), lhs, rhs}); }
+    Expr unary(UnaryOp op, Expr operand) { return ast.add(FlatKind::Unary, {uint32_t(op), operand}); }
+    Expr grouping(Expr expr) { return ast.add(FlatKind::Grouping, {expr}); }
+    Expr assign(std::string_view name, Expr value) { return ast.add(FlatKind::Assign, {ast.addString(name), value}); }
+    Expr call(std::string_view callee, ExprList args) { return ast.add(FlatKind::Call, {ast.addString(callee), args}); }
+    Expr squad(ExprList elements) { return ast.add(FlatKind::Squad, {elements}); }
+    Expr index(std::string_view name, Expr index) { return ast.add(FlatKind::Index, {ast.addString(name), index}); }
+    Expr indexAssign(std::string_view name, Expr index, Expr value) {
+        return ast.add(FlatKind::IndexAssign, {ast.addString(name), index, value});
+    }
+    Expr length(std::string_view name) { return ast.add(FlatKind::Length, {ast.addString(name)}); }
+
+    Stmt yap(ExprList args) { return ast.add(FlatKind::Yap, {args}); }
+    Stmt sus(Expr cond, StmtList thenBlock, StmtList elseBlock) {
+        return ast.add(FlatKind::Sus, {cond, thenBlock, elseBlock});
+    }
+    Stmt bet(Stmt init, Expr cond, Stmt increment, StmtList body, bool parallel) {
+        return ast.add(parallel ? FlatKind::GoatedBet : FlatKind::Bet, {init, cond, increment, body});
+    }
+    Stmt bruh(std::string_view name, NameList params, StmtList body) {
+        return ast.add(FlatKind::Bruh, {ast.addString(name), params, body});
+    }
+    Stmt exprStmt(Expr expr) { return ast.add(FlatKind::ExprStmt, {expr}); }
+    Stmt varDecl(std::string_view name, Expr init) { return ast.add(FlatKind::VarDecl, {ast.addString(name), init}); }
+    Stmt solulu(Expr value) { return ast.add(FlatKind::Solulu, {value}); }
+    Stmt yoink(std::string_view name, Expr index, Expr value) {
+        return ast.add(FlatKind::Yoink, {ast.addString(name), index, value});
+    }
+    Stmt yeet(std::string_view name, Expr index) { return ast.add(FlatKind::Yeet, {ast.addString(name), index}); }
+
+    Stmt sigma(std::string_view name, StmtList members) {
+        return ast.add(FlatKind::Sigma, {ast.addString(name), members});
+    }
+
+    Root cook(StmtList body) { return ast.root = ast.add(FlatKind::Cook, {body}); }
+    Program program(StmtList declarations, Root cook) {
+        return ast.root = ast.add(FlatKind::Program, {declarations, cook});
+    }
+
+    ExprList exprList(const Expr* items, size_t count) { return ast.addList(items, count); }
+    StmtList stmtList(const Stmt* items, size_t count) { return ast.addList(items, count); }
+    NameList nameList(const std::string_view* names, size_t count);
+};
+
+}
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef FOLD_H
+#define FOLD_H
+
+#include "arena.h"
+#include "ast.h"
+#include <cstddef>
+
+// What foldConstants removed, for --stats
+struct FoldStats {
+    size_t nodes = 0;     // Operators and groupings replaced by their value
+    size_t branches = 0;  // sus statements whose condition is constant
+    size_t loops = 0;     // bet loops that never run their body
+};
+
+// Simplifies the tree between parsing and code generation, so every
+// backend starts from less of it:
+// - arithmetic, comparisons and logic on literals become literals,
+//   computed exactly as CodeGen's instructions would;
+// - a sus with a constant condition is replaced by the branch it takes;
+// - a bet whose condition is false on entry keeps only its initializer.
+// Operations CodeGen rejects or whose result depends on the target, like
+// a remainder by zero, are left for it to report. The original nodes stay
+// in the arena; unchanged subtrees are shared with the new tree.
+AST::ProgramAST* foldConstants(AST::ProgramAST* program, Arena& arena, FoldStats& stats);
+
+#endif
@@ -0,0 +1,179 @@
+#ifndef INTERPRETER_H
+#define INTERPRETER_H
+
+#include "ast.h"
+#include "ast_visitor.h"
+#include "codegen.h"
+#include "squad.h"
+#include "types.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// A value while the interpreter evaluates an expression. The types mirror
+// what CodeGen produces: i64, double, i1, string words and squad pointers.
+// Variables, arguments and return values have the types inferTypes gives
+// them and are kept as CodeGen::TierCells, which compiled code reads
+// directly.
+struct RuntimeValue {
+    enum class Type : uint8_t { Int, Double, Bool, String, Squad };
+    Type type;
+    union {
+        int64_t intValue;
+        double doubleValue;
+        bool boolValue;
+        uint64_t stringValue;  // See brainrot_rt.h
+        Squad* squadValue;
+    };
+
+    static RuntimeValue ofInt(int64_t value) { RuntimeValue v{Type::Int, {}}; v.intValue = value; return v; }
+    static RuntimeValue ofDouble(double value) { RuntimeValue v{Type::Double, {}}; v.doubleValue = value; return v; }
+    static RuntimeValue ofBool(bool value) { RuntimeValue v{Type::Bool, {}}; v.boolValue = value; return v; }
+    static RuntimeValue ofSquad(Squad* value) { RuntimeValue v{Type::Squad, {}}; v.squadValue = value; return v; }
+    static RuntimeValue ofString(uint64_t value) { RuntimeValue v{Type::String, {}}; v.stringValue = value; return v; }
+};
+
+// Whether a statement finished normally or ran a solulu
+enum class Completion : uint8_t { Normal, Return };
+
+// Tiered execution. The program starts at once in a tree-walking
+// interpreter, without waiting for LLVM. Calls to each function and
+// back-edges of each bet loop are counted; once one is hot, a background
+// thread compiles it with CodeGen. Later calls to a compiled function go
+// straight to native code, and a loop that is running switches to its
+// compiled version at the next loop header (on-stack replacement): the
+// compiled loop works on the interpreter's variable slots and returns to
+// the interpreter when the loop ends.
+class Interpreter : private AST::Visitor<Interpreter, RuntimeValue, Completion> {
+public:
+    // Calls or loop iterations after which code is compiled
+    static constexpr uint32_t hotCalls = 100;
+    static constexpr uint32_t hotIterations = 1000;
+    // Interpreted calls nested deeper than this wait for native code
+    // instead, which tail-calls and keeps the C++ stack small
+    static constexpr uint32_t maxInterpretedDepth = 1000;
+
+    // Checks the program as CodeGen would, throwing the same errors
+    Interpreter(AST::ProgramAST* program, const CodeGenOptions& options);
+    ~Interpreter();
+
+    // Runs cook and returns its exit code
+    int run();
+
+    unsigned compiledFunctions() const { return functionsCompiled; }
+    unsigned compiledLoops() const { return loopsCompiled; }
+
+private:
+    // A bruh function, or cook: its variables and tier-up state
+    struct FunctionInfo {
+        AST::BruhAST* bruh = nullptr;              // Null for cook
+        const AST::StmtList* body = nullptr;
+        const FunctionTypes* types = nullptr;
+        std::vector<std::string_view> slotNames;   // One slot per variable name
+        std::vector<ValueType> slotTypes;
+        std::unordered_map<std::string_view, uint32_t> slots;
+        std::vector<uint32_t> paramSlots;
+        std::vector<uint32_t> callees;             // Indices into functions
+        uint32_t calls = 0;
+        bool queued = false;
+        std::atomic<CodeGen::TierFunction> native{nullptr};
+    };
+
+    struct LoopInfo {
+        uint32_t owner = 0;                        // Function holding the loop
+        std::vector<uint32_t> callees;
+        uint32_t iterations = 0;
+        bool queued = false;
+        std::atomic<CodeGen::TierLoop> native{nullptr};
+    };
+
+    // Compile request: a function and what it calls, or one loop
+    struct Job {
+        uint32_t function;
+        AST::BetStmtAST* loop;
+    };
+
+    class Resolver;
+    friend class Resolver;
+
+    CodeGenOptions options;              // For the background compiles
+    ProgramTypes types;
+    std::deque<FunctionInfo> functions;            // Cook is the last one
+    std::unordered_map<std::string_view, uint32_t> functionIndex;
+    std::unordered_map<AST::BetStmtAST*, LoopInfo> loops;
+    // The word of each string literal; equal text shares one, as in CodeGen
+    std::unordered_map<const AST::StringExprAST*, uint64_t> literals;
+
+    // Running state
+    FunctionInfo* current = nullptr;
+    CodeGen::TierCell* frame = nullptr;
+    RuntimeValue returnValue = RuntimeValue::ofInt(0);
+    uint32_t depth = 0;
+
+    // Background compiler; only the compile thread touches the CodeGen
+    std::unique_ptr<CodeGen> compiler;
+    std::thread compileThread;
+    std::mutex compileMutex;
+    std::condition_variable jobReady;
+    std::condition_variable jobDone;
+    std::deque<Job> jobs;
+    bool compiling = false;
+    bool stopCompiling = false;
+    std::atomic<unsigned> functionsCompiled{0};
+    std::atomic<unsigned> loopsCompiled{0};
+
+    void queueJob(Job job);
+    void waitForCompiles();
+    void compileJobs();
+    void compileJob(const Job& job);
+    std::vector<uint32_t> reachableFunctions(const std::vector<uint32_t>& roots) const;
+
+    Completion runBody(const AST::StmtList& body);
+    RuntimeValue callFunction(uint32_t index, AST::CallExprAST* call);
+    static void requireNumber(const RuntimeValue& value);
+    static double toDouble(const RuntimeValue& value);
+    static bool toBool(const RuntimeValue& value);
+    static int64_t toIndex(const RuntimeValue& value);
+    static RuntimeValue defaultValue(ValueType type);
+    static uint64_t toStringWord(const RuntimeValue& value);
+    static RuntimeValue stringBinary(AST::BinaryOp op, const RuntimeValue& L, const RuntimeValue& R);
+    Squad* squadIn(std::string_view name) const;
+    static CodeGen::TierCell toCell(const RuntimeValue& value, ValueType type);
+    static RuntimeValue fromCell(CodeGen::TierCell cell, ValueType type);
+
+    // Per-node evaluation, dispatched by AST::Visitor
+    friend class AST::Visitor<Interpreter, RuntimeValue, Completion>;
+    RuntimeValue visitNumber(AST::NumberExprAST* expr);
+    RuntimeValue visitString(AST::StringExprAST* expr);
+    RuntimeValue visitVariable(AST::VariableExprAST* expr);
+    RuntimeValue visitBinary(AST::BinaryExprAST* expr);
+    RuntimeValue visitUnary(AST::UnaryExprAST* expr);
+    RuntimeValue visitCall(AST::CallExprAST* expr);
+    RuntimeValue visitGrouping(AST::GroupingExprAST* expr);
+    RuntimeValue visitAssign(AST::AssignExprAST* expr);
+    RuntimeValue visitSquad(AST::SquadExprAST* expr);
+    RuntimeValue visitIndex(AST::IndexExprAST* expr);
+    RuntimeValue visitIndexAssign(AST::IndexAssignExprAST* expr);
+    RuntimeValue visitLength(AST::LengthExprAST* expr);
+
+    Completion visitYap(AST::YapStmtAST* stmt);
+    Completion visitSus(AST::SusStmtAST* stmt);
+    Completion visitBet(AST::BetStmtAST* stmt);
+    Completion visitBruh(AST::BruhAST* stmt);
+    Completion visitSigma(AST::SigmaAST* stmt);
+    Completion visitCook(AST::CookAST* stmt);
+    Completion visitExprStmt(AST::ExprStmtAST* stmt);
+    Completion visitVarDecl(AST::VarDeclStmtAST* stmt);
+    Completion visitSolulu(AST::SoluluStmtAST* stmt);
+    Completion visitYoink(AST::YoinkStmtAST* stmt);
+    Completion visitYeet(AST::YeetStmtAST* stmt);
+};
+
+#endif
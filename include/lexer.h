@@ -1,9 +1,11 @@
 #pragma once
 
+#include "scan.h"
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <iostream>
-#include <unordered_map>
 
 enum TokenType {
     // Keywords
@@ -41,6 +43,7 @@ enum TokenType {
     TOK_SEMICOLON,     // ;
     TOK_SLASH,         // /
     TOK_STAR,          // *
+    TOK_PERCENT,       // %
     TOK_BANG,          // !
     TOK_EQUAL,         // =
     TOK_LESS,          // <
@@ -51,6 +54,13 @@ enum TokenType {
     TOK_EQUAL_EQUAL,    // ==
     TOK_LESS_EQUAL,     // <=
     TOK_GREATER_EQUAL,  // >=
+    TOK_AND_AND,        // &&
+    TOK_OR_OR,          // ||
+    TOK_PLUS_EQUAL,     // +=
+    TOK_MINUS_EQUAL,    // -=
+    TOK_STAR_EQUAL,     // *=
+    TOK_SLASH_EQUAL,    // /=
+    TOK_PERCENT_EQUAL,  // %=
 
     // Literals
     TOK_IDENTIFIER,
@@ -60,33 +70,127 @@ enum TokenType {
     TOK_EOF
 };
 
+// Decoded value of a number literal, selected by Token::isFloat
+union NumberValue {
+    int64_t intValue;
+    double floatValue;
+};
+
+// Compact token: the lexeme is a slice of the source buffer, not a copy
 struct Token {
     TokenType type;
-    std::string lexeme;
+    uint32_t offset;
+    uint32_t length;
     bool isFloat = false;
-    
-    Token(TokenType type, std::string lexeme, bool isFloat = false)
-        : type(type), lexeme(std::move(lexeme)), isFloat(isFloat) {}
+    NumberValue value = {0};  // Only meaningful for TOK_NUMBER_LITERAL
+
+    std::string_view lexeme(std::string_view source) const {
+        return source.substr(offset, length);
+    }
+};
+
+// Struct-of-arrays token storage. Each token costs eighteen bytes and no
+// heap allocation of its own; lexemes are materialized on demand from the
+// source buffer, which must outlive the buffer.
+class TokenBuffer {
+public:
+    explicit TokenBuffer(std::string_view source = {}) : src(source) {}
+
+    void reserve(size_t count) {
+        types.reserve(count);
+        offsets.reserve(count);
+        lengths.reserve(count);
+        floatFlags.reserve(count);
+        values.reserve(count);
+    }
+
+    // Appends all tokens of another buffer over the same source
+    void append(const TokenBuffer& other) {
+        types.insert(types.end(), other.types.begin(), other.types.end());
+        offsets.insert(offsets.end(), other.offsets.begin(), other.offsets.end());
+        lengths.insert(lengths.end(), other.lengths.begin(), other.lengths.end());
+        floatFlags.insert(floatFlags.end(), other.floatFlags.begin(), other.floatFlags.end());
+        values.insert(values.end(), other.values.begin(), other.values.end());
+    }
+
+    void push(const Token& token) {
+        push(token.type, token.offset, token.length, token.isFloat, token.value);
+    }
+
+    void push(TokenType type, size_t offset, size_t length, bool isFloat = false,
+              NumberValue value = {0}) {
+        types.push_back(static_cast<uint8_t>(type));
+        offsets.push_back(static_cast<uint32_t>(offset));
+        lengths.push_back(static_cast<uint32_t>(length));
+        floatFlags.push_back(isFloat);
+        values.push_back(value);
+    }
+
+    size_t size() const { return types.size(); }
+    TokenType type(size_t i) const { return static_cast<TokenType>(types[i]); }
+    std::string_view lexeme(size_t i) const { return src.substr(offsets[i], lengths[i]); }
+    std::string_view source() const { return src; }
+
+    Token operator[](size_t i) const {
+        return {type(i), offsets[i], lengths[i], floatFlags[i] != 0, values[i]};
+    }
+
+    // Bytes held by the token arrays (capacity, not just size)
+    size_t memoryUsage() const {
+        return types.capacity() + floatFlags.capacity() +
+               (offsets.capacity() + lengths.capacity()) * sizeof(uint32_t) +
+               values.capacity() * sizeof(NumberValue);
+    }
+
+private:
+    std::string_view src;
+    std::vector<uint8_t> types;
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> lengths;
+    std::vector<uint8_t> floatFlags;
+    std::vector<NumberValue> values;
 };
 
 class Lexer {
 public:
-    explicit Lexer(const std::string& source);
-    std::vector<Token> scanTokens();
+    explicit Lexer(std::string_view source);
+    Lexer(std::string_view source, size_t begin, size_t end, size_t firstLine,
+          std::ostream& diagnostics);
+
+    // Batch API: lexes the whole input up front
+    TokenBuffer scanTokens();
+
+    // Pull API: scans just far enough to produce one token. Returns TOK_EOF
+    // (repeatedly) once the input is exhausted.
+    Token nextToken();
+
+    std::string_view getSource() const { return source; }
 
 private:
-    std::string source;
-    std::vector<Token> tokens;
+    std::string_view source;
+    size_t limit;  // End of the range being lexed
+    Token pending{TOK_EOF, 0, 0, false};
+    bool hasPending = false;
     size_t start = 0;
     size_t current = 0;
     size_t line = 1;
+    const scan::Kernels& kernels;
+    std::ostream& diagnostics;
+
+    // Raw cursor helpers for the bulk scanning kernels
+    const char* cursor() const { return source.data() + current; }
+    const char* end() const { return source.data() + limit; }
+    size_t offsetOf(const char* p) const { return static_cast<size_t>(p - source.data()); }
 
     void scanToken();
     void string();
     void number();
     void identifier();
     void addToken(TokenType type);
-    void addToken(TokenType type, const std::string& lexeme, bool isFloat = false);
+    void addToken(TokenType type, size_t offset, size_t length, bool isFloat = false,
+                  NumberValue value = {0});
+    void radixNumber(unsigned base);
+    bool decimalDigits(uint64_t& value, int& digits);
     
     bool isAtEnd() const;
     bool match(char expected);
@@ -94,6 +198,14 @@ private:
     char peek() const;
     char peekNext() const;
     bool isDigit(char c) const;
+    unsigned digitValue(char c) const;
     bool isAlpha(char c) const;
     bool isAlphaNumeric(char c) const;
-};
\ No newline at end of file
+};
+
+class ThreadPool;
+
+// Lexes the source in newline-aligned chunks on a thread pool. Produces the
+// same tokens and diagnostics, in the same order, as Lexer::scanTokens.
+// Inputs too small to be worth splitting are lexed serially.
+TokenBuffer scanTokensParallel(std::string_view source, ThreadPool& pool);
@@ -0,0 +1,46 @@
+#ifndef OBJECT_CACHE_H
+#define OBJECT_CACHE_H
+
+#include <llvm/ExecutionEngine/ObjectCache.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// Compiled machine code kept on disk between runs, so rerunning an
+// unchanged script loads its object instead of compiling it again.
+// Entries are named by a program key (see programKey) plus the module
+// name. Several processes may share one directory: entries are written to
+// a temporary file and renamed into place, and the least recently used
+// ones are evicted once the directory grows past maxBytes.
+class DiskObjectCache : public llvm::ObjectCache {
+public:
+    DiskObjectCache(std::string directory, std::string programKey, uint64_t maxBytes);
+
+    // Hex digest of the source together with everything else that changes
+    // the generated code: the compiler build, opt level and target CPU
+    static std::string programKey(std::string_view source, unsigned optLevel,
+                                  const std::string& cpu, const std::string& features);
+
+    // Cached object for the named module, or null on a miss
+    std::unique_ptr<llvm::MemoryBuffer> load(llvm::StringRef moduleName);
+
+    // Adds an entry under the given name; other compiled forms of the
+    // program, such as bytecode, are kept next to the objects this way
+    void store(llvm::StringRef name, llvm::StringRef data);
+
+    // Hooks called by the JIT's compiler
+    void notifyObjectCompiled(const llvm::Module* module, llvm::MemoryBufferRef object) override;
+    std::unique_ptr<llvm::MemoryBuffer> getObject(const llvm::Module* module) override;
+
+private:
+    std::string directory;
+    std::string key;
+    uint64_t maxBytes;
+
+    std::string entryPath(llvm::StringRef moduleName) const;
+    void evict();
+};
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef PARALLEL_LOOP_H
+#define PARALLEL_LOOP_H
+
+#include "ast.h"
+#include "types.h"
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// A goated bet, split into what running its iterations at the same time
+// needs. It counts up by one,
+//
+//     goated bet (pookie i = start, i < end, i = i + 1) { body }
+//
+// or with i <= end, and its iterations share nothing they could race on:
+// - the counter and every variable declared in the body are private to
+//   an iteration;
+// - other variables are only read, except for reductions: a variable the
+//   body only ever updates as `x = x + e` (or x += e), `x = min(x, e)` or
+//   `x = max(x, e)`, with e not reading x. Each thread accumulates its own
+//   copy, and the copies are combined when the loop ends.
+// Squad elements may be written, as long as no two iterations write the
+// same one; squads may not be resized. The body cannot solulu.
+//
+// After the loop, the counter holds the first value past the end, as
+// after a bet; the variables declared in the body are unspecified.
+struct ParallelLoop {
+    enum class Reduce : uint8_t { Sum, Min, Max };
+    struct Reduction {
+        std::string_view name;
+        Reduce kind;
+        ValueType type;  // Int or Double
+    };
+
+    std::string_view counter;
+    AST::ExprAST* start = nullptr;
+    AST::ExprAST* end = nullptr;
+    bool inclusive = false;  // i <= end
+    std::vector<Reduction> reductions;
+    // Variables read in the body that live outside it, in order of first use
+    std::vector<std::string_view> captured;
+    std::vector<std::string_view> locals;
+};
+
+// Whether a bet increment is exactly `counter = counter + 1`
+bool isIncrement(AST::StmtAST* stmt, std::string_view counter);
+
+// Checks a goated bet of a function with the given types, throwing
+// std::runtime_error if its iterations could not run in parallel. Every
+// backend calls this where it starts on the loop, after its initializer,
+// so all of them report the same error.
+ParallelLoop analyzeParallelLoop(AST::BetStmtAST* loop, const ProgramTypes& program, const FunctionTypes& types);
+
+#endif
@@ -2,47 +2,145 @@
 #define PARSER_H
 
 #include "lexer.h"
+#include "token_stream.h"
 #include "ast.h"
+#include "flat_ast.h"
+#include "arena.h"
 #include <memory>
 #include <vector>
 #include <string>
-#include <initializer_list>
+#include <string_view>
 
-class Parser {
+// Recursive-descent parser. What it builds is up to the Builder: TreeBuilder
+// allocates the pointer-linked tree from ast.h in an arena, FlatBuilder
+// appends index-linked nodes to a FlatAST. Both builders are instantiated
+// in parser.cpp.
+template <typename Builder>
+class BasicParser {
 public:
-    Parser(std::vector<Token> tokens);
-    std::unique_ptr<AST::CookAST> parseCook();
+    using Expr = typename Builder::Expr;
+    using Stmt = typename Builder::Stmt;
+    using ExprList = typename Builder::ExprList;
+    using StmtList = typename Builder::StmtList;
+    using NameList = typename Builder::NameList;
+    using Root = typename Builder::Root;
+    using Program = typename Builder::Program;
+
+    // Pulls tokens lazily from a stream; the stream must outlive the parser
+    BasicParser(TokenStream& tokens, Builder builder);
+
+    // Batch convenience wrapper over a fully scanned buffer
+    BasicParser(TokenBuffer tokens, Builder builder);
+
+    // A whole file: top-level bruh and sigma declarations around exactly
+    // one cook block, optionally ended by `ghost;`
+    Program parseProgram();
+
+    // Just the cook block
+    Root parseCook();
+
+    // Deepest expression tree or block nesting accepted before parsing
+    // fails with an error; keeps the recursive passes after the parser
+    // well within the stack. Blocks this deep around an expression as
+    // tall is about the most those passes handle on an 8 MB stack, so the
+    // driver accepts no larger limit.
+    static constexpr size_t defaultMaxNesting = 4096;
+    void setMaxNesting(size_t limit) { maxNesting = limit; }
+
+    // One top-level bruh, sigma or cook declaration
+    Stmt parseDeclaration();
 
 private:
-    std::vector<Token> tokens;
-    size_t current = 0;
+    TokenBuffer ownedBuffer;
+    std::unique_ptr<TokenStream> ownedStream;
+    TokenStream& tokens;
+    Builder builder;
+
+    // Reusable stacks for collecting child lists before they are handed
+    // to the builder
+    std::vector<Stmt> stmtScratch;
+    std::vector<Expr> exprScratch;
+    std::vector<std::string_view> nameScratch;
 
-    // Utility methods
+    // Expression parsing is iterative: operands and pending operators live
+    // on these stacks instead of the call stack
+    struct Operand {
+        Expr expr;
+        uint32_t depth;  // Height of the subtree
+    };
+    enum class Pending : uint8_t { Binary, Unary, Paren, Assign, IndexAssign };
+    struct PendingOperator {
+        Pending kind;
+        uint8_t precedence;
+        uint8_t op;              // AST::BinaryOp or AST::UnaryOp
+        bool compound = false;   // Assign: `name op= value`
+        std::string_view name{}; // Assign: target variable
+        Expr index{};            // IndexAssign: the element's index
+        uint32_t indexDepth = 0; // IndexAssign: height of the index
+    };
+    std::vector<Operand> operands;
+    std::vector<PendingOperator> operators;
+
+    size_t maxNesting = defaultMaxNesting;
+    size_t blockDepth = 0;
+    size_t callDepth = 0;
+
+    template <typename T, typename List>
+    List finishList(std::vector<T>& scratch, size_t mark,
+                    List (Builder::*makeList)(const T*, size_t));
+
+    // Utility methods. Tokens are returned by reference into the stream's
+    // window; copy a Token (it is a small POD) to keep it across more than
+    // a few advance() calls.
     bool isAtEnd() const;
-    Token peek() const;
-    Token previous() const;
-    Token advance();
+    const Token& peek() const;
+    const Token& previous() const;
+    const Token& advance();
     bool check(TokenType type) const;
     bool match(TokenType type);
-    bool match(std::initializer_list<TokenType> types);
-    Token consume(TokenType type, const std::string& message);
+    const Token& consume(TokenType type, const char* message);
+    std::string_view lexeme(const Token& token) const;
     
-    // Expression parsing methods
-    AST::ExprPtr expression();
-    AST::ExprPtr equality();
-    AST::ExprPtr comparison();
-    AST::ExprPtr term();
-    AST::ExprPtr factor();
-    AST::ExprPtr unary();
-    AST::ExprPtr primary();
+    // Expression parsing methods. Those returning an Operand also report
+    // the height of what they parsed, so nesting inside calls, indices
+    // and squad literals counts toward the limit of the tree around them.
+    Expr expression();
+    Operand subexpression();
+    Operand primary();
+    Operand call(std::string_view callee);
+    Operand subscript();
+    Operand squadLiteral();
+    void reduce();
+    void pushOperand(Expr expr, uint32_t depth);
     
     // Statement parsing methods
-    AST::StmtPtr statement();
-    AST::StmtPtr yapStatement();
-    AST::StmtPtr frStatement();
-    AST::StmtPtr betStatement();
-    AST::StmtPtr bruhStatement();
-    AST::StmtList block();
+    Stmt statement();
+    Stmt yapStatement();
+    Stmt frStatement();
+    Stmt betStatement(bool parallel);
+    Stmt bruhStatement();
+    Stmt soluluStatement();
+    Stmt yoinkStatement();
+    Stmt yeetStatement();
+    Stmt sigmaDeclaration();
+    StmtList block();
 };
 
-#endif
\ No newline at end of file
+// Builds the arena-allocated tree consumed by CodeGen
+using Parser = BasicParser<AST::TreeBuilder>;
+
+// Builds the flat, index-based representation
+using FlatParser = BasicParser<AST::FlatBuilder>;
+
+class ThreadPool;
+
+// Parses a fully scanned program with its top-level declarations spread
+// over a thread pool. A brace-matching pre-scan splits the token buffer
+// into declaration ranges; each batch of ranges is parsed into its own
+// arena, and the results are merged into `arena` in source order, so the
+// AST (and the first error reported, if any) is the same as a serial
+// parseProgram. Small programs are parsed serially.
+AST::ProgramAST* parseProgramParallel(const TokenBuffer& tokens, Arena& arena, ThreadPool& pool,
+                                      size_t maxNesting = Parser::defaultMaxNesting);
+
+#endif
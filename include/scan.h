@@ -0,0 +1,36 @@
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <cstddef>
+
+// Byte-scanning kernels used by the lexer's hot loops. Each kernel scans
+// [p, end) and returns a pointer to the first byte that stops the run, or
+// end. Vector implementations (SSE2/AVX2 on x86-64) are selected at runtime
+// and must return exactly what the scalar versions return.
+namespace scan {
+
+struct Kernels {
+    const char* name;
+
+    // Skips ' ', '\t', '\r' and '\n', adding the newlines passed to *newlines
+    const char* (*skipWhitespace)(const char* p, const char* end, size_t* newlines);
+
+    // Skips [A-Za-z0-9_]
+    const char* (*identifierEnd)(const char* p, const char* end);
+
+    // Skips [0-9]
+    const char* (*digitsEnd)(const char* p, const char* end);
+
+    // Finds the next '"', adding the newlines passed to *newlines
+    const char* (*findQuote)(const char* p, const char* end, size_t* newlines);
+};
+
+// Best implementation for the running CPU, chosen on first use
+const Kernels& kernels();
+
+// Portable byte-at-a-time reference implementation
+const Kernels& scalarKernels();
+
+}
+
+#endif
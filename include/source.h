@@ -0,0 +1,28 @@
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include <string>
+#include <string_view>
+
+// Read-only view of a source file. The file is memory-mapped where the
+// platform supports it, so the lexer works directly on the page cache
+// instead of a heap copy of the input.
+class SourceFile {
+public:
+    explicit SourceFile(const std::string& path);
+    ~SourceFile();
+
+    SourceFile(const SourceFile&) = delete;
+    SourceFile& operator=(const SourceFile&) = delete;
+
+    std::string_view contents() const { return std::string_view(data, length); }
+    size_t size() const { return length; }
+
+private:
+    const char* data = "";
+    size_t length = 0;
+    bool mapped = false;
+    std::string fallback;  // Owns the bytes when mmap is unavailable
+};
+
+#endif
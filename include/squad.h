@@ -0,0 +1,30 @@
+#ifndef SQUAD_H
+#define SQUAD_H
+
+#include <cstdint>
+
+// A squad: a growable array of 64-bit elements, the raw bits of int64_t or
+// double values as the squad's inferred type says. Compiled code builds
+// the same struct inline (see CodeGen::squadType), and squads pass between
+// the interpreter and compiled code as pointers, so both allocate with the
+// C allocator. Squads are references and are never freed.
+struct Squad {
+    int64_t length;
+    int64_t capacity;
+    uint64_t* data;
+};
+
+// A squad of `length` zeroes; a negative length gives an empty squad
+Squad* newSquad(int64_t length);
+
+// The element at index, throwing std::runtime_error when it is out of bounds
+uint64_t& squadElement(Squad* squad, int64_t index);
+
+// Inserts value before index, or appends when index is the length. Full
+// squads double their capacity, so appending is amortized constant time.
+void squadInsert(Squad* squad, int64_t index, uint64_t value);
+
+// Removes the element at index, moving the ones after it down
+void squadRemove(Squad* squad, int64_t index);
+
+#endif
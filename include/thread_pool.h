@@ -0,0 +1,49 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads for the compiler's data-parallel phases.
+// Work is submitted as a batch of indexed tasks that the workers (and the
+// calling thread) claim from a shared counter until the batch is drained.
+class ThreadPool {
+public:
+    // 0 threads means one per hardware thread
+    explicit ThreadPool(unsigned threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Threads that take part in run(), including the caller
+    unsigned size() const { return static_cast<unsigned>(workers.size()) + 1; }
+
+    // Runs task(0) .. task(count - 1) and returns once all of them have
+    // finished. The first exception thrown by a task is rethrown here.
+    void run(size_t count, const std::function<void(size_t)>& task);
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+
+    const std::function<void(size_t)>* job = nullptr;
+    size_t jobCount = 0;
+    std::atomic<size_t> nextIndex{0};
+    size_t generation = 0;
+    unsigned busyWorkers = 0;
+    bool stopping = false;
+    std::exception_ptr error;
+
+    void workerLoop();
+    void drain(const std::function<void(size_t)>& task, size_t count);
+};
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef TOKEN_STREAM_H
+#define TOKEN_STREAM_H
+
+#include "lexer.h"
+#include <array>
+#include <atomic>
+#include <memory>
+#include <string_view>
+#include <thread>
+
+// Bounded window over a token source that the parser pulls from lazily.
+// Only the last consumed token and a small lookahead are kept, so peak
+// memory no longer grows with the size of the input. The source is one of:
+//   - a Lexer, driven on demand from the parser's thread,
+//   - a Lexer running ahead on a producer thread (lexing and parsing overlap),
+//   - a pre-scanned TokenBuffer (the batch path).
+class TokenStream {
+public:
+    static constexpr size_t windowSize = 16;  // Power of two
+
+    explicit TokenStream(Lexer& lexer, bool threaded = false);
+    explicit TokenStream(const TokenBuffer& buffer);
+
+    // Streams tokens [begin, end) of a buffer, followed by TOK_EOF
+    TokenStream(const TokenBuffer& buffer, size_t begin, size_t end);
+    ~TokenStream();
+
+    TokenStream(const TokenStream&) = delete;
+    TokenStream& operator=(const TokenStream&) = delete;
+
+    // Current (not yet consumed) token
+    const Token& peek() const { return window[consumed & (windowSize - 1)]; }
+
+    // Token `ahead` positions past the current one; ahead < windowSize - 1
+    const Token& peekAhead(size_t ahead);
+
+    // Most recently consumed token
+    const Token& previous() const { return window[(consumed - 1) & (windowSize - 1)]; }
+
+    void advance();
+
+    std::string_view source() const { return src; }
+
+    // Number of tokens consumed so far
+    size_t position() const { return consumed; }
+
+private:
+    class Producer;
+
+    std::string_view src;
+    Lexer* lexer = nullptr;
+    const TokenBuffer* buffer = nullptr;
+    size_t bufferNext = 0;  // Next buffer index to pull
+    size_t bufferEnd = 0;
+    std::unique_ptr<Producer> producer;
+
+    std::array<Token, windowSize> window;
+    size_t consumed = 0;  // Index of the current token
+    size_t filled = 0;    // Tokens pulled into the window so far
+    bool exhausted = false;
+
+    Token pull();
+    void fill(size_t count);
+};
+
+#endif
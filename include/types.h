@@ -0,0 +1,79 @@
+#ifndef TYPES_H
+#define TYPES_H
+
+#include "ast.h"
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Machine types of values: i1, i64, double, string words (see
+// brainrot_rt.h) and squad pointers. Numeric types are ordered, and a
+// value converts up to any later one, so a variable gets the least type
+// that holds everything stored in it. Squads are typed by their elements the same way: Squad is
+// one whose elements are not known yet, and settles to IntSquad.
+enum class ValueType : uint8_t { Unknown, Bool, Int, Double, String, Squad, IntSquad, DoubleSquad };
+
+inline bool isSquad(ValueType type) {
+    return type == ValueType::Squad || type == ValueType::IntSquad || type == ValueType::DoubleSquad;
+}
+
+// Elements are stored as i64 or double; truth values are widened
+inline ValueType squadOf(ValueType element) {
+    switch (element) {
+        case ValueType::Bool:
+        case ValueType::Int: return ValueType::IntSquad;
+        case ValueType::Double: return ValueType::DoubleSquad;
+        default: return ValueType::Squad;
+    }
+}
+
+inline ValueType elementType(ValueType squad) {
+    switch (squad) {
+        case ValueType::IntSquad: return ValueType::Int;
+        case ValueType::DoubleSquad: return ValueType::Double;
+        default: return ValueType::Unknown;
+    }
+}
+
+// The types of one function, or of main (the cook block)
+struct FunctionTypes {
+    std::vector<ValueType> params;
+    ValueType result = ValueType::Unknown;
+    // Every name declared or assigned in the function, parameters included
+    std::unordered_map<std::string_view, ValueType> variables;
+    // Every squad literal and squad(n) call in the function
+    std::unordered_map<const AST::ExprAST*, ValueType> squads;
+
+    // Names never declared, which CodeGen reports, count as integers
+    ValueType variable(std::string_view name) const {
+        auto it = variables.find(name);
+        return it == variables.end() ? ValueType::Int : it->second;
+    }
+
+    ValueType squad(const AST::ExprAST* expr) const {
+        auto it = squads.find(expr);
+        return it == squads.end() ? ValueType::IntSquad : it->second;
+    }
+};
+
+struct ProgramTypes {
+    std::unordered_map<std::string_view, FunctionTypes> functions;
+    FunctionTypes main;
+};
+
+// min(a, b) and max(a, b) are built in, unless the program declares a
+// bruh of that name
+inline bool isMinMax(const ProgramTypes& types, std::string_view callee) {
+    return (callee == "min" || callee == "max") && !types.functions.count(callee);
+}
+
+// Infers the type of every variable, parameter and return value from what
+// the program stores in them, calls across functions included. Integers
+// stay integers unless a double reaches them; what is never given a value
+// is an integer. A squad and every name it is stored in share one type,
+// since they share the elements. A number, a string and a squad never
+// become one another, so mixing them is left to the code generators to
+// report. Never throws: errors are theirs to find too.
+ProgramTypes inferTypes(AST::ProgramAST* program);
+
+#endif
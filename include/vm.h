@@ -0,0 +1,51 @@
+#ifndef VM_H
+#define VM_H
+
+#include "bytecode.h"
+#include "squad.h"
+#include <cstdint>
+#include <vector>
+
+// Runs bytecode without LLVM, for scripts too short to be worth
+// compiling. All frames live on one register stack: a call pushes a small
+// record instead of recursing in C++, and a tail call reuses the caller's
+// frame, so recursion is bounded by memory rather than the native stack.
+// Dispatch is threaded through a table of label addresses where the
+// compiler supports it, and a switch otherwise.
+class VM {
+public:
+    // Frames deeper than this report a stack overflow
+    static constexpr size_t maxFrames = size_t(1) << 24;
+
+    explicit VM(const Bytecode& bytecode);
+
+    // Runs main with the same messages as CodeGen::runMain and returns
+    // its exit code
+    int run();
+
+private:
+    // Registers are untyped; the instruction says how to read one
+    union Slot {
+        int64_t i;
+        double d;
+        Squad* s;
+        uint64_t w;             // String word
+    };
+
+    struct Frame {
+        uint32_t function;
+        uint32_t base;          // First register of the frame
+        uint32_t returnPc;
+        uint32_t dst;           // Register receiving the result
+    };
+
+    const Bytecode& bytecode;
+    std::vector<uint64_t> strings;  // Words of the string table
+    std::vector<Slot> registers;
+    std::vector<Frame> frames;
+
+    double execute();
+    Slot* enter(uint32_t function, size_t base, size_t arguments);
+};
+
+#endif
@@ -0,0 +1,215 @@
+#include "brainrot_rt.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+    // About this many chunks per worker, unless a grain is set: enough
+    // for stealing to even out uneven iterations, few enough that a
+    // chunk's overhead is lost in its work
+    constexpr uint64_t chunksPerWorker = 16;
+
+    // The chunks a worker has left, [low, high), packed into one word so
+    // the owner taking one from the front and a thief taking half from the
+    // back are each a single compare-and-swap. The word is the whole
+    // state, so a value seen again means the same chunks and ABA is
+    // harmless.
+    uint64_t pack(uint32_t low, uint32_t high) { return uint64_t(high) << 32 | low; }
+    uint32_t low(uint64_t share) { return static_cast<uint32_t>(share); }
+    uint32_t high(uint64_t share) { return static_cast<uint32_t>(share >> 32); }
+
+    // On a cache line of its own, so workers do not slow each other down
+    struct alignas(64) Share {
+        std::atomic<uint64_t> chunks{0};
+    };
+
+    struct Job {
+        brainrot_chunk chunk = nullptr;
+        void* context = nullptr;
+        char* partials = nullptr;
+        int64_t stride = 0;
+        int64_t begin = 0;
+        uint64_t count = 0;  // Iterations
+        uint64_t grain = 1;
+        uint32_t workers = 1;
+    };
+
+    // Set while a thread runs chunks, so loops nested in them run inline
+    thread_local bool inLoop = false;
+
+    int64_t environment(const char* name) {
+        const char* value = std::getenv(name);
+        return value ? std::strtoll(value, nullptr, 10) : 0;
+    }
+
+    // Threads are started the first time a loop needs them and then wait
+    // for the next loop; the pool is never destroyed, since they are still
+    // waiting in it when the program exits
+    class Pool {
+    public:
+        std::atomic<int64_t> threads;
+        std::atomic<int64_t> grain;
+
+        Pool() {
+            int64_t configured = environment("BRAINROT_THREADS");
+            threads = configured > 0 ? configured : std::max<int64_t>(std::thread::hardware_concurrency(), 1);
+            threads = std::min<int64_t>(threads, BRAINROT_MAX_WORKERS);
+            grain = std::max<int64_t>(environment("BRAINROT_GRAIN"), 0);
+        }
+
+        void run(const Job& next) {
+            std::lock_guard<std::mutex> one(running);
+            uint64_t chunks = (next.count + next.grain - 1) / next.grain;
+            for (uint32_t w = 0; w < next.workers; ++w) {
+                shares[w].chunks.store(pack(static_cast<uint32_t>(chunks * w / next.workers),
+                                            static_cast<uint32_t>(chunks * (w + 1) / next.workers)),
+                                       std::memory_order_relaxed);
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                job = next;
+                pending = next.workers - 1;
+                ++generation;
+                while (helpers.size() + 1 < next.workers) {
+                    auto self = static_cast<uint32_t>(helpers.size() + 1);
+                    helpers.emplace_back(&Pool::serve, this, self, generation - 1);
+                }
+            }
+            wake.notify_all();
+
+            work(0);
+            std::unique_lock<std::mutex> lock(mutex);
+            finished.wait(lock, [this] { return pending == 0; });
+        }
+
+    private:
+        std::mutex running;  // One loop at a time
+        std::mutex mutex;    // Guards job, generation and pending
+        std::condition_variable wake;
+        std::condition_variable finished;
+        std::vector<std::thread> helpers;  // Workers 1 and up
+        Job job;
+        uint64_t generation = 0;
+        uint32_t pending = 0;  // Helpers still working on the job
+        Share shares[BRAINROT_MAX_WORKERS];
+
+        void serve(uint32_t self, uint64_t seen) {
+            for (;;) {
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    wake.wait(lock, [&] { return generation != seen; });
+                    seen = generation;
+                    if (self >= job.workers) {
+                        continue;
+                    }
+                }
+                work(self);
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--pending == 0) {
+                    finished.notify_one();
+                }
+            }
+        }
+
+        // Runs chunks until there are none left to take or steal. Chunks
+        // only ever move from one share to another, so once every worker
+        // has returned, all of them have run.
+        void work(uint32_t self) {
+            inLoop = true;
+            std::atomic<uint64_t>& own = shares[self].chunks;
+            do {
+                uint64_t share = own.load(std::memory_order_acquire);
+                while (low(share) < high(share)) {
+                    if (own.compare_exchange_weak(share, pack(low(share) + 1, high(share)),
+                                                  std::memory_order_acq_rel)) {
+                        runChunk(self, low(share));
+                        share = own.load(std::memory_order_acquire);
+                    }
+                }
+            } while (steal(self));
+            inLoop = false;
+        }
+
+        // Moves the back half of some other worker's share into this one's,
+        // which is empty
+        bool steal(uint32_t self) {
+            for (uint32_t k = 1; k < job.workers; ++k) {
+                std::atomic<uint64_t>& victim = shares[(self + k) % job.workers].chunks;
+                uint64_t share = victim.load(std::memory_order_acquire);
+                while (low(share) < high(share)) {
+                    uint32_t middle = high(share) - (high(share) - low(share) + 1) / 2;
+                    if (victim.compare_exchange_weak(share, pack(low(share), middle), std::memory_order_acq_rel)) {
+                        shares[self].chunks.store(pack(middle, high(share)), std::memory_order_release);
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+
+        void runChunk(uint32_t self, uint32_t index) {
+            uint64_t first = index * job.grain;
+            uint64_t last = std::min(first + job.grain, job.count);
+            job.chunk(job.context, static_cast<int64_t>(static_cast<uint64_t>(job.begin) + first),
+                      static_cast<int64_t>(static_cast<uint64_t>(job.begin) + last),
+                      job.partials ? job.partials + self * job.stride : nullptr);
+            brainrot_flush();
+        }
+    };
+
+    Pool& pool() {
+        static Pool* instance = new Pool;
+        return *instance;
+    }
+}
+
+extern "C" {
+
+void brainrot_parallel_configure(int64_t threads, int64_t grain) {
+    if (threads > 0) {
+        pool().threads = std::min<int64_t>(threads, BRAINROT_MAX_WORKERS);
+    }
+    if (grain > 0) {
+        pool().grain = grain;
+    }
+}
+
+int64_t brainrot_parallel_workers(void) {
+    return inLoop ? 1 : pool().threads.load();
+}
+
+void brainrot_parallel_for(int64_t begin, int64_t end, int64_t workers, brainrot_chunk chunk, void* context,
+                           void* partials, int64_t stride) {
+    if (end <= begin) {
+        return;
+    }
+    Job job;
+    job.chunk = chunk;
+    job.context = context;
+    job.partials = static_cast<char*>(partials);
+    job.stride = stride;
+    job.begin = begin;
+    job.count = static_cast<uint64_t>(end) - static_cast<uint64_t>(begin);
+    job.workers = static_cast<uint32_t>(std::clamp<int64_t>(workers, 1, BRAINROT_MAX_WORKERS));
+
+    // Chunk indices must fit the 32-bit halves of a share
+    int64_t grain = pool().grain;
+    job.grain = grain > 0 ? static_cast<uint64_t>(grain) : job.count / (job.workers * chunksPerWorker);
+    job.grain = std::max({job.grain, uint64_t(1), job.count / UINT32_MAX + 1});
+    job.workers = static_cast<uint32_t>(std::min<uint64_t>(job.workers, (job.count + job.grain - 1) / job.grain));
+
+    if (inLoop || job.workers == 1) {
+        chunk(context, begin, end, partials);
+        return;
+    }
+    // What was printed before the loop comes out before anything in it
+    brainrot_flush();
+    pool().run(job);
+}
+
+}
@@ -0,0 +1,275 @@
+#include "brainrot_rt.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace {
+    constexpr size_t capacity = size_t(64) << 10;
+
+    // Room a formatted number may need: DBL_MAX with six decimals is 316
+    // characters, and an int64_t at most 20
+    constexpr size_t maxNumberLength = 320;
+
+    // Writes the spans, retrying partial and interrupted writes. Output
+    // that cannot be written, say to a closed pipe, is dropped.
+    void writeAll(iovec* spans, int count) {
+        while (count > 0) {
+            ssize_t written = writev(STDOUT_FILENO, spans, count);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return;
+            }
+            auto left = static_cast<size_t>(written);
+            while (count > 0 && left >= spans->iov_len) {
+                left -= spans->iov_len;
+                ++spans;
+                --count;
+            }
+            if (count > 0) {
+                spans->iov_base = static_cast<char*>(spans->iov_base) + left;
+                spans->iov_len -= left;
+            }
+        }
+    }
+
+    // A terminal sees each line as it is printed, like stdio's line buffering
+    bool lineBuffered() {
+        static const bool terminal = isatty(STDOUT_FILENO) == 1;
+        return terminal;
+    }
+
+    struct OutputBuffer {
+        char data[capacity];
+        size_t used = 0;
+
+        ~OutputBuffer() { flush(); }
+
+        void flush() {
+            if (used == 0) {
+                return;
+            }
+            iovec span{data, used};
+            used = 0;
+            writeAll(&span, 1);
+        }
+
+        // Space for a number at the end of the buffer
+        char* reserve() {
+            if (capacity - used < maxNumberLength) {
+                flush();
+            }
+            return data + used;
+        }
+    };
+
+    // Written out when its thread exits, which for the main thread is
+    // during exit(), before stdio's own buffers are flushed
+    thread_local OutputBuffer output;
+}
+
+// The bytes behind heap strings. used only grows, and only the string
+// ending at used may append, so claiming the room is one compare-exchange
+// even when threads share the string.
+struct BrainrotStringBuffer {
+    std::atomic<int64_t> used;
+    int64_t capacity;
+
+    char* data() { return reinterpret_cast<char*>(this + 1); }
+};
+
+namespace {
+    struct StringView {
+        const char* data;
+        int64_t length;
+    };
+
+    const BrainrotString* heapHeader(uint64_t string) {
+        return reinterpret_cast<const BrainrotString*>(string - 1);
+    }
+
+    // The bytes of a string; a small one is unpacked into storage
+    StringView view(uint64_t string, char (&storage)[8]) {
+        if (!(string & 1)) {
+            auto length = static_cast<int64_t>((string >> 1) & 7);
+            for (int64_t i = 0; i < length; ++i) {
+                storage[i] = static_cast<char>(string >> (8 * i + 8));
+            }
+            return {storage, length};
+        }
+        const BrainrotString* header = heapHeader(string);
+        return {header->data, header->length};
+    }
+
+    uint64_t smallString(const char* data, int64_t length) {
+        uint64_t word = uint64_t(length) << 1;
+        for (int64_t i = 0; i < length; ++i) {
+            word |= uint64_t(static_cast<unsigned char>(data[i])) << (8 * i + 8);
+        }
+        return word;
+    }
+
+    // Compiled code cannot unwind, so running out of memory ends the program
+    void* allocate(size_t size) {
+        void* result = std::malloc(size);
+        if (!result) {
+            std::fputs("Error: Out of memory\n", stderr);
+            std::abort();
+        }
+        return result;
+    }
+
+    uint64_t heapString(const char* data, int64_t length, BrainrotStringBuffer* buffer) {
+        auto header = static_cast<BrainrotString*>(allocate(sizeof(BrainrotString)));
+        *header = {length, data, buffer};
+        return reinterpret_cast<uint64_t>(header) + 1;
+    }
+
+    // first followed by second, with room to grow
+    uint64_t newString(StringView first, StringView second) {
+        int64_t length = first.length + second.length;
+        if (length <= BRAINROT_SMALL_STRING_MAX) {
+            char bytes[8];
+            std::memcpy(bytes, first.data, first.length);
+            std::memcpy(bytes + first.length, second.data, second.length);
+            return smallString(bytes, length);
+        }
+        int64_t capacity = std::max<int64_t>(length * 2, 32);
+        void* memory = allocate(sizeof(BrainrotStringBuffer) + static_cast<size_t>(capacity));
+        auto buffer = new (memory) BrainrotStringBuffer{{length}, capacity};
+        std::memcpy(buffer->data(), first.data, first.length);
+        std::memcpy(buffer->data() + first.length, second.data, second.length);
+        return heapString(buffer->data(), length, buffer);
+    }
+}
+
+int64_t brainrot_print_int(int64_t value) {
+    OutputBuffer& buffer = output;
+    char* first = buffer.reserve();
+    char* last = std::to_chars(first, buffer.data + capacity, value).ptr;
+    buffer.used += static_cast<size_t>(last - first);
+    return last - first;
+}
+
+int64_t brainrot_print_double(double value) {
+    OutputBuffer& buffer = output;
+    char* first = buffer.reserve();
+    char* last = std::to_chars(first, buffer.data + capacity, value, std::chars_format::fixed, 6).ptr;
+    buffer.used += static_cast<size_t>(last - first);
+    return last - first;
+}
+
+int64_t brainrot_print_string(const char* data, int64_t length) {
+    OutputBuffer& buffer = output;
+    auto size = static_cast<size_t>(length);
+    if (size > capacity - buffer.used) {
+        // The buffer and the string go out in one system call
+        iovec spans[] = {{buffer.data, buffer.used}, {const_cast<char*>(data), size}};
+        buffer.used = 0;
+        writeAll(spans, 2);
+        return length;
+    }
+    std::memcpy(buffer.data + buffer.used, data, size);
+    buffer.used += size;
+    if (lineBuffered() && std::memchr(data, '\n', size)) {
+        buffer.flush();
+    }
+    return length;
+}
+
+int64_t brainrot_print_str(uint64_t string) {
+    char storage[8];
+    StringView text = view(string, storage);
+    return brainrot_print_string(text.data, text.length);
+}
+
+void brainrot_flush(void) {
+    output.flush();
+}
+
+uint64_t brainrot_string_constant(const char* data, int64_t length) {
+    if (length <= BRAINROT_SMALL_STRING_MAX) {
+        return smallString(data, length);
+    }
+    return heapString(data, length, nullptr);
+}
+
+int64_t brainrot_string_length(uint64_t string) {
+    if (!(string & 1)) {
+        return static_cast<int64_t>((string >> 1) & 7);
+    }
+    return heapHeader(string)->length;
+}
+
+uint64_t brainrot_string_concat(uint64_t a, uint64_t b) {
+    char left[8];
+    char right[8];
+    StringView first = view(a, left);
+    StringView second = view(b, right);
+    if (second.length == 0) {
+        return a;
+    }
+    if (first.length == 0) {
+        return b;
+    }
+    int64_t length = first.length + second.length;
+    if (length > BRAINROT_SMALL_STRING_MAX && (a & 1)) {
+        BrainrotStringBuffer* buffer = heapHeader(a)->buffer;
+        int64_t expected = first.length;
+        if (buffer && length <= buffer->capacity && buffer->used.compare_exchange_strong(expected, length)) {
+            // second may lie in the same buffer, but only before used
+            std::memcpy(buffer->data() + first.length, second.data, second.length);
+            return heapString(buffer->data(), length, buffer);
+        }
+    }
+    return newString(first, second);
+}
+
+uint64_t brainrot_string_from_int(int64_t value) {
+    char digits[24];
+    char* last = std::to_chars(digits, digits + sizeof digits, value).ptr;
+    return newString({digits, last - digits}, {nullptr, 0});
+}
+
+uint64_t brainrot_string_from_double(double value) {
+    char digits[maxNumberLength];
+    char* last = std::to_chars(digits, digits + sizeof digits, value, std::chars_format::fixed, 6).ptr;
+    return newString({digits, last - digits}, {nullptr, 0});
+}
+
+int64_t brainrot_string_equal(uint64_t a, uint64_t b) {
+    if (a == b) {
+        return 1;
+    }
+    // Equal small strings have equal words, and no other string is as short
+    if (!(a & 1) || !(b & 1)) {
+        return 0;
+    }
+    const BrainrotString* first = heapHeader(a);
+    const BrainrotString* second = heapHeader(b);
+    return first->length == second->length && std::memcmp(first->data, second->data, first->length) == 0;
+}
+
+int64_t brainrot_string_compare(uint64_t a, uint64_t b) {
+    if (a == b) {
+        return 0;
+    }
+    char left[8];
+    char right[8];
+    StringView first = view(a, left);
+    StringView second = view(b, right);
+    int order = std::memcmp(first.data, second.data, std::min(first.length, second.length));
+    if (order != 0) {
+        return order < 0 ? -1 : 1;
+    }
+    return first.length < second.length ? -1 : first.length > second.length ? 1 : 0;
+}
@@ -0,0 +1,101 @@
+#ifndef BRAINROT_RT_H
+#define BRAINROT_RT_H
+
+#include <stdint.h>
+
+// The native runtime behind yap, strings and goated bet loops. Compiled programs call it
+// directly (the JIT resolves these names to the copy linked into the
+// compiler, and executables written with -o link the static library), and
+// the interpreter and VM use it too, so every backend's output goes
+// through the same buffer in the same order.
+//
+// Output collects in a buffer per thread and goes out with write(2) when
+// the buffer fills, at a newline if stdout is a terminal, on
+// brainrot_flush, and when the thread exits. Each print returns the
+// number of characters it added, as printf would.
+//
+// Strings are immutable and fit in one 64-bit word, so they pass through
+// registers, tier cells and VM slots like numbers do:
+// - up to 7 bytes live in the word itself: bit 0 is clear, bits 1-3 hold
+//   the length and bits 8i+8 to 8i+15 byte i;
+// - longer ones are a pointer to an 8-byte aligned BrainrotString, plus 1.
+// Every string of up to 7 bytes thus has exactly one word, and 0 is the
+// empty string, so zeroed memory holds valid strings. Strings, like
+// squads, are never freed.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BRAINROT_SMALL_STRING_MAX 7
+
+struct BrainrotString {
+    int64_t length;
+    const char* data;
+    // Where concatenation may append in place; null for constants, which
+    // compiled code lays out itself (see CodeGen::stringConstant)
+    struct BrainrotStringBuffer* buffer;
+};
+
+int64_t brainrot_print_int(int64_t value);
+// Six decimals, as printf's %f
+int64_t brainrot_print_double(double value);
+int64_t brainrot_print_string(const char* data, int64_t length);
+int64_t brainrot_print_str(uint64_t string);
+
+// Writes out the calling thread's buffer. Anything else writing to stdout
+// (C stdio, llvm::outs) must flush around the program's output.
+void brainrot_flush(void);
+
+// A string over data, which must outlive it; short ones are copied into
+// the word
+uint64_t brainrot_string_constant(const char* data, int64_t length);
+int64_t brainrot_string_length(uint64_t string);
+// a + b. When a ends its buffer and there is room, b is appended in place
+// and the result shares the buffer, so building a string piece by piece
+// in a loop takes linear time rather than quadratic.
+uint64_t brainrot_string_concat(uint64_t a, uint64_t b);
+// Numbers as yap prints them
+uint64_t brainrot_string_from_int(int64_t value);
+uint64_t brainrot_string_from_double(double value);
+// 1 if equal, else 0; equal words are equal without looking at the bytes
+int64_t brainrot_string_equal(uint64_t a, uint64_t b);
+// Byte-wise order, as memcmp and then by length: negative, 0 or positive
+int64_t brainrot_string_compare(uint64_t a, uint64_t b);
+
+// Parallel loops. Compiled code outlines the body of a goated bet into a
+// chunk function that runs iterations [begin, end), and hands the whole
+// range to brainrot_parallel_for. The range is cut into chunks of grain
+// iterations, dealt out evenly to the workers, the calling thread being
+// worker 0. A worker takes chunks from the front of its own share, and
+// once that is empty steals the back half of another's, so uneven
+// iterations still keep every thread busy. Shares are taken and stolen
+// with compare-and-swap; no worker ever waits on a lock.
+//
+// Reductions need no atomics either: worker w accumulates into its own
+// partial, at partials + w * stride, which the caller combines afterwards.
+// A worker's output is flushed after each chunk, so nothing is lost but
+// lines of different iterations come out in no particular order.
+#define BRAINROT_MAX_WORKERS 256
+
+typedef void (*brainrot_chunk)(void* context, int64_t begin, int64_t end, void* partial);
+
+// Threads (at most BRAINROT_MAX_WORKERS) and iterations per chunk for the
+// loops that follow; 0 leaves a setting as it is. They default to the
+// BRAINROT_THREADS and BRAINROT_GRAIN environment variables, and
+// otherwise to every core and to about 16 chunks per thread.
+void brainrot_parallel_configure(int64_t threads, int64_t grain);
+// The workers brainrot_parallel_for will use, so the caller can set up
+// their partials. A loop started from inside another runs on its thread
+// alone, as 1 worker.
+int64_t brainrot_parallel_workers(void);
+// Runs chunk over [begin, end) on workers threads and returns when every
+// iteration is done
+void brainrot_parallel_for(int64_t begin, int64_t end, int64_t workers, brainrot_chunk chunk, void* context,
+                           void* partials, int64_t stride);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
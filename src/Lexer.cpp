@@ -1,21 +1,160 @@
 #include "lexer.h"
+#include <climits>
+#include <cstdlib>
+#include <stdexcept>
 
-// Constructor initializes the lexer with source code
-Lexer::Lexer(const std::string& source) : source(source) {}
+namespace {
 
-// Main tokenization function that processes the entire source code
-std::vector<Token> Lexer::scanTokens() {
+struct Keyword {
+    std::string_view text;
+    TokenType type;
+};
+
+// Every keyword of the language. A new keyword only needs an entry here:
+// the perfect hash below is regenerated at compile time.
+constexpr Keyword keywords[] = {
+    {"yap", TOK_YAP},
+    {"fr", TOK_FR},
+    {"no_cap", TOK_NO_CAP},
+    {"cap", TOK_CAP},
+    {"bet", TOK_BET},
+    {"goon", TOK_GOON},
+    {"bruh", TOK_BRUH},
+    {"solulu", TOK_SOLULU},
+    {"delulu", TOK_DELULU},
+    {"oof", TOK_OOF},
+    {"pookie", TOK_POOKIE},
+    {"goated", TOK_GOATED},
+    {"ohio", TOK_OHIO},
+    {"yeet", TOK_YEET},
+    {"yoink", TOK_YOINK},
+    {"squad", TOK_SQUAD},
+    {"sigma", TOK_SIGMA},
+    {"ghost", TOK_GHOST},
+    {"cook", TOK_COOK}
+};
+
+constexpr size_t keywordCount = sizeof(keywords) / sizeof(keywords[0]);
+constexpr size_t keywordSlotCount = 64;
+
+constexpr size_t keywordMinLength() {
+    size_t result = keywords[0].text.size();
+    for (const auto& kw : keywords) result = kw.text.size() < result ? kw.text.size() : result;
+    return result;
+}
+
+constexpr size_t keywordMaxLength() {
+    size_t result = 0;
+    for (const auto& kw : keywords) result = kw.text.size() > result ? kw.text.size() : result;
+    return result;
+}
+
+static_assert(keywordMinLength() >= 2, "keyword hash reads the first two characters");
+
+// Hash of length, first two and last character. Only valid for
+// identifiers within [keywordMinLength(), keywordMaxLength()].
+constexpr uint32_t keywordHash(std::string_view text, uint32_t seed) {
+    uint32_t h = static_cast<uint32_t>(text.size());
+    h = h * seed + static_cast<unsigned char>(text[0]);
+    h = h * seed + static_cast<unsigned char>(text[1]);
+    h = h * seed + static_cast<unsigned char>(text[text.size() - 1]);
+    return (h ^ (h >> 15)) & (keywordSlotCount - 1);
+}
+
+constexpr bool keywordSeedIsPerfect(uint32_t seed) {
+    bool used[keywordSlotCount] = {};
+    for (const auto& kw : keywords) {
+        uint32_t slot = keywordHash(kw.text, seed);
+        if (used[slot]) return false;
+        used[slot] = true;
+    }
+    return true;
+}
+
+constexpr uint32_t findKeywordSeed() {
+    for (uint32_t seed = 3; seed < 100000; seed += 2) {
+        if (keywordSeedIsPerfect(seed)) return seed;
+    }
+    return 0;
+}
+
+constexpr uint32_t keywordSeed = findKeywordSeed();
+static_assert(keywordSeed != 0, "no collision-free keyword hash; grow keywordSlotCount");
+
+struct KeywordSlots {
+    int8_t index[keywordSlotCount];
+};
+
+constexpr KeywordSlots buildKeywordSlots() {
+    KeywordSlots slots = {};
+    for (auto& entry : slots.index) entry = -1;
+    for (size_t i = 0; i < keywordCount; ++i) {
+        slots.index[keywordHash(keywords[i].text, keywordSeed)] = static_cast<int8_t>(i);
+    }
+    return slots;
+}
+
+constexpr KeywordSlots keywordSlots = buildKeywordSlots();
+
+// Maps an identifier span to its keyword token type without allocating
+TokenType keywordType(std::string_view text) {
+    if (text.size() < keywordMinLength() || text.size() > keywordMaxLength()) {
+        return TOK_IDENTIFIER;
+    }
+    int8_t index = keywordSlots.index[keywordHash(text, keywordSeed)];
+    if (index >= 0 && keywords[index].text == text) {
+        return keywords[index].type;
+    }
+    return TOK_IDENTIFIER;
+}
+
+}
+
+// Constructor initializes the lexer with a view of the source code.
+// The source is not copied; it must outlive the produced tokens.
+Lexer::Lexer(std::string_view source)
+    : Lexer(source, 0, source.size(), 1, std::cerr) {}
+
+// Constructor for lexing one chunk [begin, end) of a larger source. Token
+// offsets stay relative to the whole source, and diagnostics start counting
+// from firstLine.
+Lexer::Lexer(std::string_view source, size_t begin, size_t end, size_t firstLine,
+             std::ostream& diagnostics)
+    : source(source), limit(end), start(begin), current(begin), line(firstLine),
+      kernels(scan::kernels()), diagnostics(diagnostics) {
+    if (source.size() > UINT32_MAX) {
+        throw std::runtime_error("Source file too large (4 GiB limit)");
+    }
+}
+
+// Batch tokenization of the entire source code, built on nextToken()
+TokenBuffer Lexer::scanTokens() {
+    TokenBuffer tokens(source);
+    Token token = nextToken();
+    while (token.type != TOK_EOF) {
+        tokens.push(token);
+        token = nextToken();
+    }
+    tokens.push(token);
+    return tokens;
+}
+
+// Scans characters until a token is produced or the input runs out
+Token Lexer::nextToken() {
     while (!isAtEnd()) {
         start = current;
         scanToken();
+        if (hasPending) {
+            hasPending = false;
+            return pending;
+        }
     }
-    tokens.push_back({TOK_EOF, "", false});
-    return tokens;
+    return {TOK_EOF, static_cast<uint32_t>(limit), 0, false};
 }
 
 // Checks if we've reached the end of the source code
 bool Lexer::isAtEnd() const {
-    return current >= source.length();
+    return current >= limit;
 }
 
 // Checks if the next character matches the expected one and consumes it if true
@@ -34,12 +173,14 @@ char Lexer::advance() {
 
 // Adds a token with just its type (for operators and punctuation)
 void Lexer::addToken(TokenType type) {
-    addToken(type, source.substr(start, current - start), false);
+    addToken(type, start, current - start, false);
 }
 
-// Adds a token with its type, lexeme, and float flag
-void Lexer::addToken(TokenType type, const std::string& lexeme, bool isFloat) {
-    tokens.push_back({type, lexeme, isFloat});
+// Adds a token with its type, source span, float flag and decoded number
+void Lexer::addToken(TokenType type, size_t offset, size_t length, bool isFloat,
+                     NumberValue value) {
+    pending = {type, static_cast<uint32_t>(offset), static_cast<uint32_t>(length), isFloat, value};
+    hasPending = true;
 }
 
 // Core tokenization function that processes a single token
@@ -55,25 +196,37 @@ void Lexer::scanToken() {
         case ']': addToken(TOK_RIGHT_BRACKET); break;
         case ',': addToken(TOK_COMMA); break;
         case '.': addToken(TOK_DOT); break;
-        case '-': addToken(TOK_MINUS); break;
-        case '+': addToken(TOK_PLUS); break;
         case ';': addToken(TOK_SEMICOLON); break;
-        case '*': addToken(TOK_STAR); break;
-        case '/': addToken(TOK_SLASH); break;
 
-        // Two-character tokens (comparison operators)
+        // Arithmetic operators and their compound assignments
+        case '-': addToken(match('=') ? TOK_MINUS_EQUAL : TOK_MINUS); break;
+        case '+': addToken(match('=') ? TOK_PLUS_EQUAL : TOK_PLUS); break;
+        case '*': addToken(match('=') ? TOK_STAR_EQUAL : TOK_STAR); break;
+        case '/': addToken(match('=') ? TOK_SLASH_EQUAL : TOK_SLASH); break;
+        case '%': addToken(match('=') ? TOK_PERCENT_EQUAL : TOK_PERCENT); break;
+
+        // Two-character tokens (comparison and logical operators)
         case '!': addToken(match('=') ? TOK_BANG_EQUAL : TOK_BANG); break;
         case '=': addToken(match('=') ? TOK_EQUAL_EQUAL : TOK_EQUAL); break;
         case '<': addToken(match('=') ? TOK_LESS_EQUAL : TOK_LESS); break;
         case '>': addToken(match('=') ? TOK_GREATER_EQUAL : TOK_GREATER); break;
+        case '&':
+        case '|':
+            if (match(c)) {
+                addToken(c == '&' ? TOK_AND_AND : TOK_OR_OR);
+            } else {
+                diagnostics << "Unexpected character at line " << line << ": " << c << '\n';
+            }
+            break;
 
-        // Whitespace handling
+        // Whitespace handling: skip the whole run at once
+        case '\n':
+            line++;
+            [[fallthrough]];
         case ' ':
         case '\r':
         case '\t':
-            break;
-        case '\n':
-            line++;
+            current = offsetOf(kernels.skipWhitespace(cursor(), end(), &line));
             break;
 
         // String literal handling
@@ -85,7 +238,7 @@ void Lexer::scanToken() {
             } else if (isAlpha(c)) {
                 identifier();
             } else {
-                std::cerr << "Unexpected character at line " << line << ": " << c << '\n';
+                diagnostics << "Unexpected character at line " << line << ": " << c << '\n';
             }
             break;
     }
@@ -93,60 +246,129 @@ void Lexer::scanToken() {
 
 // Processes string literals between double quotes
 void Lexer::string() {
-    while (peek() != '"' && !isAtEnd()) {
-        if (peek() == '\n') line++;
-        advance();
-    }
+    current = offsetOf(kernels.findQuote(cursor(), end(), &line));
     
     if (isAtEnd()) {
-        std::cerr << "Unterminated string at line " << line << std::endl;
+        diagnostics << "Unterminated string at line " << line << std::endl;
         return;
     }
     
     // Consume the closing "
     advance();
     
-    // Get the string value (without the quotes)
-    std::string value = source.substr(start + 1, current - start - 2);
-    addToken(TOK_STRING_LITERAL, value);
+    // The string value is the span between the quotes
+    addToken(TOK_STRING_LITERAL, start + 1, current - start - 2);
 }
 
-// Processes numeric literals (both integers and floating-point)
+// Processes numeric literals in a single pass: decimal integers and
+// fractions, 0x hex and 0b binary integers, with '_' allowed between
+// digits. The decoded value travels in the token, so nothing downstream
+// has to parse the lexeme again.
 void Lexer::number() {
-    bool isFloat = false;
-    std::string numStr;
-    
-    // Add the first digit we already consumed
-    numStr = source[current - 1];
-    
-    // Collect digits before decimal point
-    while (isDigit(peek())) {
-        numStr += advance();
+    if (source[start] == '0' && (peek() == 'x' || peek() == 'X') && digitValue(peekNext()) < 16) {
+        advance(); // Consume the 'x'
+        radixNumber(16);
+        return;
     }
+    if (source[start] == '0' && (peek() == 'b' || peek() == 'B') && digitValue(peekNext()) < 2) {
+        advance(); // Consume the 'b'
+        radixNumber(2);
+        return;
+    }
+
+    // Re-scan from the first digit, which scanToken already consumed
+    current = start;
+    uint64_t mantissa = 0;
+    int intDigits = 0;
+    bool exact = decimalDigits(mantissa, intDigits);
+    uint64_t intPart = mantissa;
+    bool intFits = exact && intPart <= static_cast<uint64_t>(INT64_MAX);
     
     // Look for decimal point
+    int fractionDigits = 0;
+    bool isFloat = false;
     if (peek() == '.' && isDigit(peekNext())) {
-        isFloat = true;
-        numStr += advance(); // Consume the '.'
-        while (isDigit(peek())) {
-            numStr += advance();
-        }
+        advance(); // Consume the '.'
+        size_t fraction = current;
+        exact = decimalDigits(mantissa, fractionDigits) && exact;
         
-        // Convert to double and check if it's actually a whole number
-        double value = std::stod(numStr);
-        if (value == std::floor(value)) {
-            // It's a whole number, convert back to integer
-            numStr = std::to_string((int)value);
-            isFloat = false;
+        // A fraction of all zeros is still a whole number (e.g. 5.00)
+        for (size_t i = fraction; i < current && !isFloat; ++i) {
+            isFloat = source[i] != '0' && source[i] != '_';
         }
     }
+
+    NumberValue value;
+    if (!isFloat) {
+        if (!intFits) {
+            diagnostics << "Integer literal out of range at line " << line << '\n';
+        }
+        value.intValue = static_cast<int64_t>(intPart);
+    } else if (exact && fractionDigits < 23 && mantissa <= (uint64_t(1) << 53)) {
+        // Both operands are exact doubles, so one division rounds correctly
+        static constexpr double powersOfTen[] = {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+        };
+        value.floatValue = static_cast<double>(mantissa) / powersOfTen[fractionDigits];
+    } else {
+        // Too many significant digits for the fast path
+        std::string digits;
+        for (char c : source.substr(start, current - start)) {
+            if (c != '_') digits += c;
+        }
+        value.floatValue = std::strtod(digits.c_str(), nullptr);
+    }
     
-    addToken(TOK_NUMBER_LITERAL, numStr, isFloat);
+    addToken(TOK_NUMBER_LITERAL, start, current - start, isFloat, value);
+}
+
+// Consumes a run of decimal digits with '_' separators, accumulating them
+// into value. Returns false if the value no longer fits in 64 bits.
+bool Lexer::decimalDigits(uint64_t& value, int& digits) {
+    bool exact = true;
+    for (;;) {
+        const char* runEnd = kernels.digitsEnd(cursor(), end());
+        for (const char* p = cursor(); p < runEnd; ++p) {
+            exact = exact &&
+                    !__builtin_mul_overflow(value, 10, &value) &&
+                    !__builtin_add_overflow(value, static_cast<uint64_t>(*p - '0'), &value);
+            ++digits;
+        }
+        current = offsetOf(runEnd);
+        if (peek() != '_' || !isDigit(peekNext())) return exact;
+        advance(); // Consume the '_'
+    }
+}
+
+// Processes a hex or binary integer after its 0x/0b prefix
+void Lexer::radixNumber(unsigned base) {
+    uint64_t value = 0;
+    bool fits = true;
+    for (;;) {
+        unsigned digit = digitValue(peek());
+        if (digit < base) {
+            fits = fits && value <= (UINT64_MAX - digit) / base;
+            value = value * base + digit;
+            advance();
+        } else if (peek() == '_' && digitValue(peekNext()) < base) {
+            advance();
+        } else {
+            break;
+        }
+    }
+
+    if (!fits || value > static_cast<uint64_t>(INT64_MAX)) {
+        diagnostics << "Integer literal out of range at line " << line << '\n';
+    }
+    NumberValue decoded;
+    decoded.intValue = static_cast<int64_t>(value);
+    addToken(TOK_NUMBER_LITERAL, start, current - start, false, decoded);
 }
 
 // Looks ahead two characters without consuming them
 char Lexer::peekNext() const {
-    if (current + 1 >= source.length()) return '\0';
+    if (current + 1 >= limit) return '\0';
     return source[current + 1];
 }
 
@@ -155,6 +377,14 @@ bool Lexer::isDigit(char c) const {
     return c >= '0' && c <= '9';
 }
 
+// Value of a hex digit, or 16 for anything else
+unsigned Lexer::digitValue(char c) const {
+    if (c >= '0' && c <= '9') return static_cast<unsigned>(c - '0');
+    if (c >= 'a' && c <= 'f') return static_cast<unsigned>(c - 'a' + 10);
+    if (c >= 'A' && c <= 'F') return static_cast<unsigned>(c - 'A' + 10);
+    return 16;
+}
+
 // Helper function to check if a character is a letter or underscore
 bool Lexer::isAlpha(char c) const {
     return (c >= 'a' && c <= 'z') ||
@@ -169,35 +399,8 @@ bool Lexer::isAlphaNumeric(char c) const {
 
 // Processes identifiers and keywords
 void Lexer::identifier() {
-    while (isAlphaNumeric(peek())) advance();
-
-    std::string text = source.substr(start, current - start);
-    
-    static const std::unordered_map<std::string, TokenType> keywords = {
-        {"yap", TOK_YAP},
-        {"fr", TOK_FR},
-        {"no_cap", TOK_NO_CAP},
-        {"cap", TOK_CAP},
-        {"bet", TOK_BET},
-        {"goon", TOK_GOON},
-        {"bruh", TOK_BRUH},
-        {"solulu", TOK_SOLULU},
-        {"delulu", TOK_DELULU},
-        {"oof", TOK_OOF},
-        {"pookie", TOK_POOKIE},
-        {"goated", TOK_GOATED},
-        {"ohio", TOK_OHIO},
-        {"yeet", TOK_YEET},
-        {"yoink", TOK_YOINK},
-        {"squad", TOK_SQUAD},
-        {"sigma", TOK_SIGMA},
-        {"ghost", TOK_GHOST},
-        {"cook", TOK_COOK}
-    };
-
-    auto it = keywords.find(text);
-    TokenType type = (it != keywords.end()) ? it->second : TOK_IDENTIFIER;
-    addToken(type);
+    current = offsetOf(kernels.identifierEnd(cursor(), end()));
+    addToken(keywordType(source.substr(start, current - start)));
 }
 
 // Looks at the current character without consuming it
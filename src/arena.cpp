@@ -0,0 +1,45 @@
+#include "arena.h"
+#include <cstdlib>
+
+Arena::~Arena() {
+    for (char* block : blocks) {
+        std::free(block);
+    }
+}
+
+// Starts a new block, growing block sizes geometrically so large programs
+// need only a handful of system allocations
+void* Arena::allocateSlow(size_t size, size_t align) {
+    size_t blockSize = nextBlockSize;
+    if (size + align > blockSize) {
+        blockSize = size + align;
+    }
+    if (nextBlockSize < maxBlockSize) {
+        nextBlockSize *= 2;
+    }
+
+    char* block = static_cast<char*>(std::malloc(blockSize));
+    if (!block) {
+        throw std::bad_alloc();
+    }
+    blocks.push_back(block);
+    bytesReserved += blockSize;
+
+    current = block;
+    capacity = blockSize;
+    used = 0;
+    return allocate(size, align);
+}
+
+void Arena::adopt(Arena& other) {
+    blocks.insert(blocks.end(), other.blocks.begin(), other.blocks.end());
+    bytesUsed += other.bytesUsed;
+    bytesReserved += other.bytesReserved;
+
+    other.blocks.clear();
+    other.current = nullptr;
+    other.used = 0;
+    other.capacity = 0;
+    other.bytesUsed = 0;
+    other.bytesReserved = 0;
+}
@@ -0,0 +1,210 @@
+#include "bytecode.h"
+#include <llvm/Support/xxhash.h>
+#include <cstring>
+
+namespace {
+    // Bump when the instruction set or the layout below changes. The magic
+    // is followed by the xxHash64 of everything after the hash.
+    constexpr char magic[8] = {'S', 'K', 'B', 'C', '0', '0', '0', '4'};
+    constexpr size_t headerSize = sizeof magic + sizeof(uint64_t);
+
+    const char* const operandTable[] = {
+#define BYTECODE_OP(name, operands) operands,
+        BYTECODE_OPS(BYTECODE_OP)
+#undef BYTECODE_OP
+    };
+
+    class Writer {
+    public:
+        std::string data;
+
+        void u32(uint32_t value) { data.append(reinterpret_cast<const char*>(&value), sizeof value); }
+        void u64(uint64_t value) { data.append(reinterpret_cast<const char*>(&value), sizeof value); }
+        void string(std::string_view value) {
+            u32(static_cast<uint32_t>(value.size()));
+            data.append(value);
+        }
+    };
+
+    // Every read is bounds checked; ok() turns false on the first short read
+    class Reader {
+    public:
+        explicit Reader(std::string_view data) : data(data) {}
+
+        bool ok() const { return valid; }
+        bool atEnd() const { return position == data.size(); }
+
+        uint32_t u32() { uint32_t value = 0; read(&value, sizeof value); return value; }
+        uint64_t u64() { uint64_t value = 0; read(&value, sizeof value); return value; }
+        std::string string() {
+            uint32_t size = u32();
+            if (!valid || size > data.size() - position) {
+                valid = false;
+                return {};
+            }
+            std::string value(data.substr(position, size));
+            position += size;
+            return value;
+        }
+        // Element counts are capped by the bytes left, so a bad count
+        // cannot make the caller reserve huge vectors
+        uint32_t count(size_t elementSize) {
+            uint32_t value = u32();
+            if (value > (data.size() - position) / elementSize) {
+                valid = false;
+                return 0;
+            }
+            return value;
+        }
+
+    private:
+        std::string_view data;
+        size_t position = 0;
+        bool valid = true;
+
+        void read(void* out, size_t size) {
+            if (!valid || size > data.size() - position) {
+                valid = false;
+                return;
+            }
+            std::memcpy(out, data.data() + position, size);
+            position += size;
+        }
+    };
+}
+
+const char* operandKinds(Op op) {
+    return operandTable[static_cast<uint32_t>(op)];
+}
+
+std::string Bytecode::serialize() const {
+    Writer out;
+    out.data.append(magic, sizeof magic);
+    out.u64(0);  // Checksum, filled in below
+    out.u32(static_cast<uint32_t>(functions.size()));
+    for (const BytecodeFunction& function : functions) {
+        out.string(function.name);
+        out.u32(function.params);
+        out.u32(function.variables);
+        out.u32(function.registers);
+        out.u32(function.entry);
+        out.u32(function.length);
+        out.u32(static_cast<uint32_t>(function.constants.size()));
+        for (uint64_t constant : function.constants) {
+            out.u64(constant);
+        }
+    }
+    out.u32(static_cast<uint32_t>(strings.size()));
+    for (const std::string& string : strings) {
+        out.string(string);
+    }
+    out.u32(static_cast<uint32_t>(code.size()));
+    out.data.append(reinterpret_cast<const char*>(code.data()), code.size() * sizeof(uint32_t));
+    uint64_t checksum = llvm::xxHash64(llvm::StringRef(out.data).substr(headerSize));
+    std::memcpy(&out.data[sizeof magic], &checksum, sizeof checksum);
+    return std::move(out.data);
+}
+
+std::optional<Bytecode> Bytecode::deserialize(std::string_view data) {
+    if (data.size() < headerSize || std::memcmp(data.data(), magic, sizeof magic) != 0) {
+        return std::nullopt;
+    }
+    uint64_t checksum = 0;
+    std::memcpy(&checksum, data.data() + sizeof magic, sizeof checksum);
+    data.remove_prefix(headerSize);
+    if (llvm::xxHash64(llvm::StringRef(data.data(), data.size())) != checksum) {
+        return std::nullopt;
+    }
+    Reader in(data);
+    Bytecode bytecode;
+
+    bytecode.functions.resize(in.count(6 * sizeof(uint32_t)));
+    for (BytecodeFunction& function : bytecode.functions) {
+        function.name = in.string();
+        function.params = in.u32();
+        function.variables = in.u32();
+        function.registers = in.u32();
+        function.entry = in.u32();
+        function.length = in.u32();
+        function.constants.resize(in.count(sizeof(uint64_t)));
+        for (uint64_t& constant : function.constants) {
+            constant = in.u64();
+        }
+    }
+    bytecode.strings.resize(in.count(sizeof(uint32_t)));
+    for (std::string& string : bytecode.strings) {
+        string = in.string();
+    }
+    bytecode.code.resize(in.count(sizeof(uint32_t)));
+    for (uint32_t& word : bytecode.code) {
+        word = in.u32();
+    }
+
+    if (!in.ok() || !in.atEnd() || !bytecode.verify()) {
+        return std::nullopt;
+    }
+    return bytecode;
+}
+
+bool Bytecode::verify() const {
+    if (functions.empty()) {
+        return false;
+    }
+    for (const BytecodeFunction& function : functions) {
+        uint64_t end = uint64_t(function.entry) + function.length;
+        if (function.length == 0 || end > code.size() || function.params > function.variables ||
+            uint64_t(function.variables) + function.constants.size() > function.registers ||
+            function.registers > maxRegisters) {
+            return false;
+        }
+
+        // First pass finds where instructions start, so jumps can be checked
+        std::vector<bool> starts(function.length);
+        Op last = Op::Count;
+        for (uint32_t pc = function.entry; pc < end;) {
+            if (code[pc] >= static_cast<uint32_t>(Op::Count)) {
+                return false;
+            }
+            last = static_cast<Op>(code[pc]);
+            starts[pc - function.entry] = true;
+            pc += 1 + static_cast<uint32_t>(std::strlen(operandKinds(last)));
+            if (pc > end) {
+                return false;
+            }
+        }
+        // Running off the end of a function is never valid
+        if (last != Op::Return && last != Op::Jump && last != Op::TailCall) {
+            return false;
+        }
+
+        for (uint32_t pc = function.entry; pc < end;) {
+            Op op = static_cast<Op>(code[pc]);
+            const char* kinds = operandKinds(op);
+            for (size_t i = 0; kinds[i]; ++i) {
+                uint32_t operand = code[pc + 1 + i];
+                bool valid = false;
+                switch (kinds[i]) {
+                    case 'r': valid = operand < function.registers; break;
+                    case 's': valid = operand < strings.size(); break;
+                    case 'f': valid = operand < functions.size(); break;
+                    case 'j':
+                        valid = operand >= function.entry && operand < end && starts[operand - function.entry];
+                        break;
+                }
+                if (!valid) {
+                    return false;
+                }
+            }
+            // Arguments are a run of registers starting at the last operand
+            if (op == Op::Call || op == Op::TailCall) {
+                const BytecodeFunction& callee = functions[code[pc + (op == Op::Call ? 2 : 1)]];
+                uint32_t first = code[pc + std::strlen(kinds)];
+                if (uint64_t(first) + callee.params > function.registers) {
+                    return false;
+                }
+            }
+            pc += 1 + static_cast<uint32_t>(std::strlen(kinds));
+        }
+    }
+    return true;
+}
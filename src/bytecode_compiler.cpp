@@ -0,0 +1,875 @@
+#include "bytecode.h"
+#include "ast_visitor.h"
+#include "parallel_loop.h"
+#include "types.h"
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace {
+    // While a function is compiled, constants and temporaries are numbered
+    // separately from the variables; they move above the variables once
+    // the function is done and the counts are known
+    constexpr uint32_t constantTag = 1u << 30;
+    constexpr uint32_t temporaryTag = 1u << 31;
+    constexpr size_t none = SIZE_MAX;
+
+    // Operand of each comparison variant, see BYTECODE_COMPARISON_OPS
+    enum class Variant : uint32_t { Compare, Jump, JumpNot, AddJump };
+    static_assert(static_cast<uint32_t>(Op::LeI) == static_cast<uint32_t>(Op::LtI) + 8 &&
+                      static_cast<uint32_t>(Op::AddJumpNeD) == static_cast<uint32_t>(Op::LtI) + 47,
+                  "comparison ops must come in families of eight");
+
+    struct Operand {
+        uint32_t reg = 0;
+        ValueType type = ValueType::Double;
+        size_t definedAt = none;             // Instruction that computed it, if a temporary
+        std::optional<int64_t> intConstant{};  // Integer literals, so conversions fold
+        std::optional<std::string_view> literal{};  // String literals, loaded when used as values
+    };
+
+    struct FunctionBuilder {
+        const FunctionTypes* types = nullptr;
+        std::vector<uint32_t> code;
+        std::unordered_map<std::string_view, uint32_t> variables;
+        uint32_t variableCount = 0;
+        std::vector<uint64_t> constants;
+        std::unordered_map<int64_t, uint32_t> intConstants;
+        std::unordered_map<uint64_t, uint32_t> doubleConstants;
+        uint32_t temporaries = 0;
+        uint32_t maxTemporaries = 0;
+        size_t lastInstruction = none;
+        size_t lastLabel = none;             // Latest offset a jump targets
+    };
+
+    std::optional<uint32_t> comparisonIndex(AST::BinaryOp op) {
+        switch (op) {
+            case AST::BinaryOp::Less: return 0;
+            case AST::BinaryOp::LessEqual: return 1;
+            case AST::BinaryOp::Greater: return 2;
+            case AST::BinaryOp::GreaterEqual: return 3;
+            case AST::BinaryOp::Equal: return 4;
+            case AST::BinaryOp::NotEqual: return 5;
+            default: return std::nullopt;
+        }
+    }
+
+    Op comparisonOp(uint32_t comparison, Variant variant, bool isDouble) {
+        return static_cast<Op>(static_cast<uint32_t>(Op::LtI) + comparison * 8 +
+                               static_cast<uint32_t>(variant) * 2 + (isDouble ? 1 : 0));
+    }
+
+    // Walks the AST once, in CodeGen's order, so the first error reported
+    // is the one CodeGen would report
+    class BytecodeCompiler : public AST::Visitor<BytecodeCompiler, Operand, void> {
+    public:
+        Bytecode compile(AST::ProgramAST* program) {
+            for (AST::StmtAST* declaration : program->getDeclarations()) {
+                if (auto bruh = AST::dyn_cast<AST::BruhAST>(declaration)) {
+                    auto index = static_cast<uint32_t>(bytecode.functions.size());
+                    if (!functionIndex.emplace(bruh->getName(), index).second) {
+                        throw std::runtime_error("Function already defined: " + std::string(bruh->getName()));
+                    }
+                    bytecode.functions.emplace_back();
+                    bytecode.functions.back().name = std::string(bruh->getName());
+                    bytecode.functions.back().params = static_cast<uint32_t>(bruh->getParams().size());
+                }
+            }
+            bytecode.functions.emplace_back();
+            bytecode.functions.back().name = "main";
+            builders.resize(bytecode.functions.size());
+
+            // Registers of variables hold the inferred type's representation
+            types = inferTypes(program);
+            for (size_t i = 0; i + 1 < builders.size(); ++i) {
+                builders[i].types = &types.functions.find(bytecode.functions[i].name)->second;
+            }
+            builders.back().types = &types.main;
+
+            // The cook block and other top-level statements form main
+            for (AST::StmtAST* declaration : program->getDeclarations()) {
+                if (auto bruh = AST::dyn_cast<AST::BruhAST>(declaration)) {
+                    compileFunction(bruh);
+                } else {
+                    function = &builders.back();
+                    statement(declaration);
+                }
+            }
+            function = &builders.back();
+            emit(Op::Return, {doubleConstant(0.0)});
+
+            assemble();
+            return std::move(bytecode);
+        }
+
+        Operand visitNumber(AST::NumberExprAST* expr) {
+            if (expr->isFloatingPoint()) {
+                return {doubleConstant(expr->getDoubleValue()), ValueType::Double};
+            }
+            Operand operand{intConstant(expr->getIntValue()), ValueType::Int};
+            operand.intConstant = expr->getIntValue();
+            return operand;
+        }
+
+        Operand visitString(AST::StringExprAST* expr) {
+            Operand operand{0, ValueType::String};
+            operand.literal = expr->getValue();
+            return operand;
+        }
+
+        Operand visitVariable(AST::VariableExprAST* expr) {
+            auto it = function->variables.find(expr->getName());
+            if (it == function->variables.end()) {
+                throw std::runtime_error("Unknown variable name: " + std::string(expr->getName()));
+            }
+            return {it->second, function->types->variable(expr->getName())};
+        }
+
+        Operand visitBinary(AST::BinaryExprAST* expr) {
+            using AST::BinaryOp;
+            BinaryOp op = expr->getOp();
+            if (op == BinaryOp::And || op == BinaryOp::Or) {
+                return logical(expr);
+            }
+
+            Operand L = visit(expr->getLHS());
+            Operand R = visit(expr->getRHS());
+            if (L.type == ValueType::String || R.type == ValueType::String) {
+                return stringBinary(op, L, R);
+            }
+            requireNumber(L);
+            requireNumber(R);
+            // As in CodeGen: doubles if either side is one, and / always
+            bool isDouble = L.type == ValueType::Double || R.type == ValueType::Double || op == BinaryOp::Div;
+            if (isDouble) {
+                L = asDouble(L);
+                R = asDouble(R);
+            }
+
+            Op instruction;
+            ValueType result = isDouble ? ValueType::Double : ValueType::Int;
+            if (auto comparison = comparisonIndex(op)) {
+                instruction = comparisonOp(*comparison, Variant::Compare, isDouble);
+                result = ValueType::Bool;
+            } else {
+                switch (op) {
+                    case BinaryOp::Add: instruction = isDouble ? Op::AddD : Op::AddI; break;
+                    case BinaryOp::Sub: instruction = isDouble ? Op::SubD : Op::SubI; break;
+                    case BinaryOp::Mul: instruction = isDouble ? Op::MulD : Op::MulI; break;
+                    case BinaryOp::Div: instruction = Op::DivD; break;
+                    case BinaryOp::Mod: instruction = isDouble ? Op::ModD : Op::ModI; break;
+                    default: throw std::runtime_error("Invalid binary operator");
+                }
+            }
+            uint32_t dst = temporary();
+            return {dst, result, emit(instruction, {dst, L.reg, R.reg})};
+        }
+
+        Operand visitUnary(AST::UnaryExprAST* expr) {
+            Operand operand = visit(expr->getOperand());
+            requireNumber(operand);
+            if (expr->getOp() == AST::UnaryOp::Not) {
+                Operand value = toBool(operand);
+                uint32_t dst = temporary();
+                return {dst, ValueType::Bool, emit(Op::Not, {dst, value.reg})};
+            }
+            // Negating an i1 gives the same i1
+            if (operand.type == ValueType::Bool) {
+                return operand;
+            }
+            uint32_t dst = temporary();
+            bool isDouble = operand.type == ValueType::Double;
+            return {dst, operand.type, emit(isDouble ? Op::NegD : Op::NegI, {dst, operand.reg})};
+        }
+
+        Operand visitCall(AST::CallExprAST* expr) {
+            if (expr->getCallee() == "yap") {
+                // Evaluates to the number of characters printed, like printf
+                std::vector<Operand> values = printArguments(expr->getArgs());
+                uint32_t dst = temporary();
+                emit(Op::TakePrinted, {dst});
+                for (const Operand& value : values) {
+                    switch (value.type) {
+                        case ValueType::String: print(value); break;
+                        case ValueType::Double: emit(Op::PrintFloat, {value.reg}); break;
+                        default: emit(Op::PrintInt, {value.reg}); break;
+                    }
+                }
+                emit(Op::PrintNewline, {});
+                return {dst, ValueType::Int, emit(Op::TakePrinted, {dst})};
+            }
+
+            // squad(n): n zeroes
+            if (expr->getCallee() == "squad") {
+                if (expr->getArgs().size() != 1) {
+                    throw std::runtime_error("squad expects 1 argument, got " +
+                                             std::to_string(expr->getArgs().size()));
+                }
+                Operand length = toIndex(visit(expr->getArgs()[0]));
+                uint32_t dst = temporary();
+                return {dst, function->types->squad(expr), emit(Op::NewSquad, {dst, length.reg})};
+            }
+
+            // min(a, b): a, replaced by b if b < a; max likewise
+            if (isMinMax(types, expr->getCallee())) {
+                if (expr->getArgs().size() != 2) {
+                    throw std::runtime_error(std::string(expr->getCallee()) + " expects 2 arguments, got " +
+                                             std::to_string(expr->getArgs().size()));
+                }
+                Operand a = stable(visit(expr->getArgs()[0]));
+                Operand b = visit(expr->getArgs()[1]);
+                requireNumber(a);
+                requireNumber(b);
+                bool isDouble = a.type == ValueType::Double || b.type == ValueType::Double;
+                if (isDouble) {
+                    a = asDouble(a);
+                    b = asDouble(b);
+                }
+                uint32_t dst = temporary();
+                emit(Op::Move, {dst, a.reg});
+                uint32_t comparison = *comparisonIndex(expr->getCallee() == "min" ? AST::BinaryOp::Less
+                                                                                  : AST::BinaryOp::Greater);
+                size_t keep = emit(comparisonOp(comparison, Variant::JumpNot, isDouble), {b.reg, a.reg, 0});
+                emit(Op::Move, {dst, b.reg});
+                patch(keep);
+                return {dst, isDouble ? ValueType::Double : ValueType::Int};
+            }
+
+            auto [callee, first] = arguments(expr);
+            uint32_t dst = temporary();
+            return {dst, builders[callee].types->result, emit(Op::Call, {dst, callee, first})};
+        }
+
+        Operand visitGrouping(AST::GroupingExprAST* expr) {
+            return visit(expr->getExpression());
+        }
+
+        Operand visitAssign(AST::AssignExprAST* expr) {
+            Operand value = visit(expr->getValue());
+            auto it = function->variables.find(expr->getName());
+            if (it == function->variables.end()) {
+                throw std::runtime_error("Undefined variable: " + std::string(expr->getName()));
+            }
+            ValueType type = function->types->variable(expr->getName());
+            storeTo(value, it->second, type);
+            return {it->second, type};
+        }
+
+        // Squad literals: [a, b, c]
+        Operand visitSquad(AST::SquadExprAST* expr) {
+            ValueType type = function->types->squad(expr);
+            std::vector<Operand> elements;
+            for (AST::ExprAST* element : expr->getElements()) {
+                elements.push_back(stable(convert(visit(element), elementType(type))));
+            }
+            uint32_t dst = temporary();
+            size_t definedAt = emit(Op::NewSquad, {dst, intConstant(static_cast<int64_t>(elements.size()))});
+            for (size_t i = 0; i < elements.size(); ++i) {
+                emit(Op::SquadSet, {dst, intConstant(static_cast<int64_t>(i)), elements[i].reg});
+            }
+            // Only a squad with no elements may be written straight to a variable
+            return {dst, type, elements.empty() ? definedAt : none};
+        }
+
+        Operand visitIndex(AST::IndexExprAST* expr) {
+            Operand index = toIndex(visit(expr->getIndex()));
+            Operand squad = squadVariable(expr->getName());
+            uint32_t dst = temporary();
+            return {dst, elementType(squad.type), emit(Op::SquadGet, {dst, squad.reg, index.reg})};
+        }
+
+        Operand visitIndexAssign(AST::IndexAssignExprAST* expr) {
+            Operand index = stable(toIndex(visit(expr->getIndex())));
+            Operand value = visit(expr->getValue());
+            Operand squad = squadVariable(expr->getName());
+            value = convert(value, elementType(squad.type));
+            emit(Op::SquadSet, {squad.reg, index.reg, value.reg});
+            return value;
+        }
+
+        Operand visitLength(AST::LengthExprAST* expr) {
+            auto it = function->variables.find(expr->getName());
+            if (it == function->variables.end()) {
+                throw std::runtime_error("Unknown variable name: " + std::string(expr->getName()));
+            }
+            ValueType type = function->types->variable(expr->getName());
+            if (type != ValueType::String && !isSquad(type)) {
+                throw std::runtime_error("'" + std::string(expr->getName()) + "' is not a squad or a string");
+            }
+            uint32_t dst = temporary();
+            Op op = type == ValueType::String ? Op::StringLength : Op::SquadLength;
+            return {dst, ValueType::Int, emit(op, {dst, it->second})};
+        }
+
+        void visitYoink(AST::YoinkStmtAST* stmt) {
+            Operand index = stable(toIndex(visit(stmt->getIndex())));
+            Operand value = visit(stmt->getValue());
+            Operand squad = squadVariable(stmt->getName());
+            value = convert(value, elementType(squad.type));
+            emit(Op::SquadInsert, {squad.reg, index.reg, value.reg});
+        }
+
+        void visitYeet(AST::YeetStmtAST* stmt) {
+            Operand index = toIndex(visit(stmt->getIndex()));
+            Operand squad = squadVariable(stmt->getName());
+            emit(Op::SquadRemove, {squad.reg, index.reg});
+        }
+
+        void visitYap(AST::YapStmtAST* stmt) {
+            std::vector<Operand> values = printArguments(stmt->getArgs());
+            for (const Operand& value : values) {
+                switch (value.type) {
+                    case ValueType::Double: emit(Op::PrintDouble, {value.reg}); break;
+                    case ValueType::String: print(value); break;
+                    default: emit(Op::PrintInt, {value.reg}); break;
+                }
+            }
+            emit(Op::PrintNewline, {});
+        }
+
+        void visitSus(AST::SusStmtAST* stmt) {
+            size_t skipThen = conditionalJump(stmt->getCondition(), false);
+            for (AST::StmtAST* thenStmt : stmt->getThenBlock()) {
+                statement(thenStmt);
+            }
+            if (stmt->getElseBlock().empty()) {
+                patch(skipThen);
+                return;
+            }
+            size_t skipElse = emit(Op::Jump, {0});
+            patch(skipThen);
+            for (AST::StmtAST* elseStmt : stmt->getElseBlock()) {
+                statement(elseStmt);
+            }
+            patch(skipElse);
+        }
+
+        // The condition is tested once on entry and again at the bottom of
+        // each iteration, so the loop itself has a single back-edge branch
+        // A goated bet runs its iterations in order, as the interpreter does
+        void visitBet(AST::BetStmtAST* stmt) {
+            if (stmt->getInit()) {
+                statement(stmt->getInit());
+            }
+            if (stmt->isParallel()) {
+                analyzeParallelLoop(stmt, types, *function->types);
+            }
+            size_t exit = none;
+            if (stmt->getCondition()) {
+                uint32_t saved = function->temporaries;
+                exit = conditionalJump(stmt->getCondition(), false);
+                function->temporaries = saved;
+            }
+
+            auto top = static_cast<uint32_t>(here());
+            function->lastLabel = top;
+            for (AST::StmtAST* bodyStmt : stmt->getBody()) {
+                statement(bodyStmt);
+            }
+            if (stmt->getIncrement()) {
+                statement(stmt->getIncrement());
+            }
+
+            if (stmt->getCondition()) {
+                uint32_t saved = function->temporaries;
+                backEdge(stmt->getCondition(), top);
+                function->temporaries = saved;
+            } else {
+                emit(Op::Jump, {top});
+            }
+            if (exit != none) {
+                patch(exit);
+            }
+        }
+
+        void visitBruh(AST::BruhAST* bruh) {
+            throw std::runtime_error("Function '" + std::string(bruh->getName()) +
+                                     "' must be declared at the top level");
+        }
+
+        void visitSigma(AST::SigmaAST*) {}
+
+        void visitCook(AST::CookAST* cook) {
+            for (AST::StmtAST* stmt : cook->getBody()) {
+                statement(stmt);
+            }
+        }
+
+        void visitExprStmt(AST::ExprStmtAST* stmt) {
+            visit(stmt->getExpr());
+        }
+
+        // Redeclaring a name reuses its register, as CodeGen's allocas do
+        void visitVarDecl(AST::VarDeclStmtAST* stmt) {
+            Operand value = visit(stmt->getInitializer());
+            auto [it, inserted] = function->variables.try_emplace(stmt->getName(), function->variableCount);
+            if (inserted) {
+                ++function->variableCount;
+            }
+            storeTo(value, it->second, function->types->variable(stmt->getName()));
+        }
+
+        // main returns a double, which VM::run turns into the exit code
+        void visitSolulu(AST::SoluluStmtAST* stmt) {
+            bool isMain = function == &builders.back();
+            ValueType resultType = isMain ? ValueType::Double : function->types->result;
+            AST::ExprAST* value = stmt->getValue();
+            if (!value) {
+                emit(Op::Return, {defaultValue(resultType)});
+                return;
+            }
+            // A returned call reuses the frame, so recursion through solulu
+            // runs in constant space. The result must need no conversion.
+            auto call = AST::dyn_cast<AST::CallExprAST>(value);
+            auto callee = call ? functionIndex.find(call->getCallee()) : functionIndex.end();
+            if (!isMain && callee != functionIndex.end() && builders[callee->second].types->result == resultType) {
+                auto [index, first] = arguments(call);
+                emit(Op::TailCall, {index, first});
+                return;
+            }
+            Operand result = visit(value);
+            if (isMain && (result.type == ValueType::String || isSquad(result.type))) {
+                throw std::runtime_error("solulu can only return a number");
+            }
+            emit(Op::Return, {convert(result, resultType).reg});
+        }
+
+    private:
+        Bytecode bytecode;
+        std::vector<FunctionBuilder> builders;  // Parallel to bytecode.functions
+        std::unordered_map<std::string_view, uint32_t> functionIndex;
+        std::unordered_map<std::string_view, uint32_t> strings;
+        FunctionBuilder* function = nullptr;
+        ProgramTypes types;
+
+        void compileFunction(AST::BruhAST* bruh) {
+            function = &builders[functionIndex.find(bruh->getName())->second];
+            // A repeated parameter name refers to the last one, as in CodeGen
+            for (std::string_view param : bruh->getParams()) {
+                function->variables[param] = function->variableCount++;
+            }
+            for (AST::StmtAST* stmt : bruh->getBody()) {
+                statement(stmt);
+            }
+            // Falling off the end returns 0, the empty string or an empty squad
+            emit(Op::Return, {defaultValue(function->types->result)});
+        }
+
+        // Temporaries live until the end of the statement that needs them
+        void statement(AST::StmtAST* stmt) {
+            uint32_t saved = function->temporaries;
+            visit(stmt);
+            function->temporaries = saved;
+        }
+
+        size_t here() const { return function->code.size(); }
+
+        size_t emit(Op op, std::initializer_list<uint32_t> operands) {
+            size_t start = here();
+            function->code.push_back(static_cast<uint32_t>(op));
+            function->code.insert(function->code.end(), operands);
+            function->lastInstruction = start;
+            return start;
+        }
+
+        // Points a forward jump (its target is always the last operand) here
+        void patch(size_t jump) {
+            size_t operands = std::strlen(operandKinds(static_cast<Op>(function->code[jump])));
+            function->code[jump + operands] = static_cast<uint32_t>(here());
+            function->lastLabel = here();
+        }
+
+        uint32_t temporary() {
+            uint32_t index = function->temporaries++;
+            if (function->temporaries > function->maxTemporaries) {
+                function->maxTemporaries = function->temporaries;
+            }
+            return index | temporaryTag;
+        }
+
+        uint32_t intConstant(int64_t value) {
+            auto [it, inserted] = function->intConstants.try_emplace(
+                value, static_cast<uint32_t>(function->constants.size()));
+            if (inserted) {
+                function->constants.push_back(static_cast<uint64_t>(value));
+            }
+            return it->second | constantTag;
+        }
+
+        uint32_t doubleConstant(double value) {
+            uint64_t bits;
+            std::memcpy(&bits, &value, sizeof bits);
+            auto [it, inserted] = function->doubleConstants.try_emplace(
+                bits, static_cast<uint32_t>(function->constants.size()));
+            if (inserted) {
+                function->constants.push_back(bits);
+            }
+            return it->second | constantTag;
+        }
+
+        uint32_t zero(ValueType type) {
+            return type == ValueType::Double ? doubleConstant(0.0) : intConstant(0);
+        }
+
+        // Squads are references, so a squad result is a new empty one; the
+        // word 0 is the empty string
+        uint32_t defaultValue(ValueType type) {
+            if (!isSquad(type)) {
+                return zero(type);
+            }
+            uint32_t dst = temporary();
+            emit(Op::NewSquad, {dst, intConstant(0)});
+            return dst;
+        }
+
+        uint32_t stringIndex(std::string_view value) {
+            auto [it, inserted] = strings.try_emplace(value, static_cast<uint32_t>(bytecode.strings.size()));
+            if (inserted) {
+                bytecode.strings.emplace_back(value);
+            }
+            return it->second;
+        }
+
+        // A string in a register: literals are loaded from the string table
+        Operand loadString(const Operand& value) {
+            if (!value.literal) {
+                return value;
+            }
+            uint32_t dst = temporary();
+            return {dst, ValueType::String, emit(Op::LoadString, {dst, stringIndex(*value.literal)})};
+        }
+
+        // A string, or a number as yap prints it
+        Operand toStringOperand(const Operand& value) {
+            if (value.type == ValueType::String) {
+                return loadString(value);
+            }
+            requireNumber(value);
+            uint32_t dst = temporary();
+            Op op = value.type == ValueType::Double ? Op::DoubleToString : Op::IntToString;
+            return {dst, ValueType::String, emit(op, {dst, value.reg})};
+        }
+
+        // Literal text prints straight from the string table
+        void print(const Operand& string) {
+            if (string.literal) {
+                emit(Op::PrintString, {stringIndex(*string.literal)});
+            } else {
+                emit(Op::PrintStr, {string.reg});
+            }
+        }
+
+        // As CodeGen::generateStringBinary: + appends, and two strings compare
+        Operand stringBinary(AST::BinaryOp op, const Operand& L, const Operand& R) {
+            if (op == AST::BinaryOp::Add) {
+                Operand left = toStringOperand(L);
+                Operand right = toStringOperand(R);
+                uint32_t dst = temporary();
+                return {dst, ValueType::String, emit(Op::ConcatS, {dst, left.reg, right.reg})};
+            }
+            std::optional<uint32_t> comparison = comparisonIndex(op);
+            if (!comparison) {
+                throw std::runtime_error("Expected a number, got a string");
+            }
+            auto [order, zero] = stringOrder(L, R);
+            uint32_t dst = temporary();
+            return {dst, ValueType::Bool,
+                    emit(comparisonOp(*comparison, Variant::Compare, false), {dst, order.reg, zero.reg})};
+        }
+
+        // Two strings compare as their order does with 0
+        std::pair<Operand, Operand> stringOrder(const Operand& L, const Operand& R) {
+            if (L.type != R.type) {
+                throw std::runtime_error("Expected a number, got a string");
+            }
+            Operand left = loadString(L);
+            Operand right = loadString(R);
+            uint32_t dst = temporary();
+            Operand order{dst, ValueType::Int, emit(Op::CompareS, {dst, left.reg, right.reg})};
+            return std::make_pair(order, Operand{intConstant(0), ValueType::Int});
+        }
+
+        // Integers and truth values convert like CodeGen's sitofp/uitofp;
+        // literals convert at compile time
+        Operand asDouble(const Operand& value) {
+            requireNumber(value);
+            switch (value.type) {
+                case ValueType::Double: return value;
+                case ValueType::Unknown:
+                case ValueType::Int:
+                case ValueType::Bool: {
+                    if (value.intConstant) {
+                        return {doubleConstant(static_cast<double>(*value.intConstant)), ValueType::Double};
+                    }
+                    uint32_t dst = temporary();
+                    return {dst, ValueType::Double, emit(Op::IntToDouble, {dst, value.reg})};
+                }
+                default: return value;  // Not reached, requireNumber threw
+            }
+        }
+
+        Operand toBool(const Operand& value) {
+            requireNumber(value);
+            switch (value.type) {
+                case ValueType::Bool: return value;
+                case ValueType::Unknown:
+                case ValueType::Int:
+                case ValueType::Double: {
+                    uint32_t dst = temporary();
+                    Op op = value.type == ValueType::Double ? Op::DoubleToBool : Op::IntToBool;
+                    return {dst, ValueType::Bool, emit(op, {dst, value.reg})};
+                }
+                default: return value;  // Not reached, requireNumber threw
+            }
+        }
+
+        void requireNumber(const Operand& value) {
+            if (value.type == ValueType::String) {
+                throw std::runtime_error("Expected a number, got a string");
+            }
+            if (isSquad(value.type)) {
+                throw std::runtime_error("Expected a number, got a squad");
+            }
+        }
+
+        // Squad indices are integers; doubles are truncated
+        Operand toIndex(const Operand& value) {
+            requireNumber(value);
+            if (value.type != ValueType::Double) {
+                return value;
+            }
+            uint32_t dst = temporary();
+            return {dst, ValueType::Int, emit(Op::DoubleToInt, {dst, value.reg})};
+        }
+
+        // The register of a squad variable, checked as CodeGen::loadSquad does
+        Operand squadVariable(std::string_view name) {
+            auto it = function->variables.find(name);
+            if (it == function->variables.end()) {
+                throw std::runtime_error("Unknown variable name: " + std::string(name));
+            }
+            ValueType type = function->types->variable(name);
+            if (!isSquad(type)) {
+                throw std::runtime_error("'" + std::string(name) + "' is not a squad");
+            }
+            return {it->second, type};
+        }
+
+        // A value that later operands cannot change: variables are copied,
+        // since a later operand may assign to them
+        Operand stable(Operand value) {
+            if (!value.literal && !(value.reg & (constantTag | temporaryTag))) {
+                uint32_t copy = temporary();
+                emit(Op::Move, {copy, value.reg});
+                value.reg = copy;
+                value.definedAt = none;
+            }
+            return value;
+        }
+
+        // Converts a value for a register of the given type. Inferred types
+        // hold every value stored in them, so this only ever widens; truth
+        // values already are the integers 0 and 1. Squads only go to squads.
+        Operand convert(const Operand& value, ValueType type) {
+            if (type == ValueType::String) {
+                if (value.type != ValueType::String) {
+                    throw std::runtime_error(isSquad(value.type) ? "Expected a string, got a squad"
+                                                                 : "Expected a string, got a number");
+                }
+                return loadString(value);
+            }
+            if (isSquad(type)) {
+                if (!isSquad(value.type)) {
+                    throw std::runtime_error(value.type == ValueType::String ? "Expected a squad, got a string"
+                                                                             : "Expected a squad, got a number");
+                }
+                return value;
+            }
+            requireNumber(value);
+            switch (type) {
+                case ValueType::Double: return asDouble(value);
+                case ValueType::Bool: return toBool(value);
+                default: return value;
+            }
+        }
+
+        // Stores a value into a variable or argument register. A temporary
+        // the previous instruction just computed is written there directly.
+        void storeTo(const Operand& value, uint32_t dst, ValueType type) {
+            Operand number = convert(value, type);
+            if (number.reg == dst) {
+                return;
+            }
+            if ((number.reg & temporaryTag) && number.definedAt != none &&
+                number.definedAt == function->lastInstruction) {
+                function->code[number.definedAt + 1] = dst;
+                return;
+            }
+            emit(Op::Move, {dst, number.reg});
+        }
+
+        // Like CodeGen's printf call, every argument is evaluated before
+        // anything prints
+        std::vector<Operand> printArguments(const AST::ExprList& args) {
+            std::vector<Operand> values;
+            for (AST::ExprAST* arg : args) {
+                Operand value = visit(arg);
+                if (isSquad(value.type)) {
+                    throw std::runtime_error("yap cannot print a squad");
+                }
+                values.push_back(stable(value));
+            }
+            return values;
+        }
+
+        // Checks a call as CodeGen does and computes its arguments into
+        // consecutive registers. Returns the callee and the first register.
+        std::pair<uint32_t, uint32_t> arguments(AST::CallExprAST* call) {
+            auto it = functionIndex.find(call->getCallee());
+            if (it == functionIndex.end()) {
+                throw std::runtime_error("Unknown function: " + std::string(call->getCallee()));
+            }
+            uint32_t params = bytecode.functions[it->second].params;
+            const std::vector<ValueType>& paramTypes = builders[it->second].types->params;
+            if (params != call->getArgs().size()) {
+                throw std::runtime_error("Function '" + std::string(call->getCallee()) + "' expects " +
+                                         std::to_string(params) + " arguments, got " +
+                                         std::to_string(call->getArgs().size()));
+            }
+
+            // Even a call without arguments names a real register
+            uint32_t first = temporary();
+            for (size_t i = 1; i < params; ++i) {
+                temporary();
+            }
+            uint32_t index = 0;
+            for (AST::ExprAST* arg : call->getArgs()) {
+                Operand value = visit(arg);
+                storeTo(value, first + index, paramTypes[index]);
+                ++index;
+            }
+            return {it->second, first};
+        }
+
+        Operand logical(AST::BinaryExprAST* expr) {
+            bool isAnd = expr->getOp() == AST::BinaryOp::And;
+            uint32_t dst = temporary();
+            emit(Op::Move, {dst, toBool(visit(expr->getLHS())).reg});
+            size_t shortCircuit = emit(isAnd ? Op::JumpIfFalse : Op::JumpIfTrue, {dst, 0});
+            emit(Op::Move, {dst, toBool(visit(expr->getRHS())).reg});
+            patch(shortCircuit);
+            return {dst, ValueType::Bool};
+        }
+
+        // Comparison operands, converted the way visitBinary would; strings
+        // give their order and 0
+        std::pair<Operand, Operand> comparisonOperands(AST::BinaryExprAST* binary) {
+            Operand L = visit(binary->getLHS());
+            Operand R = visit(binary->getRHS());
+            if (L.type == ValueType::String || R.type == ValueType::String) {
+                return stringOrder(L, R);
+            }
+            requireNumber(L);
+            requireNumber(R);
+            if (L.type == ValueType::Double || R.type == ValueType::Double) {
+                L = asDouble(L);
+                R = asDouble(R);
+            }
+            return std::make_pair(L, R);
+        }
+
+        // Emits a jump taken when the condition is `when`, fusing it with a
+        // comparison when there is one. Returns the jump for patch().
+        size_t conditionalJump(AST::ExprAST* condition, bool when) {
+            auto binary = AST::dyn_cast<AST::BinaryExprAST>(condition);
+            std::optional<uint32_t> comparison = binary ? comparisonIndex(binary->getOp()) : std::nullopt;
+            if (comparison) {
+                auto [L, R] = comparisonOperands(binary);
+                Op op = comparisonOp(*comparison, when ? Variant::Jump : Variant::JumpNot,
+                                     L.type == ValueType::Double);
+                return emit(op, {L.reg, R.reg, 0});
+            }
+            Operand value = toBool(visit(condition));
+            return emit(when ? Op::JumpIfTrue : Op::JumpIfFalse, {value.reg, 0});
+        }
+
+        // The bottom test of a loop. When the increment just added to the
+        // variable the condition compares, both become one AddJump.
+        void backEdge(AST::ExprAST* condition, uint32_t top) {
+            size_t add = function->lastInstruction;
+            bool fusable = add != none && function->lastLabel != here() &&
+                           (function->code[add] == static_cast<uint32_t>(Op::AddI) ||
+                            function->code[add] == static_cast<uint32_t>(Op::AddD));
+
+            auto binary = AST::dyn_cast<AST::BinaryExprAST>(condition);
+            std::optional<uint32_t> comparison = binary ? comparisonIndex(binary->getOp()) : std::nullopt;
+            if (!comparison) {
+                size_t jump = conditionalJump(condition, true);
+                function->code[jump + 2] = top;
+                return;
+            }
+
+            size_t before = here();
+            auto [L, R] = comparisonOperands(binary);
+            bool isDouble = L.type == ValueType::Double;
+            std::vector<uint32_t>& code = function->code;
+            if (fusable && here() == before &&
+                (code[add] == static_cast<uint32_t>(Op::AddD)) == isDouble && code[add + 1] == L.reg &&
+                (code[add + 2] == L.reg || code[add + 3] == L.reg)) {
+                // a = a + b (or b + a) becomes: a += b, jump if a <cmp> c
+                uint32_t step = code[add + 2] == L.reg ? code[add + 3] : code[add + 2];
+                code[add] = static_cast<uint32_t>(comparisonOp(*comparison, Variant::AddJump, isDouble));
+                code[add + 2] = step;
+                code[add + 3] = R.reg;
+                code.push_back(top);
+                return;
+            }
+            emit(comparisonOp(*comparison, Variant::Jump, isDouble), {L.reg, R.reg, top});
+        }
+
+        // Lays the functions out one after another, moving constants and
+        // temporaries above the variables and making jumps absolute
+        void assemble() {
+            for (size_t i = 0; i < builders.size(); ++i) {
+                FunctionBuilder& builder = builders[i];
+                BytecodeFunction& info = bytecode.functions[i];
+                info.variables = builder.variableCount;
+                info.constants = std::move(builder.constants);
+                uint32_t constantBase = info.variables;
+                uint32_t temporaryBase = constantBase + static_cast<uint32_t>(info.constants.size());
+                if (uint64_t(temporaryBase) + builder.maxTemporaries > maxRegisters) {
+                    throw std::runtime_error("Function '" + info.name + "' needs more than " +
+                                             std::to_string(maxRegisters) + " registers");
+                }
+                info.registers = temporaryBase + builder.maxTemporaries;
+                info.entry = static_cast<uint32_t>(bytecode.code.size());
+                info.length = static_cast<uint32_t>(builder.code.size());
+
+                std::vector<uint32_t>& code = builder.code;
+                for (size_t pc = 0; pc < code.size();) {
+                    const char* kinds = operandKinds(static_cast<Op>(code[pc]));
+                    for (size_t k = 0; kinds[k]; ++k) {
+                        uint32_t& operand = code[pc + 1 + k];
+                        if (kinds[k] == 'j') {
+                            operand += info.entry;
+                        } else if (kinds[k] == 'r' && (operand & temporaryTag)) {
+                            operand = temporaryBase + (operand & ~temporaryTag);
+                        } else if (kinds[k] == 'r' && (operand & constantTag)) {
+                            operand = constantBase + (operand & ~constantTag);
+                        }
+                    }
+                    pc += 1 + std::strlen(kinds);
+                }
+                bytecode.code.insert(bytecode.code.end(), code.begin(), code.end());
+            }
+        }
+    };
+}
+
+Bytecode compileBytecode(AST::ProgramAST* program) {
+    return BytecodeCompiler().compile(program);
+}
@@ -1,4 +1,6 @@
 #include "codegen.h"
+#include "brainrot_rt.h"
+#include "parallel_loop.h"
 #include <iostream>
 #include <llvm/Support/TargetSelect.h>
 #include <llvm/Support/InitLLVM.h>
@@ -8,12 +10,156 @@
 #include <llvm/Support/raw_ostream.h>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/LLVMContext.h>
+#include <llvm/IR/MDBuilder.h>
 #include <llvm/IR/Module.h>
 #include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/Orc/CompileUtils.h>
+#include <llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h>
+#include <llvm/IR/LLVMRemarkStreamer.h>
+#include <llvm/IR/PassInstrumentation.h>
+#include <llvm/Passes/OptimizationLevel.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Support/Program.h>
+#include <algorithm>
+#include <cstdio>
 #include <functional>
 #include <map>
+#include <set>
 
-CodeGen::CodeGen() {
+namespace {
+    // The runtime is linked into the compiler, and compiled code finds it
+    // here rather than through the process's dynamic symbols
+    const std::pair<const char*, void*> runtimeSymbols[] = {
+        {"brainrot_print_int", reinterpret_cast<void*>(&brainrot_print_int)},
+        {"brainrot_print_double", reinterpret_cast<void*>(&brainrot_print_double)},
+        {"brainrot_print_string", reinterpret_cast<void*>(&brainrot_print_string)},
+        {"brainrot_print_str", reinterpret_cast<void*>(&brainrot_print_str)},
+        {"brainrot_flush", reinterpret_cast<void*>(&brainrot_flush)},
+        {"brainrot_string_length", reinterpret_cast<void*>(&brainrot_string_length)},
+        {"brainrot_string_concat", reinterpret_cast<void*>(&brainrot_string_concat)},
+        {"brainrot_string_from_int", reinterpret_cast<void*>(&brainrot_string_from_int)},
+        {"brainrot_string_from_double", reinterpret_cast<void*>(&brainrot_string_from_double)},
+        {"brainrot_string_equal", reinterpret_cast<void*>(&brainrot_string_equal)},
+        {"brainrot_string_compare", reinterpret_cast<void*>(&brainrot_string_compare)},
+        {"brainrot_parallel_workers", reinterpret_cast<void*>(&brainrot_parallel_workers)},
+        {"brainrot_parallel_for", reinterpret_cast<void*>(&brainrot_parallel_for)},
+    };
+
+    // The text of a string literal, possibly in parentheses
+    std::optional<std::string_view> literalText(AST::ExprAST* expr) {
+        while (auto grouping = AST::dyn_cast<AST::GroupingExprAST>(expr)) {
+            expr = grouping->getExpression();
+        }
+        if (auto string = AST::dyn_cast<AST::StringExprAST>(expr)) {
+            return string->getValue();
+        }
+        return std::nullopt;
+    }
+
+    llvm::CodeGenOpt::Level codeGenOptLevel(unsigned optLevel) {
+        switch (optLevel) {
+            case 0: return llvm::CodeGenOpt::None;
+            case 1: return llvm::CodeGenOpt::Less;
+            case 2: return llvm::CodeGenOpt::Default;
+            default: return llvm::CodeGenOpt::Aggressive;
+        }
+    }
+
+    // Collects the names a function body assigns to, so parameters that
+    // are never written can stay in registers, and what a loop body does
+    // that decides whether its bounds checks can be hoisted
+    class AssignmentFinder : public AST::Visitor<AssignmentFinder> {
+    public:
+        explicit AssignmentFinder(const ProgramTypes& program) : program(program) {}
+
+        std::set<std::string_view> names;
+        std::set<std::string_view> declared;
+        std::vector<std::pair<std::string_view, AST::ExprAST*>> indexed;  // Squad and index
+        bool calls = false;    // Calls a bruh, which may resize any squad
+        bool resizes = false;  // Has a yoink or yeet
+
+        void visitBody(const AST::StmtList& body) {
+            for (AST::StmtAST* stmt : body) visit(stmt);
+        }
+
+        void visitNumber(AST::NumberExprAST*) {}
+        void visitString(AST::StringExprAST*) {}
+        void visitVariable(AST::VariableExprAST*) {}
+        void visitBinary(AST::BinaryExprAST* expr) { visit(expr->getLHS()); visit(expr->getRHS()); }
+        void visitUnary(AST::UnaryExprAST* expr) { visit(expr->getOperand()); }
+        void visitCall(AST::CallExprAST* expr) {
+            calls |= expr->getCallee() != "yap" && expr->getCallee() != "squad" &&
+                     !isMinMax(program, expr->getCallee());
+            for (AST::ExprAST* arg : expr->getArgs()) visit(arg);
+        }
+        void visitGrouping(AST::GroupingExprAST* expr) { visit(expr->getExpression()); }
+        void visitAssign(AST::AssignExprAST* expr) {
+            names.insert(expr->getName());
+            visit(expr->getValue());
+        }
+        void visitSquad(AST::SquadExprAST* expr) {
+            for (AST::ExprAST* element : expr->getElements()) visit(element);
+        }
+        void visitIndex(AST::IndexExprAST* expr) {
+            indexed.emplace_back(expr->getName(), expr->getIndex());
+            visit(expr->getIndex());
+        }
+        void visitIndexAssign(AST::IndexAssignExprAST* expr) {
+            indexed.emplace_back(expr->getName(), expr->getIndex());
+            visit(expr->getIndex());
+            visit(expr->getValue());
+        }
+        void visitLength(AST::LengthExprAST*) {}
+
+        void visitYap(AST::YapStmtAST* stmt) {
+            for (AST::ExprAST* arg : stmt->getArgs()) visit(arg);
+        }
+        void visitSus(AST::SusStmtAST* stmt) {
+            visit(stmt->getCondition());
+            visitBody(stmt->getThenBlock());
+            visitBody(stmt->getElseBlock());
+        }
+        void visitBet(AST::BetStmtAST* stmt) {
+            visit(stmt->getInit());
+            visit(stmt->getCondition());
+            visit(stmt->getIncrement());
+            visitBody(stmt->getBody());
+        }
+        void visitBruh(AST::BruhAST*) {}
+        void visitSigma(AST::SigmaAST*) {}
+        void visitCook(AST::CookAST*) {}
+        void visitExprStmt(AST::ExprStmtAST* stmt) { visit(stmt->getExpr()); }
+        void visitVarDecl(AST::VarDeclStmtAST* stmt) {
+            declared.insert(stmt->getName());
+            visit(stmt->getInitializer());
+        }
+        void visitSolulu(AST::SoluluStmtAST* stmt) {
+            if (stmt->getValue()) visit(stmt->getValue());
+        }
+        void visitYoink(AST::YoinkStmtAST* stmt) {
+            resizes = true;
+            visit(stmt->getIndex());
+            visit(stmt->getValue());
+        }
+        void visitYeet(AST::YeetStmtAST* stmt) {
+            resizes = true;
+            visit(stmt->getIndex());
+        }
+
+    private:
+        const ProgramTypes& program;
+    };
+
+    llvm::OptimizationLevel optimizationLevel(unsigned optLevel) {
+        switch (optLevel) {
+            case 1: return llvm::OptimizationLevel::O1;
+            case 2: return llvm::OptimizationLevel::O2;
+            default: return llvm::OptimizationLevel::O3;
+        }
+    }
+}
+
+CodeGen::CodeGen(const CodeGenOptions& options) : options(options) {
     // Initialize LLVM's native target, assembly printer, and parser
     llvm::InitializeNativeTarget();
     llvm::InitializeNativeTargetAsmPrinter();
@@ -24,32 +170,275 @@ CodeGen::CodeGen() {
     module = std::make_unique<llvm::Module>("brainrotlang", *context);
     builder = std::make_unique<llvm::IRBuilder<>>(*context);
 
+    // Optimization remarks are streamed from the context as passes run
+    if (!options.remarksFile.empty()) {
+        auto remarksOrError = llvm::setupLLVMOptimizationRemarks(
+            *context, options.remarksFile, "", "yaml", false);
+        if (auto err = remarksOrError.takeError()) {
+            llvm::errs() << "Could not open remarks file: "
+                         << toString(std::move(err)) << "\n";
+        } else {
+            remarksOutput = std::move(*remarksOrError);
+        }
+    }
+    if (options.timePasses) {
+        passTimer = std::make_unique<llvm::TimePassesHandler>(true);
+        // Also times the machine code passes
+        llvm::TimePassesIsEnabled = true;
+    }
+
+    // Generate machine code for the host at the requested level
+    auto hostOrError = llvm::orc::JITTargetMachineBuilder::detectHost();
+    if (auto err = hostOrError.takeError()) {
+        std::cerr << "Failed to detect host: "
+                  << llvm::toString(std::move(err)) << std::endl;
+        return;
+    }
+    targetBuilder = std::move(*hostOrError);
+    targetBuilder->setCodeGenOptLevel(codeGenOptLevel(options.optLevel));
+
+    // This machine gives the IR optimizer its cost models and emits object
+    // files. Position-independent code links into the PIE executables
+    // system compilers produce by default.
+    auto objectBuilder = *targetBuilder;
+    objectBuilder.setRelocationModel(llvm::Reloc::PIC_);
+    auto machineOrError = objectBuilder.createTargetMachine();
+    if (auto err = machineOrError.takeError()) {
+        std::cerr << "Failed to create target machine: "
+                  << llvm::toString(std::move(err)) << std::endl;
+        return;
+    }
+    targetMachine = std::move(*machineOrError);
+
     // Configure target-specific settings
-    auto targetTriple = llvm::sys::getProcessTriple();
-    module->setTargetTriple(targetTriple);
+    module->setTargetTriple(targetMachine->getTargetTriple().str());
+    module->setDataLayout(targetMachine->createDataLayout());
+}
+
+// Creates the JIT on first use, so ahead-of-time builds never start it
+bool CodeGen::createJIT() {
+    if (!targetBuilder) {
+        return false;
+    }
 
-    // Initialize Just-In-Time compiler
-    auto JITBuilder = llvm::orc::LLJITBuilder();
-    auto jitOrError = JITBuilder.create();
+    // Initialize Just-In-Time compiler. The lazy variant splits modules per
+    // function and compiles each body on its first call.
+    auto configure = [this](auto& JITBuilder) {
+        JITBuilder.setJITTargetMachineBuilder(*targetBuilder);
+        if (objectCache) {
+            // Compiled objects are offered to the cache, which also answers
+            // for modules it already holds
+            JITBuilder.setCompileFunctionCreator(
+                [this](llvm::orc::JITTargetMachineBuilder machineBuilder)
+                    -> llvm::Expected<std::unique_ptr<llvm::orc::IRCompileLayer::IRCompiler>> {
+                    auto machine = machineBuilder.createTargetMachine();
+                    if (!machine) {
+                        return machine.takeError();
+                    }
+                    return std::make_unique<llvm::orc::TMOwningSimpleCompiler>(std::move(*machine),
+                                                                              objectCache.get());
+                });
+        }
+        if (options.speculate) {
+            // The speculation thread compiles alongside the main thread, so
+            // each compile gets its own TargetMachine
+            JITBuilder.setCompileFunctionCreator(
+                [](llvm::orc::JITTargetMachineBuilder machineBuilder)
+                    -> llvm::Expected<std::unique_ptr<llvm::orc::IRCompileLayer::IRCompiler>> {
+                    return std::make_unique<llvm::orc::ConcurrentIRCompiler>(std::move(machineBuilder));
+                });
+        }
+    };
+    llvm::Expected<std::unique_ptr<llvm::orc::LLJIT>> jitOrError = nullptr;
+    if (options.lazy) {
+        auto JITBuilder = llvm::orc::LLLazyJITBuilder();
+        configure(JITBuilder);
+        jitOrError = JITBuilder.create();
+    } else {
+        auto JITBuilder = llvm::orc::LLJITBuilder();
+        configure(JITBuilder);
+        jitOrError = JITBuilder.create();
+    }
     if (auto err = jitOrError.takeError()) {
         std::cerr << "Failed to create JIT: " 
                   << llvm::toString(std::move(err)) << std::endl;
-        return;
+        return false;
     }
     jit = std::move(*jitOrError);
 
-    // Configure data layout based on JIT settings
-    module->setDataLayout(jit->getDataLayout());
+    llvm::orc::SymbolMap runtime;
+    for (const auto& [name, address] : runtimeSymbols) {
+        runtime[jit->mangleAndIntern(name)] = {llvm::orc::ExecutorAddr::fromPtr(address),
+                                               llvm::JITSymbolFlags::Exported};
+    }
+    if (auto err = jit->getMainJITDylib().define(llvm::orc::absoluteSymbols(std::move(runtime)))) {
+        std::cerr << "Failed to register the runtime: " << llvm::toString(std::move(err)) << std::endl;
+        return false;
+    }
+
+    // Run the optimizer on each module as the JIT compiles it. In lazy
+    // mode that is one function at a time, which is also when its callees
+    // are worth compiling ahead of their first call.
+    if (options.optLevel > 0 || options.speculate) {
+        jit->getIRTransformLayer().setTransform(
+            [this](llvm::orc::ThreadSafeModule tsm, const llvm::orc::MaterializationResponsibility&)
+                -> llvm::Expected<llvm::orc::ThreadSafeModule> {
+                tsm.withModuleDo([this](llvm::Module& m) {
+                    if (options.speculate) {
+                        speculateCallees(m);
+                    }
+                    if (options.optLevel > 0) {
+                        optimizeModule(m);
+                    }
+                });
+                return tsm;
+            });
+    }
+    if (options.speculate) {
+        speculationThread = std::thread([this] { speculationLoop(); });
+    }
+    return true;
 }
 
-void CodeGen::generateCode(AST::CookAST* ast) {
-    // Set up printf function for output operations
-    auto printfType = llvm::FunctionType::get(
-        builder->getInt32Ty(),
-        {builder->getInt8Ty()->getPointerTo()},
-        true  // varargs
-    );
-    module->getOrInsertFunction("printf", printfType);
+CodeGen::~CodeGen() {
+    // The speculation thread uses the JIT, so it stops first
+    if (speculationThread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(speculationMutex);
+            stopSpeculating = true;
+        }
+        speculationReady.notify_one();
+        speculationThread.join();
+    }
+}
+
+// Queues the functions a just-materialized function calls, guessing they
+// will run soon, for the speculation thread to compile ahead of their
+// first call
+void CodeGen::speculateCallees(llvm::Module& m) {
+    // Partitions declare every function of the program; only bruh
+    // functions this one actually calls are worth compiling
+    std::vector<llvm::orc::SymbolStringPtr> callees;
+    std::set<llvm::Function*> seen;
+    for (llvm::Function& function : m) {
+        for (llvm::BasicBlock& block : function) {
+            for (llvm::Instruction& instruction : block) {
+                auto call = llvm::dyn_cast<llvm::CallInst>(&instruction);
+                llvm::Function* callee = call ? call->getCalledFunction() : nullptr;
+                if (callee && callee->isDeclaration() &&
+                    callee->getCallingConv() == llvm::CallingConv::Fast && seen.insert(callee).second) {
+                    callees.push_back(jit->mangleAndIntern(callee->getName()));
+                }
+            }
+        }
+    }
+    if (callees.empty()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(speculationMutex);
+        speculationQueue.insert(speculationQueue.end(), callees.begin(), callees.end());
+    }
+    speculationReady.notify_one();
+}
+
+// Compiles queued functions while the program runs. Looking a function up
+// in the lazy JIT's implementation dylib (main holds only the call-through
+// stubs) materializes its body on this thread; a call that arrives in the
+// meantime waits for that compile instead of starting its own.
+void CodeGen::speculationLoop() {
+    auto& session = jit->getExecutionSession();
+    llvm::orc::JITDylib* implementation =
+        session.getJITDylibByName(jit->getMainJITDylib().getName() + ".impl");
+
+    std::unique_lock<std::mutex> lock(speculationMutex);
+    for (;;) {
+        speculationReady.wait(lock, [this] { return stopSpeculating || !speculationQueue.empty(); });
+        if (stopSpeculating) {
+            return;
+        }
+        std::vector<llvm::orc::SymbolStringPtr> batch;
+        batch.swap(speculationQueue);
+        lock.unlock();
+
+        if (implementation) {
+            llvm::orc::SymbolLookupSet names(batch, llvm::orc::SymbolLookupFlags::WeaklyReferencedSymbol);
+            // A failed guess costs nothing; the call compiles it again
+            llvm::consumeError(session.lookup(llvm::orc::makeJITDylibSearchOrder(implementation),
+                                              std::move(names)).takeError());
+        }
+        lock.lock();
+    }
+}
+
+// Runs the standard -O1/-O2/-O3 pipeline of the new pass manager
+void CodeGen::optimizeModule(llvm::Module& m) {
+    llvm::LoopAnalysisManager LAM;
+    llvm::FunctionAnalysisManager FAM;
+    llvm::CGSCCAnalysisManager CGAM;
+    llvm::ModuleAnalysisManager MAM;
+
+    llvm::PassInstrumentationCallbacks PIC;
+    if (passTimer) {
+        passTimer->registerCallbacks(PIC);
+    }
+
+    llvm::PassBuilder PB(targetMachine.get(), llvm::PipelineTuningOptions(), {}, &PIC);
+    PB.registerModuleAnalyses(MAM);
+    PB.registerCGSCCAnalyses(CGAM);
+    PB.registerFunctionAnalyses(FAM);
+    PB.registerLoopAnalyses(LAM);
+    PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+
+    llvm::ModulePassManager MPM = PB.buildPerModuleDefaultPipeline(optimizationLevel(options.optLevel));
+    MPM.run(m, MAM);
+}
+
+// Declare the runtime functions yap prints through and strings are built
+// with (see brainrot_rt.h)
+void CodeGen::declareRuntime() {
+    llvm::Type* i64 = builder->getInt64Ty();
+    module->getOrInsertFunction("brainrot_print_int", llvm::FunctionType::get(i64, {i64}, false));
+    module->getOrInsertFunction("brainrot_print_double",
+                                llvm::FunctionType::get(i64, {builder->getDoubleTy()}, false));
+    module->getOrInsertFunction("brainrot_print_string",
+                                llvm::FunctionType::get(i64, {builder->getInt8Ty()->getPointerTo(), i64}, false));
+    module->getOrInsertFunction("brainrot_print_str", llvm::FunctionType::get(i64, {i64}, false));
+    module->getOrInsertFunction("brainrot_flush", llvm::FunctionType::get(builder->getVoidTy(), false));
+    for (const char* name : {"brainrot_string_length", "brainrot_string_from_int"}) {
+        module->getOrInsertFunction(name, llvm::FunctionType::get(i64, {i64}, false));
+    }
+    module->getOrInsertFunction("brainrot_string_from_double",
+                                llvm::FunctionType::get(i64, {builder->getDoubleTy()}, false));
+    for (const char* name : {"brainrot_string_concat", "brainrot_string_equal", "brainrot_string_compare"}) {
+        module->getOrInsertFunction(name, llvm::FunctionType::get(i64, {i64, i64}, false));
+    }
+    // Strings never change, so these may be reordered and merged like loads
+    for (const char* name : {"brainrot_string_length", "brainrot_string_equal", "brainrot_string_compare"}) {
+        module->getFunction(name)->setOnlyReadsMemory();
+        module->getFunction(name)->setDoesNotThrow();
+    }
+    llvm::Type* bytes = builder->getInt8Ty()->getPointerTo();
+    module->getOrInsertFunction("brainrot_parallel_workers", llvm::FunctionType::get(i64, false));
+    auto chunkType = llvm::FunctionType::get(builder->getVoidTy(), {bytes, i64, i64, bytes}, false);
+    module->getOrInsertFunction(
+        "brainrot_parallel_for",
+        llvm::FunctionType::get(builder->getVoidTy(), {i64, i64, i64, chunkType->getPointerTo(), bytes, bytes, i64},
+                                false));
+    stringType = llvm::StructType::create(*context, {i64}, "string");
+    stringPool.clear();
+
+    // Same layout as squad.h's Squad
+    squadType = llvm::StructType::create(
+        *context, {builder->getInt64Ty(), builder->getInt64Ty(), builder->getInt64Ty()->getPointerTo()}, "squad");
+}
+
+void CodeGen::generateCode(AST::ProgramAST* program) {
+    declareRuntime();
+    programTypes = inferTypes(program);
+    types = &programTypes;
+    currentTypes = &types->main;
 
     // Create main function with return type int and no parameters
     auto mainType = llvm::FunctionType::get(builder->getInt32Ty(), {}, false);
@@ -64,292 +453,1410 @@ void CodeGen::generateCode(AST::CookAST* ast) {
     auto entry = llvm::BasicBlock::Create(*context, "entry", mainFunc);
     builder->SetInsertPoint(entry);
 
-    // Generate IR for each statement in the AST
-    for (const auto& stmt : ast->getBody()) {
-        generateStmt(stmt.get());
+    // Declare every function first, so calls may come before definitions
+    for (const auto& declaration : program->getDeclarations()) {
+        if (auto bruh = AST::dyn_cast<AST::BruhAST>(declaration)) {
+            declareFunction(bruh);
+        }
+    }
+
+    // Generate IR for each top-level declaration; the cook block becomes
+    // the body of main
+    for (const auto& declaration : program->getDeclarations()) {
+        if (auto bruh = AST::dyn_cast<AST::BruhAST>(declaration)) {
+            generateFunction(bruh);
+        } else {
+            generateStmt(declaration);
+        }
     }
 
-    // Add return 0 at the end of main
+    // Add return 0 at the end of main, with the output written out
+    builder->CreateCall(module->getFunction("brainrot_flush"));
     builder->CreateRet(builder->getInt32(0));
 }
 
-llvm::Value* CodeGen::generateExpr(AST::ExprAST* expr) {
-    // Handle variable references
-    if (auto varExpr = dynamic_cast<AST::VariableExprAST*>(expr)) {
-        if (auto it = namedValues.find(varExpr->getName()); it != namedValues.end()) {
-            return builder->CreateLoad(builder->getDoubleTy(), it->second, varExpr->getName());
+// Handle variable references
+llvm::Value* CodeGen::visitVariable(AST::VariableExprAST* varExpr) {
+    return loadVariable(varExpr->getName());
+}
+
+llvm::Value* CodeGen::loadVariable(std::string_view name) {
+    if (auto it = namedValues.find(name); it != namedValues.end()) {
+        if (auto alloca = llvm::dyn_cast<llvm::AllocaInst>(it->second)) {
+            return builder->CreateLoad(alloca->getAllocatedType(), alloca, name);
         }
-        throw std::runtime_error("Unknown variable name: " + varExpr->getName());
+        return it->second;
     }
-    
-    // Handle numeric literals (both integer and floating-point)
-    if (auto numberExpr = dynamic_cast<AST::NumberExprAST*>(expr)) {
-        if (numberExpr->isFloatingPoint()) {
-            return llvm::ConstantFP::get(*context, 
-                llvm::APFloat(numberExpr->getDoubleValue()));
-        } else {
-            return llvm::ConstantInt::get(*context, 
-                llvm::APInt(32, numberExpr->getIntValue()));
+    throw std::runtime_error("Unknown variable name: " + std::string(name));
+}
+
+// Handle numeric literals (both integer and floating-point)
+llvm::Value* CodeGen::visitNumber(AST::NumberExprAST* numberExpr) {
+    if (numberExpr->isFloatingPoint()) {
+        return llvm::ConstantFP::get(*context, 
+            llvm::APFloat(numberExpr->getDoubleValue()));
+    } else {
+        return llvm::ConstantInt::get(*context, 
+            llvm::APInt(64, numberExpr->getIntValue(), true));
+    }
+}
+
+// Handle string literals
+llvm::Value* CodeGen::visitString(AST::StringExprAST* stringExpr) {
+    return stringConstant(stringExpr->getValue());
+}
+
+// A literal's word: up to 7 bytes it is the word itself, and longer text
+// points to a BrainrotString laid out as a constant. Equal literals share one,
+// so comparing them never reads their bytes.
+llvm::Constant* CodeGen::stringConstant(std::string_view text) {
+    if (auto it = stringPool.find(text); it != stringPool.end()) {
+        return it->second;
+    }
+    llvm::Constant* word = nullptr;
+    if (text.size() <= BRAINROT_SMALL_STRING_MAX) {
+        word = builder->getInt64(brainrot_string_constant(text.data(), static_cast<int64_t>(text.size())));
+    } else {
+        llvm::Constant* bytes = llvm::ConstantDataArray::getString(*context, text, false);
+        auto data = new llvm::GlobalVariable(*module, bytes->getType(), true, llvm::GlobalValue::PrivateLinkage,
+                                             bytes, "str.data");
+        data->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+        llvm::PointerType* pointer = builder->getInt8Ty()->getPointerTo();
+        llvm::Constant* header = llvm::ConstantStruct::getAnon(
+            {builder->getInt64(text.size()), llvm::ConstantExpr::getPointerCast(data, pointer),
+             llvm::ConstantPointerNull::get(pointer)});
+        auto string = new llvm::GlobalVariable(*module, header->getType(), true, llvm::GlobalValue::PrivateLinkage,
+                                               header, "str");
+        string->setAlignment(llvm::Align(8));
+        llvm::Constant* tagged = llvm::ConstantExpr::getInBoundsGetElementPtr(
+            builder->getInt8Ty(), llvm::ConstantExpr::getPointerCast(string, pointer), builder->getInt64(1));
+        word = llvm::ConstantExpr::getPtrToInt(tagged, builder->getInt64Ty());
+    }
+    llvm::Constant* string = llvm::ConstantStruct::get(stringType, {word});
+    stringPool.emplace(text, string);
+    return string;
+}
+
+// The word of a string, or of a number as yap prints it
+llvm::Value* CodeGen::toStringWord(llvm::Value* value) {
+    if (isString(value)) {
+        return builder->CreateExtractValue(value, 0);
+    }
+    requireNumber(value);
+    if (value->getType()->isDoubleTy()) {
+        return builder->CreateCall(module->getFunction("brainrot_string_from_double"), {value});
+    }
+    // Truth values as 0 or 1
+    value = builder->CreateZExt(value, builder->getInt64Ty());
+    return builder->CreateCall(module->getFunction("brainrot_string_from_int"), {value});
+}
+
+llvm::Value* CodeGen::fromStringWord(llvm::Value* word) {
+    return builder->CreateInsertValue(llvm::UndefValue::get(stringType), word, 0);
+}
+
+// Converts a condition value to i1: comparisons already are, numbers
+// are true when non-zero
+llvm::Value* CodeGen::toBool(llvm::Value* value) {
+    requireNumber(value);
+    if (value->getType()->isIntegerTy(1)) return value;
+    if (value->getType()->isDoubleTy()) {
+        return builder->CreateFCmpONE(value, llvm::ConstantFP::get(*context, llvm::APFloat(0.0)), "tobool");
+    }
+    return builder->CreateICmpNE(value, llvm::ConstantInt::get(value->getType(), 0), "tobool");
+}
+
+llvm::Type* CodeGen::typeOf(ValueType type) {
+    switch (type) {
+        case ValueType::Bool: return builder->getInt1Ty();
+        case ValueType::Double: return builder->getDoubleTy();
+        case ValueType::String: return stringType;
+        case ValueType::Squad:
+        case ValueType::IntSquad:
+        case ValueType::DoubleSquad: return squadType->getPointerTo();
+        default: return builder->getInt64Ty();
+    }
+}
+
+// Squads are the only pointers values can be
+bool CodeGen::isSquadValue(llvm::Value* value) {
+    return value->getType()->isPointerTy();
+}
+
+void CodeGen::requireNumber(llvm::Value* value) {
+    if (isString(value)) {
+        throw std::runtime_error("Expected a number, got a string");
+    }
+    if (isSquadValue(value)) {
+        throw std::runtime_error("Expected a number, got a squad");
+    }
+}
+
+// Squad indices are i64; doubles are truncated
+llvm::Value* CodeGen::toIndex(llvm::Value* value) {
+    return convert(value, builder->getInt64Ty());
+}
+
+// What a function returns when it falls off its end: 0, an empty squad,
+// or for strings 0, the empty string
+llvm::Value* CodeGen::defaultValue(llvm::Type* type) {
+    if (type->isPointerTy()) {
+        return builder->CreateCall(squadNew(), {builder->getInt64(0)}, "squad");
+    }
+    return llvm::Constant::getNullValue(type);
+}
+
+// Converts a value for the variable, parameter or return value receiving
+// it. Their types are inferred to hold every value stored, so this only
+// widens: truth values to integers, and either to doubles.
+llvm::Value* CodeGen::convert(llvm::Value* value, llvm::Type* type) {
+    llvm::Type* from = value->getType();
+    if (type == stringType) {
+        if (!isString(value)) {
+            throw std::runtime_error(isSquadValue(value) ? "Expected a string, got a squad"
+                                                         : "Expected a string, got a number");
         }
+        return value;
     }
-    
-    // Handle string literals
-    if (auto stringExpr = dynamic_cast<AST::StringExprAST*>(expr)) {
-        return builder->CreateGlobalStringPtr(stringExpr->getValue());
+    if (type->isPointerTy()) {
+        if (!isSquadValue(value)) {
+            throw std::runtime_error(isString(value) ? "Expected a squad, got a string"
+                                                     : "Expected a squad, got a number");
+        }
+        return value;
+    }
+    requireNumber(value);
+    if (from == type) {
+        return value;
+    }
+    if (type->isDoubleTy()) {
+        return toDouble(value);
+    }
+    if (type->isIntegerTy(1)) {
+        return toBool(value);
+    }
+    if (from->isIntegerTy(1)) {
+        return builder->CreateZExt(value, type);
+    }
+    return builder->CreateFPToSI(value, type);
+}
+
+// The exit code of a solulu in cook, as the C main's i32
+llvm::Value* CodeGen::toExitCode(llvm::Value* value) {
+    if (value->getType()->isDoubleTy()) {
+        return builder->CreateFPToSI(value, builder->getInt32Ty());
     }
+    return builder->CreateZExtOrTrunc(value, builder->getInt32Ty());
+}
+
+// Converts integers and truth values (as 0 or 1) to doubles; other values
+// pass through unchanged
+llvm::Value* CodeGen::toDouble(llvm::Value* value) {
+    if (value->getType()->isIntegerTy(1)) {
+        return builder->CreateUIToFP(value, builder->getDoubleTy());
+    }
+    if (value->getType()->isIntegerTy()) {
+        return builder->CreateSIToFP(value, builder->getDoubleTy());
+    }
+    return value;
+}
+
+// Handle && and || - the right side only runs when it decides the result
+llvm::Value* CodeGen::generateLogical(AST::BinaryExprAST* binaryExpr) {
+    bool isAnd = binaryExpr->getOp() == AST::BinaryOp::And;
+    llvm::Value* L = toBool(generateExpr(binaryExpr->getLHS()));
+    llvm::BasicBlock* lhsBB = builder->GetInsertBlock();
+    llvm::Function* theFunction = lhsBB->getParent();
+    llvm::BasicBlock* rhsBB = llvm::BasicBlock::Create(*context, isAnd ? "and.rhs" : "or.rhs", theFunction);
+    llvm::BasicBlock* mergeBB = llvm::BasicBlock::Create(*context, isAnd ? "and.end" : "or.end");
+
+    if (isAnd) {
+        builder->CreateCondBr(L, rhsBB, mergeBB);
+    } else {
+        builder->CreateCondBr(L, mergeBB, rhsBB);
+    }
+
+    builder->SetInsertPoint(rhsBB);
+    llvm::Value* R = toBool(generateExpr(binaryExpr->getRHS()));
+    rhsBB = builder->GetInsertBlock();
+    builder->CreateBr(mergeBB);
+
+    theFunction->insert(theFunction->end(), mergeBB);
+    builder->SetInsertPoint(mergeBB);
+    llvm::PHINode* result = builder->CreatePHI(builder->getInt1Ty(), 2, "logictmp");
+    result->addIncoming(builder->getInt1(!isAnd), lhsBB);
+    result->addIncoming(R, rhsBB);
+    return result;
+}
+
+// Handle binary operations (+, -, *, /, %, comparisons, && and ||)
+llvm::Value* CodeGen::visitBinary(AST::BinaryExprAST* binaryExpr) {
+    using AST::BinaryOp;
+    if (binaryExpr->getOp() == BinaryOp::And || binaryExpr->getOp() == BinaryOp::Or) {
+        return generateLogical(binaryExpr);
+    }
+
+    llvm::Value* L = generateExpr(binaryExpr->getLHS());
+    llvm::Value* R = generateExpr(binaryExpr->getRHS());
+    if (isString(L) || isString(R)) {
+        return generateStringBinary(binaryExpr->getOp(), L, R);
+    }
+    requireNumber(L);
+    requireNumber(R);
     
-    // Handle binary operations (+, -, *, /, <, >, =)
-    if (auto binaryExpr = dynamic_cast<AST::BinaryExprAST*>(expr)) {
-        llvm::Value* L = generateExpr(binaryExpr->getLHS().get());
-        llvm::Value* R = generateExpr(binaryExpr->getRHS().get());
-        
-        bool lhsIsFloat = L->getType()->isDoubleTy();
-        bool rhsIsFloat = R->getType()->isDoubleTy();
-        
-        bool needsFloat = lhsIsFloat || rhsIsFloat;
+    bool lhsIsFloat = L->getType()->isDoubleTy();
+    bool rhsIsFloat = R->getType()->isDoubleTy();
+    
+    bool needsFloat = lhsIsFloat || rhsIsFloat;
+    
+    if (needsFloat) {
+        L = toDouble(L);
+        R = toDouble(R);
         
-        if (needsFloat) {
-            if (!lhsIsFloat) L = builder->CreateSIToFP(L, builder->getDoubleTy());
-            if (!rhsIsFloat) R = builder->CreateSIToFP(R, builder->getDoubleTy());
-            
-            switch (binaryExpr->getOp()) {
-                case '+': return builder->CreateFAdd(L, R);
-                case '-': return builder->CreateFSub(L, R);
-                case '*': return builder->CreateFMul(L, R);
-                case '/': return builder->CreateFDiv(L, R);
-                case '<': return builder->CreateFCmpOLT(L, R, "cmptmp");
-                case '>': return builder->CreateFCmpOGT(L, R, "cmptmp");
-                case '=': return builder->CreateFCmpOEQ(L, R, "cmptmp");
-            }
-        } else {
-            switch (binaryExpr->getOp()) {
-                case '+': return builder->CreateAdd(L, R);
-                case '-': return builder->CreateSub(L, R);
-                case '*': return builder->CreateMul(L, R);
-                case '/': {
-                    L = builder->CreateSIToFP(L, builder->getDoubleTy());
-                    R = builder->CreateSIToFP(R, builder->getDoubleTy());
-                    return builder->CreateFDiv(L, R);
-                }
-                case '<': return builder->CreateICmpSLT(L, R, "cmptmp");
-                case '>': return builder->CreateICmpSGT(L, R, "cmptmp");
-                case '=': return builder->CreateICmpEQ(L, R, "cmptmp");
+        switch (binaryExpr->getOp()) {
+            case BinaryOp::Add: return builder->CreateFAdd(L, R);
+            case BinaryOp::Sub: return builder->CreateFSub(L, R);
+            case BinaryOp::Mul: return builder->CreateFMul(L, R);
+            case BinaryOp::Div: return builder->CreateFDiv(L, R);
+            case BinaryOp::Mod: return builder->CreateFRem(L, R);
+            case BinaryOp::Less: return builder->CreateFCmpOLT(L, R, "cmptmp");
+            case BinaryOp::LessEqual: return builder->CreateFCmpOLE(L, R, "cmptmp");
+            case BinaryOp::Greater: return builder->CreateFCmpOGT(L, R, "cmptmp");
+            case BinaryOp::GreaterEqual: return builder->CreateFCmpOGE(L, R, "cmptmp");
+            case BinaryOp::Equal: return builder->CreateFCmpOEQ(L, R, "cmptmp");
+            case BinaryOp::NotEqual: return builder->CreateFCmpUNE(L, R, "cmptmp");
+            default: break;
+        }
+    } else {
+        // Truth values take part as the integers 0 and 1
+        L = convert(L, builder->getInt64Ty());
+        R = convert(R, builder->getInt64Ty());
+        switch (binaryExpr->getOp()) {
+            case BinaryOp::Add: return builder->CreateAdd(L, R);
+            case BinaryOp::Sub: return builder->CreateSub(L, R);
+            case BinaryOp::Mul: return builder->CreateMul(L, R);
+            case BinaryOp::Div: {
+                L = builder->CreateSIToFP(L, builder->getDoubleTy());
+                R = builder->CreateSIToFP(R, builder->getDoubleTy());
+                return builder->CreateFDiv(L, R);
             }
+            case BinaryOp::Mod: return generateRemainder(L, R);
+            case BinaryOp::Less: return builder->CreateICmpSLT(L, R, "cmptmp");
+            case BinaryOp::LessEqual: return builder->CreateICmpSLE(L, R, "cmptmp");
+            case BinaryOp::Greater: return builder->CreateICmpSGT(L, R, "cmptmp");
+            case BinaryOp::GreaterEqual: return builder->CreateICmpSGE(L, R, "cmptmp");
+            case BinaryOp::Equal: return builder->CreateICmpEQ(L, R, "cmptmp");
+            case BinaryOp::NotEqual: return builder->CreateICmpNE(L, R, "cmptmp");
+            default: break;
         }
-        throw std::runtime_error("Invalid binary operator");
     }
+    throw std::runtime_error("Invalid binary operator");
+}
+
+// Integer %, which fails on a zero divisor as the interpreter and the VM
+// do. x % -1 is 0 without an srem, which would overflow for INT64_MIN.
+llvm::Value* CodeGen::generateRemainder(llvm::Value* L, llvm::Value* R) {
+    if (auto divisor = llvm::dyn_cast<llvm::ConstantInt>(R); divisor && !divisor->isZero() && !divisor->isMinusOne()) {
+        return builder->CreateSRem(L, R);
+    }
+    llvm::Function* theFunction = builder->GetInsertBlock()->getParent();
+    llvm::BasicBlock* failBB = llvm::BasicBlock::Create(*context, "divbyzero", theFunction);
+    llvm::BasicBlock* okBB = llvm::BasicBlock::Create(*context, "divisor", theFunction);
+    llvm::MDBuilder weights(*context);
+    builder->CreateCondBr(builder->CreateICmpEQ(R, builder->getInt64(0)), failBB, okBB,
+                          weights.createBranchWeights(1, 1 << 20));
+    builder->SetInsertPoint(failBB);
+    builder->CreateCall(failHelper("division.fail", "Error: Division by zero\n"));
+    builder->CreateUnreachable();
+
+    builder->SetInsertPoint(okBB);
+    llvm::Value* minusOne = builder->CreateICmpEQ(R, builder->getInt64(-1));
+    llvm::Value* remainder = builder->CreateSRem(L, builder->CreateSelect(minusOne, builder->getInt64(1), R));
+    return builder->CreateSelect(minusOne, builder->getInt64(0), remainder);
+}
+
+// + appends to a string, a number on either side as yap prints it; two
+// strings also compare by their bytes
+llvm::Value* CodeGen::generateStringBinary(AST::BinaryOp op, llvm::Value* L, llvm::Value* R) {
+    using AST::BinaryOp;
+    if (op == BinaryOp::Add) {
+        llvm::Value* left = toStringWord(L);
+        llvm::Value* right = toStringWord(R);
+        return fromStringWord(builder->CreateCall(module->getFunction("brainrot_string_concat"), {left, right}, "concat"));
+    }
+    if (!isString(L) || !isString(R) || op == BinaryOp::Sub || op == BinaryOp::Mul || op == BinaryOp::Div ||
+        op == BinaryOp::Mod) {
+        throw std::runtime_error("Expected a number, got a string");
+    }
+    llvm::Value* left = builder->CreateExtractValue(L, 0);
+    llvm::Value* right = builder->CreateExtractValue(R, 0);
+    llvm::Value* zero = builder->getInt64(0);
+    if (op == BinaryOp::Equal || op == BinaryOp::NotEqual) {
+        llvm::Value* equal = builder->CreateCall(module->getFunction("brainrot_string_equal"), {left, right});
+        return op == BinaryOp::Equal ? builder->CreateICmpNE(equal, zero, "cmptmp")
+                                     : builder->CreateICmpEQ(equal, zero, "cmptmp");
+    }
+    llvm::Value* order = builder->CreateCall(module->getFunction("brainrot_string_compare"), {left, right}, "order");
+    switch (op) {
+        case BinaryOp::Less: return builder->CreateICmpSLT(order, zero, "cmptmp");
+        case BinaryOp::LessEqual: return builder->CreateICmpSLE(order, zero, "cmptmp");
+        case BinaryOp::Greater: return builder->CreateICmpSGT(order, zero, "cmptmp");
+        default: return builder->CreateICmpSGE(order, zero, "cmptmp");
+    }
+}
+
+// Handle unary operations (negation and logical not)
+llvm::Value* CodeGen::visitUnary(AST::UnaryExprAST* unaryExpr) {
+    llvm::Value* operandVal = generateExpr(unaryExpr->getOperand());
     
-    // Handle unary operations (currently only negation)
-    if (auto unaryExpr = dynamic_cast<AST::UnaryExprAST*>(expr)) {
-        llvm::Value* operandVal = generateExpr(unaryExpr->getOperand().get());
-        
-        if (!operandVal) return nullptr;
-        
-        switch (unaryExpr->getOp()) {
-            case '-':
+    if (!operandVal) return nullptr;
+    requireNumber(operandVal);
+    
+    switch (unaryExpr->getOp()) {
+        case AST::UnaryOp::Negate:
+            if (operandVal->getType()->isDoubleTy()) {
                 return builder->CreateFNeg(operandVal, "negtmp");
-            default:
-                throw std::runtime_error("Invalid unary operator");
-        }
+            }
+            return builder->CreateNeg(operandVal, "negtmp");
+        case AST::UnaryOp::Not:
+            return builder->CreateNot(toBool(operandVal), "nottmp");
     }
-    
-    // Handle parenthesized expressions
-    if (auto groupExpr = dynamic_cast<AST::GroupingExprAST*>(expr)) {
-        return generateExpr(groupExpr->getExpression().get());
+    throw std::runtime_error("Invalid unary operator");
+}
+
+// Handle parenthesized expressions
+llvm::Value* CodeGen::visitGrouping(AST::GroupingExprAST* groupExpr) {
+    return generateExpr(groupExpr->getExpression());
+}
+
+// Handle variable assignment
+llvm::Value* CodeGen::visitAssign(AST::AssignExprAST* assignExpr) {
+    llvm::Value* value = generateExpr(assignExpr->getValue());
+    if (auto it = namedValues.find(assignExpr->getName()); it != namedValues.end()) {
+        // Assigned parameters always have a slot, see generateFunction
+        auto alloca = llvm::cast<llvm::AllocaInst>(it->second);
+        value = convert(value, alloca->getAllocatedType());
+        builder->CreateStore(value, alloca);
+        return value;
     }
-    
-    // Handle variable assignment
-    if (auto assignExpr = dynamic_cast<AST::AssignExprAST*>(expr)) {
-        llvm::Value* value = generateExpr(assignExpr->getValue().get());
-        if (auto it = namedValues.find(assignExpr->getName()); it != namedValues.end()) {
-            builder->CreateStore(value, it->second);
-            return value;
+    throw std::runtime_error("Undefined variable: " + std::string(assignExpr->getName()));
+}
+
+// Handle function calls (currently only 'yap' for printing)
+llvm::Value* CodeGen::visitCall(AST::CallExprAST* callExpr) {
+    // yap(...) evaluates to the number of characters printed
+    if (callExpr->getCallee() == "yap") {
+        std::vector<PrintPiece> pieces;
+        for (const auto& arg : callExpr->getArgs()) {
+            if (auto text = literalText(arg)) {
+                pieces.push_back({nullptr, *text});
+                continue;
+            }
+            llvm::Value* argVal = generateExpr(arg);
+            if (isSquadValue(argVal)) {
+                throw std::runtime_error("yap cannot print a squad");
+            }
+            pieces.push_back({argVal, {}});
         }
-        throw std::runtime_error("Undefined variable: " + assignExpr->getName());
+        return emitPrint(pieces);
     }
-    
-    // Handle function calls (currently only 'yap' for printing)
-    if (auto callExpr = dynamic_cast<AST::CallExprAST*>(expr)) {
-        if (callExpr->getCallee() == "yap") {
-            auto printfFunc = module->getFunction("printf");
-            std::vector<llvm::Value*> argsV;
-            
-            // Handle multiple arguments
-            std::string formatStr;
-            for (const auto& arg : callExpr->getArgs()) {
-                llvm::Value* argVal = generateExpr(arg.get());
-                if (argVal->getType()->isDoubleTy()) {
-                    formatStr += "%f";
-                } else if (argVal->getType()->isIntegerTy()) {
-                    formatStr += "%d";
-                } else if (argVal->getType()->isPointerTy()) {
-                    formatStr += "%s";
-                }
-                argsV.push_back(argVal);
-            }
-            formatStr += "\n";
-            
-            // Create format string and add it as first argument
-            argsV.insert(argsV.begin(), builder->CreateGlobalStringPtr(formatStr));
-            
-            return builder->CreateCall(printfFunc, argsV);
+
+    // squad(n): n zeroes
+    if (callExpr->getCallee() == "squad") {
+        if (callExpr->getArgs().size() != 1) {
+            throw std::runtime_error("squad expects 1 argument, got " +
+                                     std::to_string(callExpr->getArgs().size()));
         }
-        throw std::runtime_error("Unknown function: " + callExpr->getCallee());
+        llvm::Value* length = toIndex(generateExpr(callExpr->getArgs()[0]));
+        return builder->CreateCall(squadNew(), {length}, "squad");
     }
-    
-    throw std::runtime_error("Unknown expression type");
+
+    // min(a, b) is b if b < a, else a; max likewise
+    if (isMinMax(*types, callExpr->getCallee())) {
+        if (callExpr->getArgs().size() != 2) {
+            throw std::runtime_error(std::string(callExpr->getCallee()) + " expects 2 arguments, got " +
+                                     std::to_string(callExpr->getArgs().size()));
+        }
+        llvm::Value* a = generateExpr(callExpr->getArgs()[0]);
+        llvm::Value* b = generateExpr(callExpr->getArgs()[1]);
+        requireNumber(a);
+        requireNumber(b);
+        bool isMin = callExpr->getCallee() == "min";
+        if (a->getType()->isDoubleTy() || b->getType()->isDoubleTy()) {
+            a = toDouble(a);
+            b = toDouble(b);
+            return builder->CreateSelect(isMin ? builder->CreateFCmpOLT(b, a) : builder->CreateFCmpOGT(b, a), b, a);
+        }
+        a = convert(a, builder->getInt64Ty());
+        b = convert(b, builder->getInt64Ty());
+        return builder->CreateSelect(isMin ? builder->CreateICmpSLT(b, a) : builder->CreateICmpSGT(b, a), b, a);
+    }
+
+    auto it = functions.find(callExpr->getCallee());
+    if (it == functions.end()) {
+        throw std::runtime_error("Unknown function: " + std::string(callExpr->getCallee()));
+    }
+    llvm::Function* callee = it->second;
+    if (callee->arg_size() != callExpr->getArgs().size()) {
+        throw std::runtime_error("Function '" + std::string(callExpr->getCallee()) + "' expects " +
+                                 std::to_string(callee->arg_size()) + " arguments, got " +
+                                 std::to_string(callExpr->getArgs().size()));
+    }
+
+    // Arguments are passed by value in registers; squads by reference
+    std::vector<llvm::Value*> argsV;
+    for (const auto& arg : callExpr->getArgs()) {
+        llvm::Value* argVal = generateExpr(arg);
+        argsV.push_back(convert(argVal, callee->getArg(argsV.size())->getType()));
+    }
+    llvm::CallInst* call = builder->CreateCall(callee, argsV, "calltmp");
+    call->setCallingConv(callee->getCallingConv());
+    return call;
 }
 
-void CodeGen::generateStmt(AST::StmtAST* stmt) {
-    // Handle variable declarations
-    if (auto varDecl = dynamic_cast<AST::VarDeclStmtAST*>(stmt)) {
-        // Allocate space for variable and store initial value
+// Handle variable declarations
+void CodeGen::visitVarDecl(AST::VarDeclStmtAST* varDecl) {
+    // A name has one slot per function, of its inferred type, so a
+    // declaration generated twice (see emitVersionedLoop) stores where the
+    // code after both copies reads
+    llvm::Value* initVal = generateExpr(varDecl->getInitializer());
+    auto existing = namedValues.find(varDecl->getName());
+    auto alloca = existing == namedValues.end() ? nullptr : llvm::dyn_cast<llvm::AllocaInst>(existing->second);
+    if (!alloca) {
         llvm::Function* function = builder->GetInsertBlock()->getParent();
         llvm::IRBuilder<> tempBuilder(&function->getEntryBlock(),
                                     function->getEntryBlock().begin());
-        llvm::AllocaInst* alloca = tempBuilder.CreateAlloca(
-            builder->getDoubleTy(),
+        alloca = tempBuilder.CreateAlloca(
+            typeOf(currentTypes->variable(varDecl->getName())),
             nullptr,
             varDecl->getName()
         );
-        
-        // Store initial value
-        llvm::Value* initVal = generateExpr(varDecl->getInitializer().get());
-        builder->CreateStore(initVal, alloca);
-        
-        // Add to symbol table
-        namedValues[varDecl->getName()] = alloca;
-        return;
     }
     
-    // Handle print statements ('yap')
-    else if (auto yapStmt = dynamic_cast<AST::YapStmtAST*>(stmt)) {
-        auto printfFunc = module->getFunction("printf");
-        std::vector<llvm::Value*> printArgs;
-        std::string formatStr;
-        
-        // Process each argument
-        for (const auto& arg : yapStmt->getArgs()) {
-            auto value = generateExpr(arg.get());
-            
-            // Add to format string based on type
-            if (auto strExpr = dynamic_cast<AST::StringExprAST*>(arg.get())) {
-                formatStr += "%s";
-            } else if (value->getType()->isDoubleTy()) {
-                formatStr += "%.6f";
-            } else if (value->getType()->isIntegerTy()) {
-                formatStr += "%d";
-            }
-            
-            printArgs.push_back(value);
+    // Store initial value, converted to the variable's inferred type
+    initVal = convert(initVal, alloca->getAllocatedType());
+    builder->CreateStore(initVal, alloca);
+    
+    // Add to symbol table
+    namedValues[std::string(varDecl->getName())] = alloca;
+}
+
+// Handle print statements ('yap')
+void CodeGen::visitYap(AST::YapStmtAST* yapStmt) {
+    std::vector<PrintPiece> pieces;
+    for (const auto& arg : yapStmt->getArgs()) {
+        if (auto string = AST::dyn_cast<AST::StringExprAST>(arg)) {
+            pieces.push_back({nullptr, string->getValue()});
+            continue;
         }
-        formatStr += "\n"; // Add newline at the end
-        
-        // Insert format string as first argument
-        printArgs.insert(printArgs.begin(), 
-            builder->CreateGlobalStringPtr(formatStr));
-        
-        // Create the call
-        builder->CreateCall(printfFunc, printArgs);
+        auto value = generateExpr(arg);
+        if (isSquadValue(value)) {
+            throw std::runtime_error("yap cannot print a squad");
+        }
+        pieces.push_back({value, {}});
     }
-    
-    // Handle if statements ('sus')
-    else if (auto susStmt = dynamic_cast<AST::SusStmtAST*>(stmt)) {
-        // Generate condition
-        llvm::Value* condValue = generateExpr(susStmt->getCondition().get());
-        
-        if (condValue->getType()->isDoubleTy()) {
-            condValue = builder->CreateFCmpONE(
-                condValue,
-                llvm::ConstantFP::get(*context, llvm::APFloat(0.0)),
-                "ifcond"
-            );
+    emitPrint(pieces);
+}
+
+// Prints yap's arguments, after all of them are evaluated, and a newline.
+// Numbers are formatted by the runtime; literal text next to other text,
+// including the newline, goes out in one call. Returns the number of
+// characters printed.
+llvm::Value* CodeGen::emitPrint(const std::vector<PrintPiece>& pieces) {
+    llvm::Value* printed = nullptr;
+    int64_t textLength = 0;
+    std::string text;
+    auto flushText = [&] {
+        if (text.empty()) {
+            return;
         }
-        
-        llvm::Function* theFunction = builder->GetInsertBlock()->getParent();
-        llvm::BasicBlock* thenBB = llvm::BasicBlock::Create(*context, "then", theFunction);
-        llvm::BasicBlock* elseBB = llvm::BasicBlock::Create(*context, "else");
-        llvm::BasicBlock* mergeBB = llvm::BasicBlock::Create(*context, "ifcont");
-        
-        builder->CreateCondBr(condValue, thenBB, elseBB);
-        
-        // Emit then block
-        builder->SetInsertPoint(thenBB);
-        for (const auto& thenStmt : susStmt->getThenBlock()) {
-            generateStmt(thenStmt.get());
+        builder->CreateCall(module->getFunction("brainrot_print_string"),
+                            {builder->CreateGlobalStringPtr(text, "text"), builder->getInt64(text.size())});
+        textLength += static_cast<int64_t>(text.size());
+        text.clear();
+    };
+    for (const PrintPiece& piece : pieces) {
+        if (!piece.value) {
+            text += piece.text;
+            continue;
         }
-        builder->CreateBr(mergeBB);
-        
-        // Emit else block
-        theFunction->insert(theFunction->end(), elseBB);
-        builder->SetInsertPoint(elseBB);
-        for (const auto& elseStmt : susStmt->getElseBlock()) {
-            generateStmt(elseStmt.get());
+        flushText();
+        llvm::Value* value = piece.value;
+        llvm::Value* count = nullptr;
+        if (isString(value)) {
+            count = builder->CreateCall(module->getFunction("brainrot_print_str"),
+                                        {builder->CreateExtractValue(value, 0)});
+        } else if (value->getType()->isDoubleTy()) {
+            count = builder->CreateCall(module->getFunction("brainrot_print_double"), {value});
+        } else {
+            // Truth values print as 0 or 1
+            value = builder->CreateZExt(value, builder->getInt64Ty());
+            count = builder->CreateCall(module->getFunction("brainrot_print_int"), {value});
         }
-        builder->CreateBr(mergeBB);
-        
-        theFunction->insert(theFunction->end(), mergeBB);
-        builder->SetInsertPoint(mergeBB);
+        printed = printed ? builder->CreateAdd(printed, count) : count;
     }
+    text += '\n';
+    flushText();
+    llvm::Value* total = builder->getInt64(textLength);
+    return printed ? builder->CreateAdd(printed, total, "printed") : total;
+}
+
+// Handle if statements ('sus')
+void CodeGen::visitSus(AST::SusStmtAST* susStmt) {
+    // Generate condition
+    llvm::Value* condValue = toBool(generateExpr(susStmt->getCondition()));
     
-    // Handle loop statements ('bet')
-    else if (auto betStmt = dynamic_cast<AST::BetStmtAST*>(stmt)) {
-        llvm::Function* theFunction = builder->GetInsertBlock()->getParent();
-        llvm::BasicBlock* condBB = llvm::BasicBlock::Create(*context, "loopcond", theFunction);
-        llvm::BasicBlock* loopBB = llvm::BasicBlock::Create(*context, "loop");
-        llvm::BasicBlock* afterBB = llvm::BasicBlock::Create(*context, "afterloop");
-        
-        // Generate initialization
-        if (betStmt->getInit()) {
-            generateStmt(betStmt->getInit().get());
+    llvm::Function* theFunction = builder->GetInsertBlock()->getParent();
+    llvm::BasicBlock* thenBB = llvm::BasicBlock::Create(*context, "then", theFunction);
+    llvm::BasicBlock* elseBB = llvm::BasicBlock::Create(*context, "else");
+    llvm::BasicBlock* mergeBB = llvm::BasicBlock::Create(*context, "ifcont");
+    
+    builder->CreateCondBr(condValue, thenBB, elseBB);
+    
+    // Emit then block
+    builder->SetInsertPoint(thenBB);
+    for (const auto& thenStmt : susStmt->getThenBlock()) {
+        generateStmt(thenStmt);
+    }
+    builder->CreateBr(mergeBB);
+    
+    // Emit else block
+    theFunction->insert(theFunction->end(), elseBB);
+    builder->SetInsertPoint(elseBB);
+    for (const auto& elseStmt : susStmt->getElseBlock()) {
+        generateStmt(elseStmt);
+    }
+    builder->CreateBr(mergeBB);
+    
+    theFunction->insert(theFunction->end(), mergeBB);
+    builder->SetInsertPoint(mergeBB);
+}
+
+// Handle loop statements ('bet')
+void CodeGen::visitBet(AST::BetStmtAST* betStmt) {
+    // Generate initialization
+    if (betStmt->getInit()) {
+        generateStmt(betStmt->getInit());
+    }
+    if (betStmt->isParallel()) {
+        emitParallelLoop(betStmt);
+    } else if (!emitVersionedLoop(betStmt)) {
+        emitLoop(betStmt);
+    }
+}
+
+// A counting loop over squads, bet (..., i < end, i = i + 1) { ... xs[i]
+// ... }, is generated twice. One test before the loop checks that every
+// value i will take indexes each such squad in bounds; if so, a version
+// runs in which xs[i] is not checked and the data and length of xs are
+// loaded once up front, a loop LLVM can vectorize. Otherwise the ordinary
+// checked version runs. This holds only while the body cannot move or
+// resize xs or change i and end: it must not assign or declare them, nor
+// yoink, yeet or call a bruh. Returns false, generating nothing, for any
+// other loop.
+bool CodeGen::emitVersionedLoop(AST::BetStmtAST* betStmt) {
+    auto condition = AST::dyn_cast<AST::BinaryExprAST>(betStmt->getCondition());
+    if (!condition ||
+        (condition->getOp() != AST::BinaryOp::Less && condition->getOp() != AST::BinaryOp::LessEqual)) {
+        return false;
+    }
+    auto counter = AST::dyn_cast<AST::VariableExprAST>(condition->getLHS());
+    if (!counter || currentTypes->variable(counter->getName()) != ValueType::Int ||
+        !isIncrement(betStmt->getIncrement(), counter->getName())) {
+        return false;
+    }
+    std::string_view name = counter->getName();
+    auto counterSlot = namedValues.find(name);
+    if (counterSlot == namedValues.end() || !llvm::isa<llvm::AllocaInst>(counterSlot->second)) {
+        return false;
+    }
+
+    AssignmentFinder body(*types);
+    body.visitBody(betStmt->getBody());
+    auto unchanged = [&](std::string_view variable) {
+        return !body.names.count(variable) && !body.declared.count(variable) && namedValues.count(variable);
+    };
+    if (body.calls || body.resizes || !unchanged(name)) {
+        return false;
+    }
+
+    // The end is an integer the body cannot change
+    std::function<bool(AST::ExprAST*)> invariant = [&](AST::ExprAST* expr) {
+        switch (expr->getKind()) {
+            case AST::ExprKind::Number:
+                return !AST::cast<AST::NumberExprAST>(expr)->isFloatingPoint();
+            case AST::ExprKind::Variable: {
+                std::string_view variable = AST::cast<AST::VariableExprAST>(expr)->getName();
+                return variable != name && unchanged(variable) && currentTypes->variable(variable) == ValueType::Int;
+            }
+            case AST::ExprKind::Length: {
+                std::string_view squad = AST::cast<AST::LengthExprAST>(expr)->getName();
+                return unchanged(squad) && isSquad(currentTypes->variable(squad));
+            }
+            case AST::ExprKind::Grouping:
+                return invariant(AST::cast<AST::GroupingExprAST>(expr)->getExpression());
+            case AST::ExprKind::Binary: {
+                auto binary = AST::cast<AST::BinaryExprAST>(expr);
+                AST::BinaryOp op = binary->getOp();
+                return (op == AST::BinaryOp::Add || op == AST::BinaryOp::Sub || op == AST::BinaryOp::Mul) &&
+                       invariant(binary->getLHS()) && invariant(binary->getRHS());
+            }
+            default:
+                return false;
         }
-        
-        builder->CreateBr(condBB);
-        builder->SetInsertPoint(condBB);
-        
-        // Generate condition
-        llvm::Value* condValue = nullptr;
-        if (betStmt->getCondition()) {
-            condValue = generateExpr(betStmt->getCondition().get());
-            if (condValue->getType()->isDoubleTy()) {
-                condValue = builder->CreateFCmpONE(
-                    condValue,
-                    llvm::ConstantFP::get(*context, llvm::APFloat(0.0)),
-                    "loopcond"
-                );
+    };
+    if (!invariant(condition->getRHS())) {
+        return false;
+    }
+
+    std::vector<std::string_view> squads;
+    for (auto& [squad, index] : body.indexed) {
+        auto variable = AST::dyn_cast<AST::VariableExprAST>(index);
+        if (variable && variable->getName() == name && unchanged(squad) && isSquad(currentTypes->variable(squad)) &&
+            std::find(squads.begin(), squads.end(), squad) == squads.end()) {
+            squads.push_back(squad);
+        }
+    }
+    if (squads.empty()) {
+        return false;
+    }
+
+    // i runs over [start, end), or [start, end] for <=, if it runs at all
+    bool inclusive = condition->getOp() == AST::BinaryOp::LessEqual;
+    auto counterAlloca = llvm::cast<llvm::AllocaInst>(counterSlot->second);
+    llvm::Value* start = builder->CreateLoad(builder->getInt64Ty(), counterAlloca, name);
+    llvm::Value* end = convert(generateExpr(condition->getRHS()), builder->getInt64Ty());
+    llvm::Value* empty = inclusive ? builder->CreateICmpSGT(start, end) : builder->CreateICmpSGE(start, end);
+    llvm::Value* inBounds = builder->CreateICmpSGE(start, builder->getInt64(0));
+
+    // Squads an enclosing unchecked loop hoisted keep their loads
+    auto outerSquads = hoistedSquads;
+    for (std::string_view squad : squads) {
+        HoistedSquad& hoisted = hoistedSquads[std::string(squad)];
+        if (!hoisted.data) {
+            llvm::Value* value = loadSquad(squad);
+            hoisted.length = loadSquadField(value, 0);
+            hoisted.data = loadSquadField(value, 2);
+        }
+        hoisted.counters.push_back(name);
+        inBounds = builder->CreateAnd(inBounds, inclusive ? builder->CreateICmpSLT(end, hoisted.length)
+                                                          : builder->CreateICmpSLE(end, hoisted.length));
+    }
+
+    llvm::Function* theFunction = builder->GetInsertBlock()->getParent();
+    llvm::BasicBlock* uncheckedBB = llvm::BasicBlock::Create(*context, "unchecked", theFunction);
+    llvm::BasicBlock* checkedBB = llvm::BasicBlock::Create(*context, "checked");
+    llvm::BasicBlock* joinBB = llvm::BasicBlock::Create(*context, "versioned");
+    builder->CreateCondBr(builder->CreateOr(empty, inBounds), uncheckedBB, checkedBB);
+
+    builder->SetInsertPoint(uncheckedBB);
+    emitLoop(betStmt);
+    builder->CreateBr(joinBB);
+    hoistedSquads = std::move(outerSquads);
+
+    theFunction->insert(theFunction->end(), checkedBB);
+    builder->SetInsertPoint(checkedBB);
+    emitLoop(betStmt);
+    builder->CreateBr(joinBB);
+
+    theFunction->insert(theFunction->end(), joinBB);
+    builder->SetInsertPoint(joinBB);
+    return true;
+}
+
+// A goated bet (see parallel_loop.h) runs on brainrot_parallel_for. Its
+// body becomes a chunk function that runs iterations [begin, end) as an
+// ordinary counting loop, versioned like any other. The variables the body
+// reads come in by value in a context struct; each reduction gets a
+// private copy that starts from, and is left in, the worker's partial.
+// The partials start at their reduction's identity and are folded into
+// the variables once every chunk is done.
+void CodeGen::emitParallelLoop(AST::BetStmtAST* betStmt) {
+    ParallelLoop loop = analyzeParallelLoop(betStmt, *types, *currentTypes);
+    llvm::Function* function = builder->GetInsertBlock()->getParent();
+    llvm::IRBuilder<> entryBuilder(&function->getEntryBlock(), function->getEntryBlock().begin());
+    llvm::Type* i64 = builder->getInt64Ty();
+    llvm::Type* bytes = builder->getInt8Ty()->getPointerTo();
+
+    // The initializer has set the counter; the bound is evaluated once.
+    // A fractional one ends where i < bound or i <= bound would.
+    llvm::Value* begin = loadVariable(loop.counter);
+    llvm::Value* bound = generateExpr(loop.end);
+    requireNumber(bound);
+    llvm::Value* end;
+    if (bound->getType()->isDoubleTy()) {
+        llvm::Intrinsic::ID round = loop.inclusive ? llvm::Intrinsic::floor : llvm::Intrinsic::ceil;
+        end = builder->CreateFPToSI(builder->CreateUnaryIntrinsic(round, bound), i64);
+    } else {
+        end = convert(bound, i64);
+    }
+    if (loop.inclusive) {
+        end = builder->CreateAdd(end, builder->getInt64(1));
+    }
+
+    // Names declared in the body are the function's, as in any bet
+    for (std::string_view name : loop.locals) {
+        if (!namedValues.count(name)) {
+            llvm::Type* type = typeOf(currentTypes->variable(name));
+            llvm::AllocaInst* alloca = entryBuilder.CreateAlloca(type, nullptr, name);
+            builder->CreateStore(defaultValue(type), alloca);
+            namedValues[std::string(name)] = alloca;
+        }
+    }
+
+    std::vector<std::string_view> captured;
+    std::vector<llvm::Value*> capturedValues;
+    std::vector<llvm::Type*> capturedTypes;
+    for (std::string_view name : loop.captured) {
+        // One never declared is reported when the body reads it
+        if (namedValues.count(name)) {
+            captured.push_back(name);
+            capturedValues.push_back(loadVariable(name));
+            capturedTypes.push_back(capturedValues.back()->getType());
+        }
+    }
+    llvm::StructType* contextType = llvm::StructType::get(*context, capturedTypes);
+    llvm::Value* captures = entryBuilder.CreateAlloca(contextType, nullptr, "captured");
+    for (size_t i = 0; i < captured.size(); ++i) {
+        builder->CreateStore(capturedValues[i], builder->CreateStructGEP(contextType, captures, i));
+    }
+
+    std::vector<llvm::Type*> reducedTypes;
+    std::vector<llvm::Constant*> identities;
+    for (const ParallelLoop::Reduction& reduction : loop.reductions) {
+        bool isDouble = reduction.type == ValueType::Double;
+        reducedTypes.push_back(typeOf(reduction.type));
+        switch (reduction.kind) {
+            case ParallelLoop::Reduce::Sum:
+                identities.push_back(isDouble ? llvm::ConstantFP::get(builder->getDoubleTy(), 0.0)
+                                              : builder->getInt64(0));
+                break;
+            case ParallelLoop::Reduce::Min:
+                identities.push_back(isDouble ? llvm::ConstantFP::getInfinity(builder->getDoubleTy())
+                                              : builder->getInt64(INT64_MAX));
+                break;
+            case ParallelLoop::Reduce::Max:
+                identities.push_back(isDouble ? llvm::ConstantFP::getInfinity(builder->getDoubleTy(), true)
+                                              : builder->getInt64(INT64_MIN));
+                break;
+        }
+    }
+    llvm::StructType* partialType = llvm::StructType::get(*context, reducedTypes);
+
+    // The chunk function sees the captured values, the counter, the end
+    // of its chunk under a name no program can spell, and the reductions
+    auto chunkType = llvm::FunctionType::get(builder->getVoidTy(), {bytes, i64, i64, bytes}, false);
+    auto chunk = llvm::Function::Create(chunkType, llvm::Function::InternalLinkage,
+                                        function->getName() + ".goated", module.get());
+    {
+        llvm::IRBuilderBase::InsertPointGuard guard(*builder);
+        std::map<std::string, llvm::Value*, std::less<>> outerValues;
+        outerValues.swap(namedValues);
+        auto outerSquads = std::move(hoistedSquads);
+        hoistedSquads.clear();
+        llvm::Value* outerFrame = osrFrame;
+        osrFrame = nullptr;
+
+        builder->SetInsertPoint(llvm::BasicBlock::Create(*context, "entry", chunk));
+        llvm::Value* values = builder->CreatePointerCast(chunk->getArg(0), contextType->getPointerTo());
+        for (size_t i = 0; i < captured.size(); ++i) {
+            namedValues[std::string(captured[i])] = builder->CreateLoad(
+                capturedTypes[i], builder->CreateStructGEP(contextType, values, i), captured[i]);
+        }
+        llvm::AllocaInst* counter = builder->CreateAlloca(i64, nullptr, loop.counter);
+        builder->CreateStore(chunk->getArg(1), counter);
+        namedValues[std::string(loop.counter)] = counter;
+        namedValues["goated.end"] = chunk->getArg(2);
+
+        llvm::Value* partial = builder->CreatePointerCast(chunk->getArg(3), partialType->getPointerTo());
+        std::vector<llvm::AllocaInst*> privates;
+        for (size_t k = 0; k < loop.reductions.size(); ++k) {
+            std::string_view name = loop.reductions[k].name;
+            privates.push_back(builder->CreateAlloca(reducedTypes[k], nullptr, name));
+            builder->CreateStore(
+                builder->CreateLoad(reducedTypes[k], builder->CreateStructGEP(partialType, partial, k)),
+                privates.back());
+            // One never declared is reported when the body assigns it
+            if (outerValues.count(name)) {
+                namedValues[std::string(name)] = privates.back();
             }
-        } else {
-            condValue = builder->getInt1(true);
         }
-        
-        builder->CreateCondBr(condValue, loopBB, afterBB);
-        
-        theFunction->insert(theFunction->end(), loopBB);
-        builder->SetInsertPoint(loopBB);
-        
-        for (const auto& bodyStmt : betStmt->getBody()) {
-            generateStmt(bodyStmt.get());
+
+        AST::VariableExprAST counterExpr(loop.counter);
+        AST::VariableExprAST endExpr("goated.end");
+        AST::BinaryExprAST condition(AST::BinaryOp::Less, &counterExpr, &endExpr);
+        AST::BetStmtAST chunkLoop(nullptr, &condition, betStmt->getIncrement(), betStmt->getBody());
+        if (!emitVersionedLoop(&chunkLoop)) {
+            emitLoop(&chunkLoop);
         }
-        
-        if (betStmt->getIncrement()) {
-            generateStmt(betStmt->getIncrement().get());
+
+        for (size_t k = 0; k < privates.size(); ++k) {
+            builder->CreateStore(builder->CreateLoad(reducedTypes[k], privates[k]),
+                                 builder->CreateStructGEP(partialType, partial, k));
         }
-        
-        builder->CreateBr(condBB);
-        
-        theFunction->insert(theFunction->end(), afterBB);
+        builder->CreateRetVoid();
+
+        namedValues.swap(outerValues);
+        hoistedSquads = std::move(outerSquads);
+        osrFrame = outerFrame;
+    }
+
+    // Emits body(w) for every worker w
+    llvm::Value* workers = builder->CreateCall(module->getFunction("brainrot_parallel_workers"), {}, "workers");
+    auto forEachWorker = [&](const std::function<void(llvm::Value*)>& body) {
+        llvm::BasicBlock* before = builder->GetInsertBlock();
+        llvm::BasicBlock* loopBB = llvm::BasicBlock::Create(*context, "worker", function);
+        llvm::BasicBlock* afterBB = llvm::BasicBlock::Create(*context, "workersdone", function);
+        builder->CreateBr(loopBB);
+        builder->SetInsertPoint(loopBB);
+        llvm::PHINode* worker = builder->CreatePHI(i64, 2, "w");
+        worker->addIncoming(builder->getInt64(0), before);
+        body(worker);
+        llvm::Value* next = builder->CreateAdd(worker, builder->getInt64(1));
+        worker->addIncoming(next, builder->GetInsertBlock());
+        builder->CreateCondBr(builder->CreateICmpSLT(next, workers), loopBB, afterBB);
         builder->SetInsertPoint(afterBB);
+    };
+
+    llvm::Value* partials = llvm::ConstantPointerNull::get(partialType->getPointerTo());
+    if (!loop.reductions.empty()) {
+        partials = entryBuilder.CreateAlloca(partialType, builder->getInt64(BRAINROT_MAX_WORKERS), "partials");
+        forEachWorker([&](llvm::Value* worker) {
+            llvm::Value* slot = builder->CreateGEP(partialType, partials, worker);
+            for (size_t k = 0; k < identities.size(); ++k) {
+                builder->CreateStore(identities[k], builder->CreateStructGEP(partialType, slot, k));
+            }
+        });
+    }
+
+    builder->CreateCall(module->getFunction("brainrot_parallel_for"),
+                        {begin, end, workers, chunk, builder->CreatePointerCast(captures, bytes),
+                         builder->CreatePointerCast(partials, bytes),
+                         llvm::ConstantExpr::getSizeOf(partialType)});
+
+    if (!loop.reductions.empty()) {
+        forEachWorker([&](llvm::Value* worker) {
+            llvm::Value* slot = builder->CreateGEP(partialType, partials, worker);
+            for (size_t k = 0; k < loop.reductions.size(); ++k) {
+                const ParallelLoop::Reduction& reduction = loop.reductions[k];
+                llvm::Value* variable = namedValues.find(reduction.name)->second;
+                llvm::Value* x = builder->CreateLoad(reducedTypes[k], variable);
+                llvm::Value* p = builder->CreateLoad(reducedTypes[k], builder->CreateStructGEP(partialType, slot, k));
+                bool isDouble = reduction.type == ValueType::Double;
+                llvm::Value* combined = nullptr;
+                switch (reduction.kind) {
+                    case ParallelLoop::Reduce::Sum:
+                        combined = isDouble ? builder->CreateFAdd(x, p) : builder->CreateAdd(x, p);
+                        break;
+                    case ParallelLoop::Reduce::Min:
+                        combined = builder->CreateSelect(
+                            isDouble ? builder->CreateFCmpOLT(p, x) : builder->CreateICmpSLT(p, x), p, x);
+                        break;
+                    case ParallelLoop::Reduce::Max:
+                        combined = builder->CreateSelect(
+                            isDouble ? builder->CreateFCmpOGT(p, x) : builder->CreateICmpSGT(p, x), p, x);
+                        break;
+                }
+                builder->CreateStore(combined, variable);
+            }
+        });
+    }
+
+    // As after a bet, the counter is the first value past the end
+    llvm::Value* counter = namedValues.find(loop.counter)->second;
+    builder->CreateStore(builder->CreateSelect(builder->CreateICmpSGT(end, begin), end, begin), counter);
+}
+
+// The loop from its header on; tiered loop entries start here too, after
+// the interpreter has run the initialization
+void CodeGen::emitLoop(AST::BetStmtAST* betStmt) {
+    llvm::Function* theFunction = builder->GetInsertBlock()->getParent();
+    llvm::BasicBlock* condBB = llvm::BasicBlock::Create(*context, "loopcond", theFunction);
+    llvm::BasicBlock* loopBB = llvm::BasicBlock::Create(*context, "loop");
+    llvm::BasicBlock* afterBB = llvm::BasicBlock::Create(*context, "afterloop");
+    
+    builder->CreateBr(condBB);
+    builder->SetInsertPoint(condBB);
+    
+    // Generate condition
+    llvm::Value* condValue = nullptr;
+    if (betStmt->getCondition()) {
+        condValue = toBool(generateExpr(betStmt->getCondition()));
+    } else {
+        condValue = builder->getInt1(true);
+    }
+    
+    builder->CreateCondBr(condValue, loopBB, afterBB);
+    
+    theFunction->insert(theFunction->end(), loopBB);
+    builder->SetInsertPoint(loopBB);
+    
+    for (const auto& bodyStmt : betStmt->getBody()) {
+        generateStmt(bodyStmt);
+    }
+    
+    if (betStmt->getIncrement()) {
+        generateStmt(betStmt->getIncrement());
     }
     
-    // Handle expression statements
-    else if (auto exprStmt = dynamic_cast<AST::ExprStmtAST*>(stmt)) {
-        generateExpr(exprStmt->getExpr().get());
+    builder->CreateBr(condBB);
+    
+    theFunction->insert(theFunction->end(), afterBB);
+    builder->SetInsertPoint(afterBB);
+}
+
+// Handle expression statements
+void CodeGen::visitExprStmt(AST::ExprStmtAST* exprStmt) {
+    generateExpr(exprStmt->getExpr());
+}
+
+// Top-level functions are compiled by generateFunction; only nested ones
+// reach the visitor
+void CodeGen::visitBruh(AST::BruhAST* bruh) {
+    throw std::runtime_error("Function '" + std::string(bruh->getName()) +
+                             "' must be declared at the top level");
+}
+
+// Creates the LLVM function for a bruh: internal, so the optimizer sees
+// every caller, and using the fast calling convention, which passes all
+// arguments in registers
+void CodeGen::declareFunction(AST::BruhAST* bruh) {
+    if (functions.count(bruh->getName())) {
+        throw std::runtime_error("Function already defined: " + std::string(bruh->getName()));
+    }
+
+    const FunctionTypes& inferred = types->functions.find(bruh->getName())->second;
+    std::vector<llvm::Type*> paramTypes;
+    for (ValueType param : inferred.params) {
+        paramTypes.push_back(typeOf(param));
+    }
+    auto functionType = llvm::FunctionType::get(typeOf(inferred.result), paramTypes, false);
+    auto function = llvm::Function::Create(
+        functionType,
+        llvm::Function::InternalLinkage,
+        bruh->getName(),
+        module.get()
+    );
+    function->setCallingConv(llvm::CallingConv::Fast);
+
+    size_t index = 0;
+    for (auto& arg : function->args()) {
+        arg.setName(bruh->getParams()[index++]);
+    }
+    functions.emplace(std::string(bruh->getName()), function);
+}
+
+void CodeGen::generateFunction(AST::BruhAST* bruh) {
+    llvm::Function* function = functions.find(bruh->getName())->second;
+
+    // Functions see only their own parameters and locals
+    llvm::IRBuilderBase::InsertPointGuard guard(*builder);
+    std::map<std::string, llvm::Value*, std::less<>> outerValues;
+    outerValues.swap(namedValues);
+    const FunctionTypes* outerTypes = currentTypes;
+    currentTypes = &types->functions.find(bruh->getName())->second;
+
+    auto entry = llvm::BasicBlock::Create(*context, "entry", function);
+    builder->SetInsertPoint(entry);
+
+    // Parameters stay SSA values; only those the body assigns to are
+    // spilled to a stack slot
+    AssignmentFinder assignments(*types);
+    assignments.visitBody(bruh->getBody());
+    for (auto& arg : function->args()) {
+        std::string name(arg.getName());
+        if (assignments.names.count(name)) {
+            llvm::AllocaInst* alloca = builder->CreateAlloca(arg.getType(), nullptr, name);
+            builder->CreateStore(&arg, alloca);
+            namedValues[name] = alloca;
+        } else {
+            namedValues[name] = &arg;
+        }
+    }
+
+    for (const auto& stmt : bruh->getBody()) {
+        generateStmt(stmt);
+    }
+
+    // Falling off the end returns 0, or an empty squad
+    if (!builder->GetInsertBlock()->getTerminator()) {
+        builder->CreateRet(defaultValue(function->getReturnType()));
+    }
+    namedValues.swap(outerValues);
+    currentTypes = outerTypes;
+}
+
+// Handle return statements ('solulu'). In cook it sets the exit code.
+void CodeGen::visitSolulu(AST::SoluluStmtAST* soluluStmt) {
+    llvm::Function* function = builder->GetInsertBlock()->getParent();
+    llvm::Type* resultType = typeOf(currentTypes->result);
+    llvm::Value* value = nullptr;
+    if (soluluStmt->getValue()) {
+        value = generateExpr(soluluStmt->getValue());
+        // Only a bruh can return a squad or a string; cook's value is the
+        // exit code
+        if ((isString(value) || isSquadValue(value)) && currentTypes == &types->main) {
+            throw std::runtime_error("solulu can only return a number");
+        }
+        value = convert(value, resultType);
+    } else {
+        value = defaultValue(resultType);
+    }
+
+    if (osrFrame) {
+        // Leaving a tiered loop entry: the interpreter picks up the
+        // variables and the value from its slots and returns
+        storeFrame();
+        storeCell(osrFrame, osrSlots->size(), value);
+        builder->CreateRet(builder->getInt32(1));
+    } else if (function->getReturnType()->isIntegerTy(32)) {
+        llvm::Value* exitCode = toExitCode(value);
+        builder->CreateCall(module->getFunction("brainrot_flush"));
+        builder->CreateRet(exitCode);
+    } else {
+        // A self-recursive call whose result is returned as is becomes a
+        // jump back to the entry, so deep recursion does not grow the stack
+        auto call = llvm::dyn_cast<llvm::CallInst>(value);
+        if (call && call->getCalledFunction() == function && call == &builder->GetInsertBlock()->back()) {
+            call->setTailCallKind(llvm::CallInst::TCK_MustTail);
+        }
+        builder->CreateRet(value);
+    }
+
+    // Anything after solulu is unreachable but still needs a block
+    builder->SetInsertPoint(llvm::BasicBlock::Create(*context, "afterret", function));
+}
+
+// Neither are classes
+void CodeGen::visitSigma(AST::SigmaAST*) {}
+
+// Emit the statements of a cook body into the current function
+void CodeGen::visitCook(AST::CookAST* cook) {
+    for (const auto& stmt : cook->getBody()) {
+        generateStmt(stmt);
+    }
+}
+
+// The squad held in a variable
+llvm::Value* CodeGen::loadSquad(std::string_view name) {
+    if (namedValues.find(name) != namedValues.end() && !isSquad(currentTypes->variable(name))) {
+        throw std::runtime_error("'" + std::string(name) + "' is not a squad");
+    }
+    return loadVariable(name);
+}
+
+// Field 0 is the length, 1 the capacity and 2 the data
+llvm::Value* CodeGen::loadSquadField(llvm::Value* squad, unsigned field) {
+    return builder->CreateLoad(squadType->getElementType(field), builder->CreateStructGEP(squadType, squad, field));
+}
+
+// The address of name[index], typed as the squad's elements. The index is
+// checked against the length, except in the unchecked version of a loop
+// whose counter it is.
+llvm::Value* CodeGen::squadElement(std::string_view name, AST::ExprAST* indexExpr, llvm::Value* index) {
+    llvm::Value* squad = loadSquad(name);
+    llvm::Type* elementTy = typeOf(elementType(currentTypes->variable(name)));
+    llvm::Value* data = nullptr;
+    llvm::Value* length = nullptr;
+    bool checked = true;
+    if (auto hoisted = hoistedSquads.find(name); hoisted != hoistedSquads.end()) {
+        data = hoisted->second.data;
+        length = hoisted->second.length;
+        auto counter = AST::dyn_cast<AST::VariableExprAST>(indexExpr);
+        const auto& counters = hoisted->second.counters;
+        checked = !counter || std::find(counters.begin(), counters.end(), counter->getName()) == counters.end();
+    } else {
+        length = loadSquadField(squad, 0);
+    }
+
+    if (checked) {
+        // One unsigned comparison also rejects negative indices
+        llvm::Function* theFunction = builder->GetInsertBlock()->getParent();
+        llvm::BasicBlock* failBB = llvm::BasicBlock::Create(*context, "outofbounds", theFunction);
+        llvm::BasicBlock* okBB = llvm::BasicBlock::Create(*context, "inbounds", theFunction);
+        llvm::MDBuilder weights(*context);
+        builder->CreateCondBr(builder->CreateICmpULT(index, length), okBB, failBB,
+                              weights.createBranchWeights(1 << 20, 1));
+        builder->SetInsertPoint(failBB);
+        builder->CreateCall(squadFail(), {index, length});
+        builder->CreateUnreachable();
+        builder->SetInsertPoint(okBB);
+    }
+    if (!data) {
+        data = loadSquadField(squad, 2);
+    }
+    data = builder->CreatePointerCast(data, elementTy->getPointerTo());
+    return builder->CreateInBoundsGEP(elementTy, data, index, "element");
+}
+
+// Squad literals: [a, b, c]
+llvm::Value* CodeGen::visitSquad(AST::SquadExprAST* squadExpr) {
+    llvm::Type* elementTy = typeOf(elementType(currentTypes->squad(squadExpr)));
+    std::vector<llvm::Value*> elements;
+    for (const auto& element : squadExpr->getElements()) {
+        elements.push_back(convert(generateExpr(element), elementTy));
+    }
+    llvm::Value* squad = builder->CreateCall(squadNew(), {builder->getInt64(elements.size())}, "squad");
+    llvm::Value* data = builder->CreatePointerCast(loadSquadField(squad, 2), elementTy->getPointerTo());
+    for (size_t i = 0; i < elements.size(); ++i) {
+        builder->CreateStore(elements[i], builder->CreateConstInBoundsGEP1_64(elementTy, data, i));
+    }
+    return squad;
+}
+
+// Element reads: xs[i]
+llvm::Value* CodeGen::visitIndex(AST::IndexExprAST* indexExpr) {
+    llvm::Value* index = toIndex(generateExpr(indexExpr->getIndex()));
+    llvm::Value* element = squadElement(indexExpr->getName(), indexExpr->getIndex(), index);
+    llvm::Type* elementTy = typeOf(elementType(currentTypes->variable(indexExpr->getName())));
+    return builder->CreateLoad(elementTy, element, indexExpr->getName());
+}
+
+// Element assignment: xs[i] = v
+llvm::Value* CodeGen::visitIndexAssign(AST::IndexAssignExprAST* assignExpr) {
+    llvm::Value* index = toIndex(generateExpr(assignExpr->getIndex()));
+    llvm::Value* value = generateExpr(assignExpr->getValue());
+    llvm::Value* element = squadElement(assignExpr->getName(), assignExpr->getIndex(), index);
+    value = convert(value, typeOf(elementType(currentTypes->variable(assignExpr->getName()))));
+    builder->CreateStore(value, element);
+    return value;
+}
+
+// xs.length is a load, or the value loaded before an unchecked loop
+llvm::Value* CodeGen::visitLength(AST::LengthExprAST* lengthExpr) {
+    std::string_view name = lengthExpr->getName();
+    ValueType type = currentTypes->variable(name);
+    if (type == ValueType::String) {
+        llvm::Value* string = builder->CreateExtractValue(loadVariable(name), 0);
+        return builder->CreateCall(module->getFunction("brainrot_string_length"), {string}, "length");
+    }
+    if (namedValues.find(name) != namedValues.end() && !isSquad(type)) {
+        throw std::runtime_error("'" + std::string(name) + "' is not a squad or a string");
+    }
+    llvm::Value* squad = loadSquad(lengthExpr->getName());
+    if (auto hoisted = hoistedSquads.find(lengthExpr->getName()); hoisted != hoistedSquads.end()) {
+        return hoisted->second.length;
+    }
+    return loadSquadField(squad, 0);
+}
+
+// Insertion ('yoink'): the helper makes room and returns the new slot
+void CodeGen::visitYoink(AST::YoinkStmtAST* yoinkStmt) {
+    llvm::Value* index = toIndex(generateExpr(yoinkStmt->getIndex()));
+    llvm::Value* value = generateExpr(yoinkStmt->getValue());
+    llvm::Value* squad = loadSquad(yoinkStmt->getName());
+    llvm::Type* elementTy = typeOf(elementType(currentTypes->variable(yoinkStmt->getName())));
+    value = convert(value, elementTy);
+    llvm::Value* slot = builder->CreateCall(squadInsert(), {squad, index}, "slot");
+    builder->CreateStore(value, builder->CreatePointerCast(slot, elementTy->getPointerTo()));
+}
+
+// Removal ('yeet')
+void CodeGen::visitYeet(AST::YeetStmtAST* yeetStmt) {
+    llvm::Value* index = toIndex(generateExpr(yeetStmt->getIndex()));
+    llvm::Value* squad = loadSquad(yeetStmt->getName());
+    builder->CreateCall(squadRemove(), {squad, index});
+}
+
+// Starts an internal helper function at its entry block; callers restore
+// their insert point with a guard
+llvm::Function* CodeGen::createHelper(const char* name, llvm::Type* result, llvm::ArrayRef<llvm::Type*> params) {
+    auto function = llvm::Function::Create(llvm::FunctionType::get(result, params, false),
+                                           llvm::Function::InternalLinkage, name, module.get());
+    builder->SetInsertPoint(llvm::BasicBlock::Create(*context, "entry", function));
+    return function;
+}
+
+// squad.new(length): a squad of length zeroes, allocated with calloc like
+// squad.cpp's newSquad, and failing the same way when memory runs out
+llvm::Function* CodeGen::squadNew() {
+    if (llvm::Function* existing = module->getFunction("squad.new")) {
+        return existing;
     }
+    llvm::IRBuilderBase::InsertPointGuard guard(*builder);
+    llvm::Type* bytes = builder->getInt8Ty()->getPointerTo();
+    llvm::Function* function = createHelper("squad.new", squadType->getPointerTo(), {builder->getInt64Ty()});
+    auto calloc = module->getOrInsertFunction(
+        "calloc", llvm::FunctionType::get(bytes, {builder->getInt64Ty(), builder->getInt64Ty()}, false));
+
+    llvm::BasicBlock* failBB = llvm::BasicBlock::Create(*context, "outofmemory", function);
+    llvm::BasicBlock* allocateBB = llvm::BasicBlock::Create(*context, "allocate", function);
+    llvm::BasicBlock* initBB = llvm::BasicBlock::Create(*context, "init", function);
+
+    // A length whose size in bytes overflows is out of memory too
+    llvm::Value* length = function->getArg(0);
+    length = builder->CreateSelect(builder->CreateICmpSLT(length, builder->getInt64(0)), builder->getInt64(0), length);
+    builder->CreateCondBr(builder->CreateICmpUGT(length, builder->getInt64(INT64_MAX / 8)), failBB, allocateBB);
+    builder->SetInsertPoint(failBB);
+    builder->CreateCall(failHelper("squad.outofmemory", "Error: Out of memory\n"));
+    builder->CreateUnreachable();
+
+    // calloc may return null for no elements, which is a valid empty squad
+    builder->SetInsertPoint(allocateBB);
+    uint64_t size = module->getDataLayout().getTypeAllocSize(squadType);
+    llvm::Value* block = builder->CreateCall(calloc, {builder->getInt64(1), builder->getInt64(size)});
+    llvm::Value* data = builder->CreateCall(calloc, {length, builder->getInt64(8)});
+    llvm::Value* failed = builder->CreateOr(
+        builder->CreateIsNull(block),
+        builder->CreateAnd(builder->CreateIsNull(data), builder->CreateICmpNE(length, builder->getInt64(0))));
+    builder->CreateCondBr(failed, failBB, initBB);
+
+    builder->SetInsertPoint(initBB);
+    llvm::Value* squad = builder->CreatePointerCast(block, squadType->getPointerTo());
+    builder->CreateStore(length, builder->CreateStructGEP(squadType, squad, 0));
+    builder->CreateStore(length, builder->CreateStructGEP(squadType, squad, 1));
+    builder->CreateStore(builder->CreatePointerCast(data, squadType->getElementType(2)),
+                         builder->CreateStructGEP(squadType, squad, 2));
+    builder->CreateRet(squad);
+    return function;
+}
+
+// squad.insert(squad, index): moves the elements from index on up by one,
+// growing the squad as squad.cpp's squadInsert does, and returns the
+// address of the free slot at index
+llvm::Function* CodeGen::squadInsert() {
+    if (llvm::Function* existing = module->getFunction("squad.insert")) {
+        return existing;
+    }
+    llvm::IRBuilderBase::InsertPointGuard guard(*builder);
+    llvm::Type* i64 = builder->getInt64Ty();
+    llvm::Type* bytes = builder->getInt8Ty()->getPointerTo();
+    llvm::Type* dataType = squadType->getElementType(2);
+    llvm::Function* function = createHelper("squad.insert", dataType, {squadType->getPointerTo(), i64});
+    llvm::Value* squad = function->getArg(0);
+    llvm::Value* index = function->getArg(1);
+    llvm::BasicBlock* failBB = llvm::BasicBlock::Create(*context, "outofbounds", function);
+    llvm::BasicBlock* checkBB = llvm::BasicBlock::Create(*context, "check", function);
+    llvm::BasicBlock* growBB = llvm::BasicBlock::Create(*context, "grow", function);
+    llvm::BasicBlock* reallocBB = llvm::BasicBlock::Create(*context, "realloc", function);
+    llvm::BasicBlock* grownBB = llvm::BasicBlock::Create(*context, "grown", function);
+    llvm::BasicBlock* oomBB = llvm::BasicBlock::Create(*context, "outofmemory", function);
+    llvm::BasicBlock* insertBB = llvm::BasicBlock::Create(*context, "insert", function);
+
+    // index == length appends
+    llvm::Value* length = loadSquadField(squad, 0);
+    builder->CreateCondBr(builder->CreateICmpULE(index, length), checkBB, failBB);
+    builder->SetInsertPoint(failBB);
+    builder->CreateCall(squadFail(), {index, length});
+    builder->CreateUnreachable();
+
+    builder->SetInsertPoint(checkBB);
+    llvm::Value* capacity = loadSquadField(squad, 1);
+    builder->CreateCondBr(builder->CreateICmpEQ(length, capacity), growBB, insertBB);
+
+    // At least 4 elements, then doubling, failing as squadNew does when
+    // memory runs out
+    builder->SetInsertPoint(growBB);
+    llvm::Value* grown = builder->CreateSelect(builder->CreateICmpSLT(capacity, builder->getInt64(4)),
+                                               builder->getInt64(4), builder->CreateShl(capacity, 1));
+    builder->CreateCondBr(builder->CreateICmpUGT(grown, builder->getInt64(INT64_MAX / 8)), oomBB, reallocBB);
+    builder->SetInsertPoint(oomBB);
+    builder->CreateCall(failHelper("squad.outofmemory", "Error: Out of memory\n"));
+    builder->CreateUnreachable();
+
+    builder->SetInsertPoint(reallocBB);
+    auto realloc = module->getOrInsertFunction("realloc", llvm::FunctionType::get(bytes, {bytes, i64}, false));
+    llvm::Value* old = builder->CreatePointerCast(loadSquadField(squad, 2), bytes);
+    llvm::Value* block = builder->CreateCall(realloc, {old, builder->CreateMul(grown, builder->getInt64(8))});
+    builder->CreateCondBr(builder->CreateIsNull(block), oomBB, grownBB);
+
+    builder->SetInsertPoint(grownBB);
+    builder->CreateStore(builder->CreatePointerCast(block, dataType), builder->CreateStructGEP(squadType, squad, 2));
+    builder->CreateStore(grown, builder->CreateStructGEP(squadType, squad, 1));
+    builder->CreateBr(insertBB);
+
+    builder->SetInsertPoint(insertBB);
+    llvm::Value* data = loadSquadField(squad, 2);
+    llvm::Value* slot = builder->CreateInBoundsGEP(i64, data, index);
+    llvm::Value* next = builder->CreateInBoundsGEP(i64, data, builder->CreateAdd(index, builder->getInt64(1)));
+    llvm::Value* moved = builder->CreateMul(builder->CreateSub(length, index), builder->getInt64(8));
+    builder->CreateMemMove(next, llvm::MaybeAlign(8), slot, llvm::MaybeAlign(8), moved);
+    builder->CreateStore(builder->CreateAdd(length, builder->getInt64(1)), builder->CreateStructGEP(squadType, squad, 0));
+    builder->CreateRet(slot);
+    return function;
+}
+
+// squad.remove(squad, index): moves the elements after index down by one
+llvm::Function* CodeGen::squadRemove() {
+    if (llvm::Function* existing = module->getFunction("squad.remove")) {
+        return existing;
+    }
+    llvm::IRBuilderBase::InsertPointGuard guard(*builder);
+    llvm::Type* i64 = builder->getInt64Ty();
+    llvm::Function* function = createHelper("squad.remove", builder->getVoidTy(), {squadType->getPointerTo(), i64});
+    llvm::Value* squad = function->getArg(0);
+    llvm::Value* index = function->getArg(1);
+    llvm::BasicBlock* failBB = llvm::BasicBlock::Create(*context, "outofbounds", function);
+    llvm::BasicBlock* removeBB = llvm::BasicBlock::Create(*context, "remove", function);
+
+    llvm::Value* length = loadSquadField(squad, 0);
+    builder->CreateCondBr(builder->CreateICmpULT(index, length), removeBB, failBB);
+    builder->SetInsertPoint(failBB);
+    builder->CreateCall(squadFail(), {index, length});
+    builder->CreateUnreachable();
+
+    builder->SetInsertPoint(removeBB);
+    llvm::Value* data = loadSquadField(squad, 2);
+    llvm::Value* slot = builder->CreateInBoundsGEP(i64, data, index);
+    llvm::Value* next = builder->CreateInBoundsGEP(i64, data, builder->CreateAdd(index, builder->getInt64(1)));
+    llvm::Value* last = builder->CreateSub(length, builder->getInt64(1));
+    llvm::Value* moved = builder->CreateMul(builder->CreateSub(last, index), builder->getInt64(8));
+    builder->CreateMemMove(slot, llvm::MaybeAlign(8), next, llvm::MaybeAlign(8), moved);
+    builder->CreateStore(last, builder->CreateStructGEP(squadType, squad, 0));
+    builder->CreateRetVoid();
+    return function;
+}
+
+// squad.fail(index, length): reports an out of bounds index the way the
+// interpreter and the VM do, after the program's own output, and exits
+llvm::Function* CodeGen::squadFail() {
+    if (llvm::Function* existing = module->getFunction("squad.fail")) {
+        return existing;
+    }
+    llvm::IRBuilderBase::InsertPointGuard guard(*builder);
+    llvm::Type* i32 = builder->getInt32Ty();
+    llvm::Type* bytes = builder->getInt8Ty()->getPointerTo();
+    llvm::Function* function =
+        createHelper("squad.fail", builder->getVoidTy(), {builder->getInt64Ty(), builder->getInt64Ty()});
+    function->addFnAttr(llvm::Attribute::NoReturn);
+    function->addFnAttr(llvm::Attribute::Cold);
+    auto dprintf = module->getOrInsertFunction("dprintf", llvm::FunctionType::get(i32, {i32, bytes}, true));
+    auto exit = module->getOrInsertFunction("exit", llvm::FunctionType::get(builder->getVoidTy(), {i32}, false));
+
+    builder->CreateCall(module->getFunction("brainrot_flush"));
+    builder->CreateCall(dprintf, {builder->getInt32(2),
+                                  builder->CreateGlobalStringPtr("Error: Squad index %lld out of bounds for length %lld\n"),
+                                  function->getArg(0), function->getArg(1)});
+    builder->CreateCall(exit, {builder->getInt32(1)});
+    builder->CreateUnreachable();
+    return function;
+}
+
+// A helper that reports a runtime error as the interpreter and the VM do,
+// after the program's own output, and exits
+llvm::Function* CodeGen::failHelper(const char* name, const char* message) {
+    if (llvm::Function* existing = module->getFunction(name)) {
+        return existing;
+    }
+    llvm::IRBuilderBase::InsertPointGuard guard(*builder);
+    llvm::Type* i32 = builder->getInt32Ty();
+    llvm::Type* bytes = builder->getInt8Ty()->getPointerTo();
+    llvm::Function* function = createHelper(name, builder->getVoidTy(), {});
+    function->addFnAttr(llvm::Attribute::NoReturn);
+    function->addFnAttr(llvm::Attribute::Cold);
+    auto dprintf = module->getOrInsertFunction("dprintf", llvm::FunctionType::get(i32, {i32, bytes}, true));
+    auto exit = module->getOrInsertFunction("exit", llvm::FunctionType::get(builder->getVoidTy(), {i32}, false));
+
+    builder->CreateCall(module->getFunction("brainrot_flush"));
+    builder->CreateCall(dprintf, {builder->getInt32(2), builder->CreateGlobalStringPtr(message)});
+    builder->CreateCall(exit, {builder->getInt32(1)});
+    builder->CreateUnreachable();
+    return function;
 }
 
 void CodeGen::executeCode() {
     // Ensure JIT is properly initialized
-    if (!jit) {
+    if (!createJIT()) {
         llvm::errs() << "JIT not initialized\n";
         return;
     }
@@ -361,12 +1868,47 @@ void CodeGen::executeCode() {
     );
 
     // Add module to JIT compiler
-    if (auto err = jit->addIRModule(std::move(threadSafeModule))) {
+    auto added = options.lazy
+        ? static_cast<llvm::orc::LLLazyJIT&>(*jit).addLazyIRModule(std::move(threadSafeModule))
+        : jit->addIRModule(std::move(threadSafeModule));
+    if (auto err = std::move(added)) {
         llvm::errs() << "Error adding module to JIT: " 
                      << toString(std::move(err)) << "\n";
         return;
     }
 
+    runMain();
+}
+
+bool CodeGen::executeCached(std::string_view source) {
+    // Entries hold whole programs, which lazy mode never compiles
+    if (options.cacheDir.empty() || options.lazy || !targetBuilder) {
+        return false;
+    }
+
+    // Created even on a miss, so executeCode stores what it compiles
+    std::string key = DiskObjectCache::programKey(source, options.optLevel, targetBuilder->getCPU(),
+                                                  targetBuilder->getFeatures().getString());
+    objectCache = std::make_unique<DiskObjectCache>(options.cacheDir, key, options.cacheMaxBytes);
+    auto object = objectCache->load(module->getModuleIdentifier());
+    if (!object) {
+        return false;
+    }
+
+    if (!createJIT()) {
+        llvm::errs() << "JIT not initialized\n";
+        return true;
+    }
+    if (auto err = jit->addObjectFile(std::move(object))) {
+        llvm::errs() << "Error adding cached object to JIT: "
+                     << toString(std::move(err)) << "\n";
+        return true;
+    }
+    runMain();
+    return true;
+}
+
+void CodeGen::runMain() {
     // Look up main function
     auto mainSymbol = jit->lookup("main");
     if (!mainSymbol) {
@@ -375,14 +1917,268 @@ void CodeGen::executeCode() {
         return;
     }
 
+    // Eager compilation happened during the lookup; report it before the
+    // program's own output. Lazy compilation goes on while main runs.
+    if (passTimer && !options.lazy) {
+        passTimer->print();
+    }
+    if (remarksOutput) {
+        remarksOutput->keep();
+    }
+
     // Execute main function
     auto mainFn = llvm::jitTargetAddressToFunction<int(*)()>(
         mainSymbol->getValue()
     );
 
+    // The program prints through C stdio; flush around it so its output
+    // lands between these lines even when stdout is not a terminal
     llvm::outs() << "Executing main function...\n";
+    llvm::outs().flush();
     int result = mainFn();
+    brainrot_flush();
+    std::fflush(stdout);
     llvm::outs() << "Program finished with code: " << result << "\n";
+    if (passTimer && options.lazy) {
+        passTimer->print();
+    }
+}
+
+// Replaces the module with an empty one for the next tiered compile
+void CodeGen::startTierModule(const std::string& name) {
+    // The old module and builder belong to the old context
+    builder.reset();
+    module.reset();
+    context = std::make_unique<llvm::LLVMContext>();
+    module = std::make_unique<llvm::Module>(name, *context);
+    builder = std::make_unique<llvm::IRBuilder<>>(*context);
+    module->setTargetTriple(targetMachine->getTargetTriple().str());
+    module->setDataLayout(targetMachine->createDataLayout());
+    namedValues.clear();
+    functions.clear();
+    currentTypes = nullptr;
+    osrFrame = nullptr;
+    osrSlots = nullptr;
+    declareRuntime();
+}
+
+bool CodeGen::addTierModule() {
+    if (!jit && !createJIT()) {
+        return false;
+    }
+    auto threadSafeModule = llvm::orc::ThreadSafeModule(std::move(module), std::move(context));
+    if (auto err = jit->addIRModule(std::move(threadSafeModule))) {
+        llvm::errs() << "Error adding module to JIT: " << toString(std::move(err)) << "\n";
+        return false;
+    }
+    return true;
+}
+
+// Copies every variable of a loop entry back to the interpreter's slots
+void CodeGen::storeFrame() {
+    for (size_t i = 0; i < osrSlots->size(); ++i) {
+        auto slot = llvm::cast<llvm::AllocaInst>(namedValues.find((*osrSlots)[i])->second);
+        storeCell(osrFrame, i, builder->CreateLoad(slot->getAllocatedType(), slot));
+    }
+}
+
+// Reads a TierCell as a value of the given type
+llvm::Value* CodeGen::loadCell(llvm::Value* cells, size_t index, llvm::Type* type) {
+    llvm::Value* cell = builder->CreateConstInBoundsGEP1_64(builder->getInt64Ty(), cells, index);
+    llvm::Value* bits = builder->CreateLoad(builder->getInt64Ty(), cell);
+    if (type->isIntegerTy(1)) {
+        return builder->CreateICmpNE(bits, builder->getInt64(0));
+    }
+    if (type == stringType) {
+        return fromStringWord(bits);
+    }
+    if (type->isPointerTy()) {
+        return builder->CreateIntToPtr(bits, type);
+    }
+    return builder->CreateBitCast(bits, type);
+}
+
+void CodeGen::storeCell(llvm::Value* cells, size_t index, llvm::Value* value) {
+    builder->CreateStore(toCell(value), builder->CreateConstInBoundsGEP1_64(builder->getInt64Ty(), cells, index));
+}
+
+// The TierCell bits of a value
+llvm::Value* CodeGen::toCell(llvm::Value* value) {
+    if (value->getType()->isIntegerTy(1)) {
+        return builder->CreateZExt(value, builder->getInt64Ty());
+    }
+    if (isString(value)) {
+        return builder->CreateExtractValue(value, 0);
+    }
+    if (value->getType()->isPointerTy()) {
+        return builder->CreatePtrToInt(value, builder->getInt64Ty());
+    }
+    return builder->CreateBitCast(value, builder->getInt64Ty());
+}
+
+std::vector<CodeGen::TierFunction> CodeGen::compileFunctions(const ProgramTypes& types,
+                                                             const std::vector<AST::BruhAST*>& bruhs) {
+    if (!targetMachine) {
+        return {};
+    }
+    std::string prefix = "tier" + std::to_string(tierModules++);
+    startTierModule(prefix);
+    this->types = &types;
+    for (AST::BruhAST* bruh : bruhs) {
+        declareFunction(bruh);
+    }
+    for (AST::BruhAST* bruh : bruhs) {
+        generateFunction(bruh);
+    }
+
+    // The functions stay internal and fastcc; each gets a C entry point
+    // that unpacks the argument array
+    auto argsType = builder->getInt64Ty()->getPointerTo();
+    auto entryType = llvm::FunctionType::get(builder->getInt64Ty(), {argsType}, false);
+    std::vector<std::string> entryNames;
+    for (AST::BruhAST* bruh : bruhs) {
+        llvm::Function* function = functions.find(bruh->getName())->second;
+        entryNames.push_back(prefix + "." + std::string(bruh->getName()));
+        auto entry = llvm::Function::Create(entryType, llvm::Function::ExternalLinkage,
+                                            entryNames.back(), module.get());
+        builder->SetInsertPoint(llvm::BasicBlock::Create(*context, "entry", entry));
+        std::vector<llvm::Value*> args;
+        for (size_t i = 0; i < function->arg_size(); ++i) {
+            args.push_back(loadCell(entry->getArg(0), i, function->getArg(i)->getType()));
+        }
+        llvm::CallInst* call = builder->CreateCall(function, args);
+        call->setCallingConv(function->getCallingConv());
+        builder->CreateRet(toCell(call));
+    }
+    if (!addTierModule()) {
+        return {};
+    }
+
+    std::vector<TierFunction> entries;
+    for (const std::string& name : entryNames) {
+        auto entrySymbol = jit->lookup(name);
+        if (!entrySymbol) {
+            llvm::errs() << "Could not find " << name << ": " << toString(entrySymbol.takeError()) << "\n";
+            return {};
+        }
+        entries.push_back(llvm::jitTargetAddressToFunction<TierFunction>(entrySymbol->getValue()));
+    }
+    return entries;
+}
+
+// Compiles a loop that the interpreter is already running, entered at its
+// header. Every variable of the enclosing function is loaded from the
+// interpreter's slots on entry and stored back on exit.
+CodeGen::TierLoop CodeGen::compileLoop(const ProgramTypes& types, const FunctionTypes& owner,
+                                       const std::vector<AST::BruhAST*>& callees, AST::BetStmtAST* loop,
+                                       const std::vector<std::string_view>& slots) {
+    if (!targetMachine) {
+        return nullptr;
+    }
+    std::string name = "tier" + std::to_string(tierModules++) + ".loop";
+    startTierModule(name);
+    this->types = &types;
+    for (AST::BruhAST* bruh : callees) {
+        declareFunction(bruh);
+    }
+    for (AST::BruhAST* bruh : callees) {
+        generateFunction(bruh);
+    }
+
+    auto frameType = builder->getInt64Ty()->getPointerTo();
+    auto entryType = llvm::FunctionType::get(builder->getInt32Ty(), {frameType}, false);
+    auto entry = llvm::Function::Create(entryType, llvm::Function::ExternalLinkage, name, module.get());
+    builder->SetInsertPoint(llvm::BasicBlock::Create(*context, "entry", entry));
+    osrFrame = entry->getArg(0);
+    osrSlots = &slots;
+    currentTypes = &owner;
+    for (size_t i = 0; i < slots.size(); ++i) {
+        llvm::Type* type = typeOf(owner.variable(slots[i]));
+        llvm::AllocaInst* alloca = builder->CreateAlloca(type, nullptr, slots[i]);
+        builder->CreateStore(loadCell(osrFrame, i, type), alloca);
+        namedValues[std::string(slots[i])] = alloca;
+    }
+
+    emitLoop(loop);
+    storeFrame();
+    builder->CreateRet(builder->getInt32(0));
+    osrFrame = nullptr;
+    osrSlots = nullptr;
+    if (!addTierModule()) {
+        return nullptr;
+    }
+
+    auto entrySymbol = jit->lookup(name);
+    if (!entrySymbol) {
+        llvm::errs() << "Could not find " << name << ": " << toString(entrySymbol.takeError()) << "\n";
+        return nullptr;
+    }
+    return llvm::jitTargetAddressToFunction<TierLoop>(entrySymbol->getValue());
+}
+
+bool CodeGen::emitFile(const std::string& path, OutputKind kind) {
+    if (!targetMachine) {
+        llvm::errs() << "Target machine not initialized\n";
+        return false;
+    }
+
+    // The JIT optimizes as it compiles; here the module is optimized up front
+    if (options.optLevel > 0) {
+        optimizeModule(*module);
+    }
+
+    std::error_code ec;
+    auto flags = kind == OutputKind::Object ? llvm::sys::fs::OF_None : llvm::sys::fs::OF_Text;
+    llvm::raw_fd_ostream out(path, ec, flags);
+    if (ec) {
+        llvm::errs() << "Could not open " << path << ": " << ec.message() << "\n";
+        return false;
+    }
+
+    if (kind == OutputKind::LLVMIR) {
+        module->print(out, nullptr);
+    } else {
+        llvm::legacy::PassManager passes;
+        auto fileType = kind == OutputKind::Object ? llvm::CGFT_ObjectFile : llvm::CGFT_AssemblyFile;
+        if (targetMachine->addPassesToEmitFile(passes, out, nullptr, fileType)) {
+            llvm::errs() << "The target cannot emit this file type\n";
+            return false;
+        }
+        passes.run(*module);
+    }
+    out.flush();
+
+    if (passTimer) {
+        passTimer->print();
+    }
+    if (remarksOutput) {
+        remarksOutput->keep();
+    }
+    return true;
+}
+
+bool linkExecutable(const std::string& objectPath, const std::string& outputPath) {
+    // The system compiler driver knows where the C runtime and libc live;
+    // the C++ one also links the standard library the runtime uses
+    auto linker = llvm::sys::findProgramByName("c++");
+    if (!linker) {
+        llvm::errs() << "Could not find the system linker 'c++'\n";
+        return false;
+    }
+
+    // frem lowers to fmod, which lives in libm; goated bet loops run on threads
+    llvm::StringRef args[] = {*linker, objectPath, BRAINROT_RT_LIBRARY, "-o", outputPath, "-lm", "-lpthread"};
+    std::string message;
+    int result = llvm::sys::ExecuteAndWait(*linker, args, {}, {}, 0, 0, &message);
+    if (result != 0) {
+        llvm::errs() << "Linking failed";
+        if (!message.empty()) {
+            llvm::errs() << ": " << message;
+        }
+        llvm::errs() << "\n";
+        return false;
+    }
+    return true;
 }
 
 // Helper function to generate appropriate printf format string based on value type
@@ -391,9 +2187,9 @@ llvm::Value* CodeGen::getFormatString(llvm::Value* exprValue) {
     if (exprValue->getType()->isDoubleTy()) {
         return builder->CreateGlobalStringPtr("%.6f\n");
     } 
-    // For integer types, use %d format
+    // For integer types, use %lld format (integers are 64-bit)
     else if (exprValue->getType()->isIntegerTy()) {
-        return builder->CreateGlobalStringPtr("%d\n");
+        return builder->CreateGlobalStringPtr("%lld\n");
     } 
     // For pointer types (strings), use %s format
     else if (exprValue->getType()->isPointerTy()) {
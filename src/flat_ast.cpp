@@ -0,0 +1,209 @@
+#include "flat_ast.h"
+#include <algorithm>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+
+namespace AST {
+
+namespace {
+
+constexpr char flatMagic[8] = {'S', 'K', 'F', 'L', 'A', 'T', '0', '4'};
+
+template <typename T>
+void writeTable(std::ostream& out, const std::vector<T>& table) {
+    uint64_t count = table.size();
+    out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    out.write(reinterpret_cast<const char*>(table.data()),
+              static_cast<std::streamsize>(count * sizeof(T)));
+}
+
+template <typename T>
+void readTable(std::istream& in, std::vector<T>& table) {
+    uint64_t count = 0;
+    in.read(reinterpret_cast<char*>(&count), sizeof(count));
+    if (!in) throw std::runtime_error("Truncated flat AST");
+    table.resize(count);
+    in.read(reinterpret_cast<char*>(table.data()),
+            static_cast<std::streamsize>(count * sizeof(T)));
+    if (!in) throw std::runtime_error("Truncated flat AST");
+}
+
+const char* kindName(FlatKind kind) {
+    switch (kind) {
+        case FlatKind::IntLiteral: return "IntLiteral";
+        case FlatKind::FloatLiteral: return "FloatLiteral";
+        case FlatKind::String: return "String";
+        case FlatKind::Variable: return "Variable";
+        case FlatKind::Binary: return "Binary";
+        case FlatKind::Unary: return "Unary";
+        case FlatKind::Grouping: return "Grouping";
+        case FlatKind::Assign: return "Assign";
+        case FlatKind::Call: return "Call";
+        case FlatKind::Squad: return "Squad";
+        case FlatKind::Index: return "Index";
+        case FlatKind::IndexAssign: return "IndexAssign";
+        case FlatKind::Length: return "Length";
+        case FlatKind::Yap: return "Yap";
+        case FlatKind::Sus: return "Sus";
+        case FlatKind::Bet: return "Bet";
+        case FlatKind::GoatedBet: return "GoatedBet";
+        case FlatKind::Bruh: return "Bruh";
+        case FlatKind::ExprStmt: return "ExprStmt";
+        case FlatKind::VarDecl: return "VarDecl";
+        case FlatKind::Solulu: return "Solulu";
+        case FlatKind::Yoink: return "Yoink";
+        case FlatKind::Yeet: return "Yeet";
+        case FlatKind::Sigma: return "Sigma";
+        case FlatKind::Cook: return "Cook";
+        case FlatKind::Program: return "Program";
+    }
+    return "?";
+}
+
+}
+
+NodeIndex FlatAST::add(FlatKind kind, FlatNode node) {
+    kinds.push_back(kind);
+    nodes.push_back(node);
+    return static_cast<NodeIndex>(kinds.size() - 1);
+}
+
+uint32_t FlatAST::addInt(int64_t value) {
+    ints.push_back(value);
+    return static_cast<uint32_t>(ints.size() - 1);
+}
+
+uint32_t FlatAST::addFloat(double value) {
+    floats.push_back(value);
+    return static_cast<uint32_t>(floats.size() - 1);
+}
+
+uint32_t FlatAST::addList(const uint32_t* items, size_t count) {
+    uint32_t index = static_cast<uint32_t>(lists.size());
+    lists.push_back(static_cast<uint32_t>(count));
+    lists.insert(lists.end(), items, items + count);
+    return index;
+}
+
+uint32_t FlatAST::addString(std::string_view text) {
+    // Keys view the caller's text (the source buffer), which outlives the
+    // build; stringData may reallocate, so it cannot be viewed instead
+    auto it = internedStrings.find(text);
+    if (it != internedStrings.end()) return it->second;
+
+    uint32_t index = static_cast<uint32_t>(stringOffsets.size());
+    stringOffsets.push_back(static_cast<uint32_t>(stringData.size()));
+    stringLengths.push_back(static_cast<uint32_t>(text.size()));
+    stringData.append(text);
+    internedStrings.emplace(text, index);
+    return index;
+}
+
+size_t FlatAST::memoryUsage() const {
+    return kinds.capacity() * sizeof(FlatKind) +
+           nodes.capacity() * sizeof(FlatNode) +
+           ints.capacity() * sizeof(int64_t) +
+           floats.capacity() * sizeof(double) +
+           (stringOffsets.capacity() + stringLengths.capacity() + lists.capacity()) * sizeof(uint32_t) +
+           stringData.capacity();
+}
+
+void FlatAST::serialize(std::ostream& out) const {
+    out.write(flatMagic, sizeof(flatMagic));
+    out.write(reinterpret_cast<const char*>(&root), sizeof(root));
+    writeTable(out, kinds);
+    writeTable(out, nodes);
+    writeTable(out, ints);
+    writeTable(out, floats);
+    writeTable(out, stringOffsets);
+    writeTable(out, stringLengths);
+    writeTable(out, lists);
+    std::vector<char> chars(stringData.begin(), stringData.end());
+    writeTable(out, chars);
+}
+
+FlatAST FlatAST::deserialize(std::istream& in) {
+    char magic[sizeof(flatMagic)];
+    in.read(magic, sizeof(magic));
+    if (!in || !std::equal(magic, magic + sizeof(magic), flatMagic)) {
+        throw std::runtime_error("Not a serialized flat AST");
+    }
+
+    FlatAST ast;
+    in.read(reinterpret_cast<char*>(&ast.root), sizeof(ast.root));
+    readTable(in, ast.kinds);
+    readTable(in, ast.nodes);
+    readTable(in, ast.ints);
+    readTable(in, ast.floats);
+    readTable(in, ast.stringOffsets);
+    readTable(in, ast.stringLengths);
+    readTable(in, ast.lists);
+    std::vector<char> chars;
+    readTable(in, chars);
+    ast.stringData.assign(chars.begin(), chars.end());
+    return ast;
+}
+
+void FlatAST::dump(std::ostream& out) const {
+    auto node = [&](uint32_t index) { out << " %" << index; };
+    auto list = [&](uint32_t index) {
+        out << " [";
+        for (uint32_t i = 0; i < listSize(index); ++i) {
+            out << (i ? " %" : "%") << listItems(index)[i];
+        }
+        out << ']';
+    };
+
+    for (NodeIndex i = 0; i < size(); ++i) {
+        const FlatNode& n = nodes[i];
+        out << '%' << i << " = " << kindName(kinds[i]);
+        switch (kinds[i]) {
+            case FlatKind::IntLiteral: out << ' ' << ints[n.a]; break;
+            case FlatKind::FloatLiteral: out << ' ' << floats[n.a]; break;
+            case FlatKind::String: out << " \"" << string(n.a) << '"'; break;
+            case FlatKind::Variable: out << ' ' << string(n.a); break;
+            case FlatKind::Binary: out << ' ' << spelling(static_cast<BinaryOp>(n.a)); node(n.b); node(n.c); break;
+            case FlatKind::Unary: out << ' ' << spelling(static_cast<UnaryOp>(n.a)); node(n.b); break;
+            case FlatKind::Grouping:
+            case FlatKind::ExprStmt: node(n.a); break;
+            case FlatKind::Assign:
+            case FlatKind::VarDecl:
+            case FlatKind::Index:
+            case FlatKind::Yeet: out << ' ' << string(n.a); node(n.b); break;
+            case FlatKind::IndexAssign:
+            case FlatKind::Yoink: out << ' ' << string(n.a); node(n.b); node(n.c); break;
+            case FlatKind::Length: out << ' ' << string(n.a); break;
+            case FlatKind::Call: out << ' ' << string(n.a); list(n.b); break;
+            case FlatKind::Yap:
+            case FlatKind::Squad:
+            case FlatKind::Cook: list(n.a); break;
+            case FlatKind::Sus: node(n.a); list(n.b); list(n.c); break;
+            case FlatKind::Bet:
+            case FlatKind::GoatedBet: node(n.a); node(n.b); node(n.c); list(n.d); break;
+            case FlatKind::Sigma: out << ' ' << string(n.a); list(n.b); break;
+            case FlatKind::Program: list(n.a); node(n.b); break;
+            case FlatKind::Solulu: if (n.a != noNode) node(n.a); break;
+            case FlatKind::Bruh:
+                out << ' ' << string(n.a) << " (";
+                for (uint32_t p = 0; p < listSize(n.b); ++p) {
+                    out << (p ? ", " : "") << string(listItems(n.b)[p]);
+                }
+                out << ')';
+                list(n.c);
+                break;
+        }
+        out << '\n';
+    }
+}
+
+FlatBuilder::NameList FlatBuilder::nameList(const std::string_view* names, size_t count) {
+    std::vector<uint32_t> indices;
+    indices.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        indices.push_back(ast.addString(names[i]));
+    }
+    return ast.addList(indices.data(), indices.size());
+}
+
+}
@@ -0,0 +1,507 @@
+#include "fold.h"
+#include "ast_visitor.h"
+#include "types.h"
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace {
+    using AST::BinaryOp;
+
+    // A value known at compile time. Comparisons give truth values, which
+    // have no literal of their own and are written back as 0 or 1.
+    struct Constant {
+        ValueType type = ValueType::Unknown;
+        int64_t intValue = 0;  // Also the truth values, as 0 or 1
+        double doubleValue = 0.0;
+        std::string_view stringValue{};
+
+        bool known() const { return type != ValueType::Unknown; }
+        bool isNumber() const { return known() && type != ValueType::String; }
+        double asDouble() const { return type == ValueType::Double ? doubleValue : static_cast<double>(intValue); }
+        // As CodeGen's toBool: non-zero numbers are true
+        bool truth() const { return type == ValueType::Double ? asDouble() != 0.0 : intValue != 0; }
+    };
+
+    Constant truthValue(bool value) {
+        return {ValueType::Bool, value ? 1 : 0};
+    }
+
+    Constant integer(int64_t value) {
+        return {ValueType::Int, value};
+    }
+
+    Constant floating(double value) {
+        Constant result{ValueType::Double};
+        result.doubleValue = value;
+        return result;
+    }
+
+    Constant literalValue(AST::ExprAST* expr) {
+        if (auto number = AST::dyn_cast<AST::NumberExprAST>(expr)) {
+            return number->isFloatingPoint() ? floating(number->getDoubleValue()) : integer(number->getIntValue());
+        }
+        if (auto string = AST::dyn_cast<AST::StringExprAST>(expr)) {
+            Constant result{ValueType::String};
+            result.stringValue = string->getValue();
+            return result;
+        }
+        return {};
+    }
+
+    // && and || only look at the right side when the left does not decide
+    Constant logical(BinaryOp op, const Constant& L, const Constant& R) {
+        if (!L.isNumber()) {
+            return {};
+        }
+        if (L.truth() == (op == BinaryOp::Or)) {
+            return truthValue(L.truth());
+        }
+        return R.isNumber() ? truthValue(R.truth()) : Constant{};
+    }
+
+    template <typename T>
+    Constant compare(BinaryOp op, const T& L, const T& R) {
+        switch (op) {
+            case BinaryOp::Less: return truthValue(L < R);
+            case BinaryOp::LessEqual: return truthValue(L <= R);
+            case BinaryOp::Greater: return truthValue(L > R);
+            case BinaryOp::GreaterEqual: return truthValue(L >= R);
+            case BinaryOp::Equal: return truthValue(L == R);
+            case BinaryOp::NotEqual: return truthValue(L != R);
+            default: return {};
+        }
+    }
+
+    // A constant as text, numbers formatted as the runtime's
+    // brainrot_string_from_int and brainrot_string_from_double do
+    std::string text(const Constant& value) {
+        if (value.type == ValueType::String) {
+            return std::string(value.stringValue);
+        }
+        if (value.type == ValueType::Double) {
+            char digits[320];
+            char* last = std::to_chars(digits, digits + sizeof digits, value.doubleValue,
+                                       std::chars_format::fixed, 6).ptr;
+            return std::string(digits, last);
+        }
+        return std::to_string(value.intValue);
+    }
+
+    // The value of L op R for the other operators, following visitBinary in
+    // codegen.cpp: integers wrap, / divides as doubles and a double operand
+    // makes the whole operation floating point. + with a string appends the
+    // other side as text, and two strings compare by their bytes.
+    Constant arithmetic(BinaryOp op, const Constant& L, const Constant& R, Arena& arena) {
+        if (!L.known() || !R.known()) {
+            return {};
+        }
+        if (L.type == ValueType::String || R.type == ValueType::String) {
+            if (op == BinaryOp::Add) {
+                Constant result{ValueType::String};
+                result.stringValue = arena.copyString(text(L) + text(R));
+                return result;
+            }
+            if (L.type != R.type) {
+                return {};
+            }
+            return compare(op, L.stringValue, R.stringValue);
+        }
+
+        if (L.type == ValueType::Double || R.type == ValueType::Double || op == BinaryOp::Div) {
+            double l = L.asDouble(), r = R.asDouble();
+            switch (op) {
+                case BinaryOp::Add: return floating(l + r);
+                case BinaryOp::Sub: return floating(l - r);
+                case BinaryOp::Mul: return floating(l * r);
+                case BinaryOp::Div: return floating(l / r);
+                case BinaryOp::Mod: return floating(std::fmod(l, r));
+                default: return compare(op, l, r);
+            }
+        }
+
+        uint64_t l = static_cast<uint64_t>(L.intValue), r = static_cast<uint64_t>(R.intValue);
+        switch (op) {
+            case BinaryOp::Add: return integer(static_cast<int64_t>(l + r));
+            case BinaryOp::Sub: return integer(static_cast<int64_t>(l - r));
+            case BinaryOp::Mul: return integer(static_cast<int64_t>(l * r));
+            case BinaryOp::Mod:
+                // srem traps or is undefined for these; leave them to run
+                if (R.intValue == 0 || (L.intValue == INT64_MIN && R.intValue == -1)) {
+                    return {};
+                }
+                return integer(L.intValue % R.intValue);
+            default: return compare(op, L.intValue, R.intValue);
+        }
+    }
+
+    Constant binary(BinaryOp op, const Constant& L, const Constant& R, Arena& arena) {
+        if (op == BinaryOp::And || op == BinaryOp::Or) {
+            return logical(op, L, R);
+        }
+        return arithmetic(op, L, R, arena);
+    }
+
+    Constant unary(AST::UnaryOp op, const Constant& operand) {
+        if (!operand.isNumber()) {
+            return {};
+        }
+        if (op == AST::UnaryOp::Not) {
+            return truthValue(!operand.truth());
+        }
+        switch (operand.type) {
+            case ValueType::Double: return floating(-operand.doubleValue);
+            case ValueType::Bool: return operand;  // Negating an i1 leaves it as it is
+            default: return integer(static_cast<int64_t>(0 - static_cast<uint64_t>(operand.intValue)));
+        }
+    }
+
+    // Whether dropping these statements could break the rest of the
+    // function. A variable is visible from its declaration to the end of
+    // the function, even when the declaration never runs, so a dead branch
+    // that declares one stays. Nested functions and classes stay so that
+    // CodeGen still reports them.
+    bool declares(AST::StmtAST* stmt);
+
+    bool declares(const AST::StmtList& body) {
+        for (AST::StmtAST* stmt : body) {
+            if (declares(stmt)) return true;
+        }
+        return false;
+    }
+
+    bool declares(AST::StmtAST* stmt) {
+        if (!stmt) {
+            return false;
+        }
+        switch (stmt->getKind()) {
+            case AST::StmtKind::VarDecl:
+            case AST::StmtKind::Bruh:
+            case AST::StmtKind::Sigma:
+            case AST::StmtKind::Cook:
+                return true;
+            case AST::StmtKind::Sus: {
+                auto sus = AST::cast<AST::SusStmtAST>(stmt);
+                return declares(sus->getThenBlock()) || declares(sus->getElseBlock());
+            }
+            case AST::StmtKind::Bet: {
+                auto bet = AST::cast<AST::BetStmtAST>(stmt);
+                return declares(bet->getInit()) || declares(bet->getBody()) || declares(bet->getIncrement());
+            }
+            default:
+                return false;
+        }
+    }
+
+    // An expression after folding: the value, if known, is only turned into
+    // a literal where something that is not constant needs it as a node
+    struct Folded {
+        AST::ExprAST* node;
+        Constant value;
+    };
+
+    // Rebuilds the tree bottom up. Statements are appended to the list being
+    // built, so a pruned sus can put the statements of its branch in its
+    // place.
+    class Folder : public AST::Visitor<Folder, Folded, void> {
+    public:
+        Folder(Arena& arena, FoldStats& stats) : arena(arena), builder(arena), stats(stats) {}
+
+        AST::ProgramAST* run(AST::ProgramAST* program) {
+            AST::StmtList declarations = foldBody(program->getDeclarations());
+            AST::CookAST* cook = nullptr;
+            for (AST::StmtAST* declaration : declarations) {
+                if (auto found = AST::dyn_cast<AST::CookAST>(declaration)) cook = found;
+            }
+            if (declarations.begin() == program->getDeclarations().begin()) {
+                return program;
+            }
+            return builder.program(declarations, cook);
+        }
+
+        Folded visitNumber(AST::NumberExprAST* expr) { return {expr, literalValue(expr)}; }
+        Folded visitString(AST::StringExprAST* expr) { return {expr, literalValue(expr)}; }
+        Folded visitVariable(AST::VariableExprAST* expr) { return {expr, {}}; }
+
+        Folded visitBinary(AST::BinaryExprAST* expr) {
+            Folded L = visit(expr->getLHS());
+            Folded R = visit(expr->getRHS());
+            Constant value = binary(expr->getOp(), L.value, R.value, arena);
+            if (value.known()) {
+                return constant(expr, value);
+            }
+            AST::ExprAST* lhs = materialize(L);
+            AST::ExprAST* rhs = materialize(R);
+            if (lhs == expr->getLHS() && rhs == expr->getRHS()) {
+                return {expr, {}};
+            }
+            return {builder.binary(expr->getOp(), lhs, rhs), {}};
+        }
+
+        Folded visitUnary(AST::UnaryExprAST* expr) {
+            Folded operand = visit(expr->getOperand());
+            Constant value = unary(expr->getOp(), operand.value);
+            if (value.known()) {
+                return constant(expr, value);
+            }
+            AST::ExprAST* node = materialize(operand);
+            return {node == expr->getOperand() ? expr : builder.unary(expr->getOp(), node), {}};
+        }
+
+        Folded visitGrouping(AST::GroupingExprAST* expr) {
+            Folded inner = visit(expr->getExpression());
+            if (inner.value.known()) {
+                return constant(expr, inner.value);
+            }
+            return {inner.node == expr->getExpression() ? expr : builder.grouping(inner.node), {}};
+        }
+
+        Folded visitCall(AST::CallExprAST* expr) {
+            AST::ExprList args = foldArgs(expr->getArgs());
+            return {args.begin() == expr->getArgs().begin() ? expr : builder.call(expr->getCallee(), args), {}};
+        }
+
+        Folded visitAssign(AST::AssignExprAST* expr) {
+            AST::ExprAST* value = fold(expr->getValue());
+            return {value == expr->getValue() ? expr : builder.assign(expr->getName(), value), {}};
+        }
+
+        Folded visitSquad(AST::SquadExprAST* expr) {
+            AST::ExprList elements = foldArgs(expr->getElements());
+            return {elements.begin() == expr->getElements().begin() ? expr : builder.squad(elements), {}};
+        }
+
+        Folded visitIndex(AST::IndexExprAST* expr) {
+            AST::ExprAST* index = fold(expr->getIndex());
+            return {index == expr->getIndex() ? expr : builder.index(expr->getName(), index), {}};
+        }
+
+        Folded visitIndexAssign(AST::IndexAssignExprAST* expr) {
+            AST::ExprAST* index = fold(expr->getIndex());
+            AST::ExprAST* value = fold(expr->getValue());
+            if (index == expr->getIndex() && value == expr->getValue()) {
+                return {expr, {}};
+            }
+            return {builder.indexAssign(expr->getName(), index, value), {}};
+        }
+
+        Folded visitLength(AST::LengthExprAST* expr) { return {expr, {}}; }
+
+        void visitYap(AST::YapStmtAST* stmt) {
+            AST::ExprList args = foldArgs(stmt->getArgs());
+            output->push_back(args.begin() == stmt->getArgs().begin() ? stmt : builder.yap(args));
+        }
+
+        void visitSus(AST::SusStmtAST* stmt) {
+            Folded condition = visit(stmt->getCondition());
+            if (condition.value.isNumber()) {
+                bool taken = condition.value.truth();
+                if (!declares(taken ? stmt->getElseBlock() : stmt->getThenBlock())) {
+                    ++stats.branches;
+                    for (AST::StmtAST* kept : taken ? stmt->getThenBlock() : stmt->getElseBlock()) {
+                        visit(kept);
+                    }
+                    return;
+                }
+            }
+            AST::ExprAST* cond = materialize(condition);
+            AST::StmtList thenBlock = foldBody(stmt->getThenBlock());
+            AST::StmtList elseBlock = foldBody(stmt->getElseBlock());
+            if (cond == stmt->getCondition() && thenBlock.begin() == stmt->getThenBlock().begin() &&
+                elseBlock.begin() == stmt->getElseBlock().begin()) {
+                output->push_back(stmt);
+            } else {
+                output->push_back(builder.sus(cond, thenBlock, elseBlock));
+            }
+        }
+
+        // The condition is tested before the first iteration with the
+        // counter holding its initial value, so a constant initializer is
+        // substituted into it: bet (pookie i = 0, i < 0, ...) never runs
+        void visitBet(AST::BetStmtAST* stmt) {
+            AST::StmtAST* init = foldSingle(stmt->getInit());
+            Folded condition = stmt->getCondition() ? visit(stmt->getCondition()) : Folded{nullptr, truthValue(true)};
+            Constant entry = condition.value;
+            if (!entry.known() && condition.node) {
+                auto [name, initial] = initialValue(init);
+                if (initial.known()) entry = evaluate(condition.node, name, initial);
+            }
+            if (entry.isNumber() && !entry.truth() && !declares(stmt->getBody()) &&
+                !declares(stmt->getIncrement())) {
+                ++stats.loops;
+                if (init) output->push_back(init);
+                return;
+            }
+
+            AST::ExprAST* cond = condition.node ? materialize(condition) : nullptr;
+            AST::StmtAST* increment = foldSingle(stmt->getIncrement());
+            AST::StmtList body = foldBody(stmt->getBody());
+            if (init == stmt->getInit() && cond == stmt->getCondition() && increment == stmt->getIncrement() &&
+                body.begin() == stmt->getBody().begin()) {
+                output->push_back(stmt);
+            } else {
+                output->push_back(builder.bet(init, cond, increment, body, stmt->isParallel()));
+            }
+        }
+
+        void visitBruh(AST::BruhAST* bruh) {
+            AST::StmtList body = foldBody(bruh->getBody());
+            output->push_back(body.begin() == bruh->getBody().begin()
+                                  ? bruh
+                                  : builder.bruh(bruh->getName(), bruh->getParams(), body));
+        }
+
+        // Classes are not compiled yet, so their members are left as written
+        void visitSigma(AST::SigmaAST* sigma) { output->push_back(sigma); }
+
+        void visitCook(AST::CookAST* cook) {
+            AST::StmtList body = foldBody(cook->getBody());
+            output->push_back(body.begin() == cook->getBody().begin() ? cook : builder.cook(body));
+        }
+
+        void visitExprStmt(AST::ExprStmtAST* stmt) {
+            AST::ExprAST* expr = fold(stmt->getExpr());
+            output->push_back(expr == stmt->getExpr() ? stmt : builder.exprStmt(expr));
+        }
+
+        void visitVarDecl(AST::VarDeclStmtAST* stmt) {
+            AST::ExprAST* init = fold(stmt->getInitializer());
+            output->push_back(init == stmt->getInitializer() ? stmt : builder.varDecl(stmt->getName(), init));
+        }
+
+        void visitSolulu(AST::SoluluStmtAST* stmt) {
+            AST::ExprAST* value = stmt->getValue() ? fold(stmt->getValue()) : nullptr;
+            output->push_back(value == stmt->getValue() ? stmt : builder.solulu(value));
+        }
+
+        void visitYoink(AST::YoinkStmtAST* stmt) {
+            AST::ExprAST* index = fold(stmt->getIndex());
+            AST::ExprAST* value = fold(stmt->getValue());
+            output->push_back(index == stmt->getIndex() && value == stmt->getValue()
+                                  ? stmt
+                                  : builder.yoink(stmt->getName(), index, value));
+        }
+
+        void visitYeet(AST::YeetStmtAST* stmt) {
+            AST::ExprAST* index = fold(stmt->getIndex());
+            output->push_back(index == stmt->getIndex() ? stmt : builder.yeet(stmt->getName(), index));
+        }
+
+    private:
+        Arena& arena;
+        AST::TreeBuilder builder;
+        FoldStats& stats;
+        std::vector<AST::StmtAST*>* output = nullptr;
+
+        Folded constant(AST::ExprAST* expr, const Constant& value) {
+            ++stats.nodes;
+            return {expr, value};
+        }
+
+        AST::ExprAST* materialize(const Folded& folded) {
+            const Constant& value = folded.value;
+            if (!value.known() || AST::isa<AST::NumberExprAST>(folded.node) ||
+                AST::isa<AST::StringExprAST>(folded.node)) {
+                return folded.node;
+            }
+            switch (value.type) {
+                case ValueType::Double: return builder.floatLiteral(value.doubleValue);
+                case ValueType::String: return builder.string(value.stringValue);
+                default: return builder.intLiteral(value.intValue);
+            }
+        }
+
+        AST::ExprAST* fold(AST::ExprAST* expr) {
+            return materialize(visit(expr));
+        }
+
+        // The list itself is only copied when one of its items changed
+        AST::ExprList foldArgs(const AST::ExprList& args) {
+            std::vector<AST::ExprAST*> folded;
+            folded.reserve(args.size());
+            bool changed = false;
+            for (AST::ExprAST* arg : args) {
+                folded.push_back(fold(arg));
+                changed |= folded.back() != arg;
+            }
+            return changed ? builder.exprList(folded.data(), folded.size()) : args;
+        }
+
+        AST::StmtList foldBody(const AST::StmtList& body) {
+            std::vector<AST::StmtAST*> folded;
+            folded.reserve(body.size());
+            std::vector<AST::StmtAST*>* outer = output;
+            output = &folded;
+            for (AST::StmtAST* stmt : body) {
+                visit(stmt);
+            }
+            output = outer;
+
+            bool changed = folded.size() != body.size();
+            for (size_t i = 0; !changed && i < folded.size(); ++i) {
+                changed = folded[i] != body[i];
+            }
+            return changed ? builder.stmtList(folded.data(), folded.size()) : body;
+        }
+
+        // Loop initializers and increments are declarations or expression
+        // statements, which always fold to exactly one statement
+        AST::StmtAST* foldSingle(AST::StmtAST* stmt) {
+            if (!stmt) {
+                return nullptr;
+            }
+            std::vector<AST::StmtAST*> folded;
+            std::vector<AST::StmtAST*>* outer = output;
+            output = &folded;
+            visit(stmt);
+            output = outer;
+            return folded.front();
+        }
+
+        // The variable a loop initializer sets to a constant, if it does
+        static std::pair<std::string_view, Constant> initialValue(AST::StmtAST* init) {
+            if (auto decl = AST::dyn_cast<AST::VarDeclStmtAST>(init)) {
+                return {decl->getName(), literalValue(decl->getInitializer())};
+            }
+            if (auto stmt = AST::dyn_cast<AST::ExprStmtAST>(init)) {
+                if (auto assign = AST::dyn_cast<AST::AssignExprAST>(stmt->getExpr())) {
+                    return {assign->getName(), literalValue(assign->getValue())};
+                }
+            }
+            return {};
+        }
+
+        // The value of an already folded expression when name holds value
+        Constant evaluate(AST::ExprAST* expr, std::string_view name, const Constant& value) {
+            switch (expr->getKind()) {
+                case AST::ExprKind::Number:
+                case AST::ExprKind::String:
+                    return literalValue(expr);
+                case AST::ExprKind::Variable:
+                    return AST::cast<AST::VariableExprAST>(expr)->getName() == name ? value : Constant{};
+                case AST::ExprKind::Grouping:
+                    return evaluate(AST::cast<AST::GroupingExprAST>(expr)->getExpression(), name, value);
+                case AST::ExprKind::Unary: {
+                    auto unaryExpr = AST::cast<AST::UnaryExprAST>(expr);
+                    return unary(unaryExpr->getOp(), evaluate(unaryExpr->getOperand(), name, value));
+                }
+                case AST::ExprKind::Binary: {
+                    auto binaryExpr = AST::cast<AST::BinaryExprAST>(expr);
+                    Constant L = evaluate(binaryExpr->getLHS(), name, value);
+                    if (!L.known()) {
+                        return {};
+                    }
+                    return binary(binaryExpr->getOp(), L, evaluate(binaryExpr->getRHS(), name, value), arena);
+                }
+                default:
+                    return {};
+            }
+        }
+    };
+}
+
+AST::ProgramAST* foldConstants(AST::ProgramAST* program, Arena& arena, FoldStats& stats) {
+    return Folder(arena, stats).run(program);
+}
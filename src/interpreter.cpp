@@ -0,0 +1,887 @@
+#include "interpreter.h"
+#include "brainrot_rt.h"
+#include "parallel_loop.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+// Checks a program the way CodeGen::generateCode would, in the same order
+// so the first error is the same one, and lays out the variable slots of
+// each function and the calls made from each loop
+class Interpreter::Resolver : public AST::Visitor<Interpreter::Resolver> {
+public:
+    explicit Resolver(Interpreter& interpreter) : interpreter(interpreter) {}
+
+    void resolveFunction(uint32_t index) {
+        functionNumber = index;
+        function = &interpreter.functions[index];
+        for (std::string_view param : function->bruh->getParams()) {
+            function->paramSlots.push_back(declare(param));
+        }
+        visitBody(*function->body);
+        finish();
+    }
+
+    // Top-level declarations other than functions run as part of main
+    void resolveMain(AST::StmtAST* declaration) {
+        functionNumber = static_cast<uint32_t>(interpreter.functions.size() - 1);
+        function = &interpreter.functions.back();
+        visit(declaration);
+        finish();
+    }
+
+    void visitNumber(AST::NumberExprAST*) {}
+    void visitString(AST::StringExprAST* expr) {
+        auto [it, inserted] = strings.try_emplace(expr->getValue());
+        if (inserted) {
+            it->second = brainrot_string_constant(expr->getValue().data(),
+                                                  static_cast<int64_t>(expr->getValue().size()));
+        }
+        interpreter.literals.emplace(expr, it->second);
+    }
+    void visitVariable(AST::VariableExprAST* expr) {
+        if (!function->slots.count(expr->getName())) {
+            throw std::runtime_error("Unknown variable name: " + std::string(expr->getName()));
+        }
+    }
+    void visitBinary(AST::BinaryExprAST* expr) { visit(expr->getLHS()); visit(expr->getRHS()); }
+    void visitUnary(AST::UnaryExprAST* expr) { visit(expr->getOperand()); }
+    void visitGrouping(AST::GroupingExprAST* expr) { visit(expr->getExpression()); }
+    void visitAssign(AST::AssignExprAST* expr) {
+        visit(expr->getValue());
+        if (!function->slots.count(expr->getName())) {
+            throw std::runtime_error("Undefined variable: " + std::string(expr->getName()));
+        }
+    }
+    void visitSquad(AST::SquadExprAST* expr) {
+        for (AST::ExprAST* element : expr->getElements()) visit(element);
+    }
+    void visitIndex(AST::IndexExprAST* expr) {
+        visit(expr->getIndex());
+        checkSquad(expr->getName());
+    }
+    void visitIndexAssign(AST::IndexAssignExprAST* expr) {
+        visit(expr->getIndex());
+        visit(expr->getValue());
+        checkSquad(expr->getName());
+    }
+    void visitLength(AST::LengthExprAST* expr) {
+        checkVariable(expr->getName());
+        ValueType type = function->types->variable(expr->getName());
+        if (type != ValueType::String && !isSquad(type)) {
+            throw std::runtime_error("'" + std::string(expr->getName()) + "' is not a squad or a string");
+        }
+    }
+    void visitCall(AST::CallExprAST* expr) {
+        if (expr->getCallee() == "yap") {
+            for (AST::ExprAST* arg : expr->getArgs()) visit(arg);
+            return;
+        }
+        if (expr->getCallee() == "squad") {
+            if (expr->getArgs().size() != 1) {
+                throw std::runtime_error("squad expects 1 argument, got " + std::to_string(expr->getArgs().size()));
+            }
+            visit(expr->getArgs()[0]);
+            return;
+        }
+        if (isMinMax(interpreter.types, expr->getCallee())) {
+            if (expr->getArgs().size() != 2) {
+                throw std::runtime_error(std::string(expr->getCallee()) + " expects 2 arguments, got " +
+                                         std::to_string(expr->getArgs().size()));
+            }
+            for (AST::ExprAST* arg : expr->getArgs()) visit(arg);
+            return;
+        }
+
+        auto it = interpreter.functionIndex.find(expr->getCallee());
+        if (it == interpreter.functionIndex.end()) {
+            throw std::runtime_error("Unknown function: " + std::string(expr->getCallee()));
+        }
+        size_t arity = interpreter.functions[it->second].bruh->getParams().size();
+        if (arity != expr->getArgs().size()) {
+            throw std::runtime_error("Function '" + std::string(expr->getCallee()) + "' expects " +
+                                     std::to_string(arity) + " arguments, got " +
+                                     std::to_string(expr->getArgs().size()));
+        }
+        for (AST::ExprAST* arg : expr->getArgs()) {
+            visit(arg);
+        }
+
+        function->callees.push_back(it->second);
+        for (LoopInfo* loop : openLoops) {
+            loop->callees.push_back(it->second);
+        }
+    }
+
+    void visitYap(AST::YapStmtAST* stmt) {
+        for (AST::ExprAST* arg : stmt->getArgs()) visit(arg);
+    }
+    void visitSus(AST::SusStmtAST* stmt) {
+        visit(stmt->getCondition());
+        visitBody(stmt->getThenBlock());
+        visitBody(stmt->getElseBlock());
+    }
+    // A goated bet runs one iteration after another, which is one of the
+    // orders its iterations may run in
+    void visitBet(AST::BetStmtAST* stmt) {
+        if (stmt->getInit()) visit(stmt->getInit());
+        if (stmt->isParallel()) {
+            analyzeParallelLoop(stmt, interpreter.types, *function->types);
+        }
+
+        LoopInfo& loop = interpreter.loops[stmt];
+        loop.owner = functionNumber;
+        openLoops.push_back(&loop);
+        if (stmt->getCondition()) visit(stmt->getCondition());
+        visitBody(stmt->getBody());
+        if (stmt->getIncrement()) visit(stmt->getIncrement());
+        openLoops.pop_back();
+    }
+    void visitBruh(AST::BruhAST* bruh) {
+        throw std::runtime_error("Function '" + std::string(bruh->getName()) +
+                                 "' must be declared at the top level");
+    }
+    void visitSigma(AST::SigmaAST*) {}
+    void visitCook(AST::CookAST* cook) { visitBody(cook->getBody()); }
+    void visitExprStmt(AST::ExprStmtAST* stmt) { visit(stmt->getExpr()); }
+    void visitVarDecl(AST::VarDeclStmtAST* stmt) {
+        visit(stmt->getInitializer());
+        declare(stmt->getName());
+    }
+    void visitSolulu(AST::SoluluStmtAST* stmt) {
+        if (!stmt->getValue()) return;
+        visit(stmt->getValue());
+        // Other strings in cook are caught when they are returned
+        if (!function->bruh && AST::isa<AST::StringExprAST>(stmt->getValue())) {
+            throw std::runtime_error("solulu can only return a number");
+        }
+    }
+    void visitYoink(AST::YoinkStmtAST* stmt) {
+        visit(stmt->getIndex());
+        visit(stmt->getValue());
+        checkSquad(stmt->getName());
+    }
+    void visitYeet(AST::YeetStmtAST* stmt) {
+        visit(stmt->getIndex());
+        checkSquad(stmt->getName());
+    }
+
+private:
+    Interpreter& interpreter;
+    uint32_t functionNumber = 0;
+    FunctionInfo* function = nullptr;
+    std::vector<LoopInfo*> openLoops;
+    std::unordered_map<std::string_view, uint64_t> strings;
+
+    void visitBody(const AST::StmtList& body) {
+        for (AST::StmtAST* stmt : body) visit(stmt);
+    }
+
+    // Redeclaring a name reuses its slot, as CodeGen's allocas behave the same
+    uint32_t declare(std::string_view name) {
+        auto [it, inserted] = function->slots.try_emplace(name, static_cast<uint32_t>(function->slotNames.size()));
+        if (inserted) {
+            function->slotNames.push_back(name);
+        }
+        return it->second;
+    }
+
+    void checkVariable(std::string_view name) {
+        if (!function->slots.count(name)) {
+            throw std::runtime_error("Unknown variable name: " + std::string(name));
+        }
+    }
+
+    // What CodeGen::loadSquad checks
+    void checkSquad(std::string_view name) {
+        checkVariable(name);
+        if (!isSquad(function->types->variable(name))) {
+            throw std::runtime_error("'" + std::string(name) + "' is not a squad");
+        }
+    }
+
+    void finish() {
+        std::sort(function->callees.begin(), function->callees.end());
+        function->callees.erase(std::unique(function->callees.begin(), function->callees.end()),
+                                function->callees.end());
+    }
+};
+
+Interpreter::Interpreter(AST::ProgramAST* program, const CodeGenOptions& options)
+    : options(options) {
+    // Compiles happen off the main thread, so they can afford the optimizer
+    // even at the default -O0. The object cache and lazy modes do not apply.
+    if (this->options.optLevel == 0) {
+        this->options.optLevel = 2;
+    }
+    this->options.cacheDir.clear();
+    this->options.lazy = false;
+    this->options.speculate = false;
+    this->options.timePasses = false;
+    this->options.remarksFile.clear();
+
+    // Every function is declared before any body is checked
+    for (AST::StmtAST* declaration : program->getDeclarations()) {
+        if (auto bruh = AST::dyn_cast<AST::BruhAST>(declaration)) {
+            auto index = static_cast<uint32_t>(functions.size());
+            if (!functionIndex.emplace(bruh->getName(), index).second) {
+                throw std::runtime_error("Function already defined: " + std::string(bruh->getName()));
+            }
+            functions.emplace_back();
+            functions.back().bruh = bruh;
+            functions.back().body = &bruh->getBody();
+        }
+    }
+    functions.emplace_back();
+    functions.back().body = &program->getDeclarations();
+
+    types = inferTypes(program);
+    for (FunctionInfo& function : functions) {
+        function.types = function.bruh ? &types.functions.find(function.bruh->getName())->second : &types.main;
+    }
+
+    Resolver resolver(*this);
+    for (AST::StmtAST* declaration : program->getDeclarations()) {
+        if (auto bruh = AST::dyn_cast<AST::BruhAST>(declaration)) {
+            resolver.resolveFunction(functionIndex.find(bruh->getName())->second);
+        } else {
+            resolver.resolveMain(declaration);
+        }
+    }
+    for (auto& [stmt, loop] : loops) {
+        std::sort(loop.callees.begin(), loop.callees.end());
+        loop.callees.erase(std::unique(loop.callees.begin(), loop.callees.end()), loop.callees.end());
+    }
+    for (FunctionInfo& function : functions) {
+        for (std::string_view name : function.slotNames) {
+            function.slotTypes.push_back(function.types->variable(name));
+        }
+    }
+}
+
+Interpreter::~Interpreter() {
+    // A compile in progress finishes first; queued ones are dropped
+    {
+        std::lock_guard<std::mutex> lock(compileMutex);
+        stopCompiling = true;
+    }
+    jobReady.notify_one();
+    if (compileThread.joinable()) {
+        compileThread.join();
+    }
+}
+
+int Interpreter::run() {
+    FunctionInfo& main = functions.back();
+    std::vector<CodeGen::TierCell> slots(main.slotNames.size() + 1);
+    current = &main;
+    frame = slots.data();
+
+    // The banner goes through stdio, the program's output through the runtime
+    std::printf("Executing main function...\n");
+    std::fflush(stdout);
+    Completion completion = runBody(*main.body);
+    int result = 0;
+    if (completion == Completion::Return) {
+        if (returnValue.type == RuntimeValue::Type::String || returnValue.type == RuntimeValue::Type::Squad) {
+            throw std::runtime_error("solulu can only return a number");
+        }
+        RuntimeValue value = fromCell(toCell(returnValue, main.types->result), main.types->result);
+        result = value.type == RuntimeValue::Type::Double ? static_cast<int32_t>(value.doubleValue)
+                                                          : static_cast<int32_t>(toCell(value, ValueType::Int));
+    }
+    brainrot_flush();
+    std::printf("Program finished with code: %d\n", result);
+    std::fflush(stdout);
+    return result;
+}
+
+// The compile thread starts with the first hot function or loop, so short
+// scripts never load LLVM at all
+void Interpreter::queueJob(Job job) {
+    std::lock_guard<std::mutex> lock(compileMutex);
+    if (!compileThread.joinable()) {
+        compileThread = std::thread([this] { compileJobs(); });
+    }
+    jobs.push_back(job);
+    jobReady.notify_one();
+}
+
+void Interpreter::waitForCompiles() {
+    std::unique_lock<std::mutex> lock(compileMutex);
+    jobDone.wait(lock, [this] { return jobs.empty() && !compiling; });
+}
+
+void Interpreter::compileJobs() {
+    std::unique_lock<std::mutex> lock(compileMutex);
+    for (;;) {
+        jobReady.wait(lock, [this] { return stopCompiling || !jobs.empty(); });
+        if (stopCompiling) {
+            return;
+        }
+        Job job = jobs.front();
+        jobs.pop_front();
+        compiling = true;
+        lock.unlock();
+
+        compileJob(job);
+
+        lock.lock();
+        compiling = false;
+        jobDone.notify_all();
+    }
+}
+
+// Publishes native entry points for the interpreter to pick up at its next
+// call or loop header
+void Interpreter::compileJob(const Job& job) {
+    try {
+        if (!compiler) {
+            compiler = std::make_unique<CodeGen>(options);
+        }
+
+        if (job.loop) {
+            LoopInfo& loop = loops.find(job.loop)->second;
+            std::vector<AST::BruhAST*> callees;
+            for (uint32_t index : reachableFunctions(loop.callees)) {
+                callees.push_back(functions[index].bruh);
+            }
+            FunctionInfo& owner = functions[loop.owner];
+            if (CodeGen::TierLoop native =
+                    compiler->compileLoop(types, *owner.types, callees, job.loop, owner.slotNames)) {
+                loop.native.store(native, std::memory_order_release);
+                ++loopsCompiled;
+            }
+            return;
+        }
+
+        // Callees are compiled along with the function, so native code
+        // never calls back into the interpreter
+        std::vector<uint32_t> indices = reachableFunctions({job.function});
+        std::vector<AST::BruhAST*> bruhs;
+        for (uint32_t index : indices) {
+            bruhs.push_back(functions[index].bruh);
+        }
+        std::vector<CodeGen::TierFunction> natives = compiler->compileFunctions(types, bruhs);
+        for (size_t i = 0; i < natives.size(); ++i) {
+            FunctionInfo& function = functions[indices[i]];
+            if (!function.native.load(std::memory_order_relaxed)) {
+                function.native.store(natives[i], std::memory_order_release);
+                ++functionsCompiled;
+            }
+        }
+    } catch (const std::exception&) {
+        // Whatever failed to compile keeps running in the interpreter
+    }
+}
+
+std::vector<uint32_t> Interpreter::reachableFunctions(const std::vector<uint32_t>& roots) const {
+    std::vector<bool> seen(functions.size());
+    std::vector<uint32_t> pending(roots);
+    std::vector<uint32_t> result;
+    while (!pending.empty()) {
+        uint32_t index = pending.back();
+        pending.pop_back();
+        if (seen[index]) continue;
+        seen[index] = true;
+        result.push_back(index);
+        for (uint32_t callee : functions[index].callees) {
+            pending.push_back(callee);
+        }
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+Completion Interpreter::runBody(const AST::StmtList& body) {
+    for (AST::StmtAST* stmt : body) {
+        if (visit(stmt) == Completion::Return) {
+            return Completion::Return;
+        }
+    }
+    return Completion::Normal;
+}
+
+RuntimeValue Interpreter::callFunction(uint32_t index, AST::CallExprAST* call) {
+    FunctionInfo& callee = functions[index];
+    std::vector<CodeGen::TierCell> args;
+    args.reserve(call->getArgs().size());
+    for (AST::ExprAST* arg : call->getArgs()) {
+        args.push_back(toCell(visit(arg), callee.types->params[args.size()]));
+    }
+
+    CodeGen::TierFunction native = callee.native.load(std::memory_order_acquire);
+    if (!native) {
+        if (++callee.calls >= hotCalls && !callee.queued) {
+            callee.queued = true;
+            queueJob({index, nullptr});
+        }
+        if (depth >= maxInterpretedDepth) {
+            if (!callee.queued) {
+                callee.queued = true;
+                queueJob({index, nullptr});
+            }
+            waitForCompiles();
+            native = callee.native.load(std::memory_order_acquire);
+            if (!native) {
+                throw std::runtime_error("Calls nested too deeply in '" +
+                                         std::string(callee.bruh->getName()) + "'");
+            }
+        }
+    }
+    ValueType result = callee.types->result;
+    if (native) {
+        return fromCell(native(args.data()), result);
+    }
+
+    std::vector<CodeGen::TierCell> slots(callee.slotNames.size() + 1);
+    for (size_t i = 0; i < args.size(); ++i) {
+        slots[callee.paramSlots[i]] = args[i];
+    }
+    FunctionInfo* caller = current;
+    CodeGen::TierCell* callerFrame = frame;
+    current = &callee;
+    frame = slots.data();
+    ++depth;
+    Completion completion = runBody(*callee.body);
+    --depth;
+    current = caller;
+    frame = callerFrame;
+
+    // Falling off the end returns 0, the empty string or an empty squad
+    return fromCell(toCell(completion == Completion::Return ? returnValue : defaultValue(result), result), result);
+}
+
+RuntimeValue Interpreter::defaultValue(ValueType type) {
+    if (type == ValueType::String) {
+        return RuntimeValue::ofString(0);  // The empty string
+    }
+    return isSquad(type) ? RuntimeValue::ofSquad(newSquad(0)) : RuntimeValue::ofInt(0);
+}
+
+// The word of a string, or of a number as yap prints it
+uint64_t Interpreter::toStringWord(const RuntimeValue& value) {
+    switch (value.type) {
+        case RuntimeValue::Type::String: return value.stringValue;
+        case RuntimeValue::Type::Int: return brainrot_string_from_int(value.intValue);
+        case RuntimeValue::Type::Double: return brainrot_string_from_double(value.doubleValue);
+        case RuntimeValue::Type::Bool: return brainrot_string_from_int(value.boolValue);
+        case RuntimeValue::Type::Squad: break;
+    }
+    throw std::runtime_error("Expected a number, got a squad");
+}
+
+// As CodeGen::generateStringBinary: + appends, and two strings compare
+RuntimeValue Interpreter::stringBinary(AST::BinaryOp op, const RuntimeValue& L, const RuntimeValue& R) {
+    using AST::BinaryOp;
+    if (op == BinaryOp::Add) {
+        uint64_t left = toStringWord(L);
+        uint64_t right = toStringWord(R);
+        return RuntimeValue::ofString(brainrot_string_concat(left, right));
+    }
+    if (L.type != R.type || op == BinaryOp::Sub || op == BinaryOp::Mul || op == BinaryOp::Div ||
+        op == BinaryOp::Mod) {
+        throw std::runtime_error("Expected a number, got a string");
+    }
+    if (op == BinaryOp::Equal || op == BinaryOp::NotEqual) {
+        bool equal = brainrot_string_equal(L.stringValue, R.stringValue) != 0;
+        return RuntimeValue::ofBool(op == BinaryOp::Equal ? equal : !equal);
+    }
+    int64_t order = brainrot_string_compare(L.stringValue, R.stringValue);
+    switch (op) {
+        case BinaryOp::Less: return RuntimeValue::ofBool(order < 0);
+        case BinaryOp::LessEqual: return RuntimeValue::ofBool(order <= 0);
+        case BinaryOp::Greater: return RuntimeValue::ofBool(order > 0);
+        default: return RuntimeValue::ofBool(order >= 0);
+    }
+}
+
+void Interpreter::requireNumber(const RuntimeValue& value) {
+    if (value.type == RuntimeValue::Type::String) {
+        throw std::runtime_error("Expected a number, got a string");
+    }
+    if (value.type == RuntimeValue::Type::Squad) {
+        throw std::runtime_error("Expected a number, got a squad");
+    }
+}
+
+double Interpreter::toDouble(const RuntimeValue& value) {
+    requireNumber(value);
+    switch (value.type) {
+        case RuntimeValue::Type::Int: return static_cast<double>(value.intValue);
+        case RuntimeValue::Type::Bool: return value.boolValue ? 1.0 : 0.0;
+        default: return value.doubleValue;
+    }
+}
+
+// Numbers are true when non-zero; NaN is false, as with CodeGen's fcmp one
+bool Interpreter::toBool(const RuntimeValue& value) {
+    requireNumber(value);
+    switch (value.type) {
+        case RuntimeValue::Type::Int: return value.intValue != 0;
+        case RuntimeValue::Type::Bool: return value.boolValue;
+        default: return value.doubleValue < 0.0 || value.doubleValue > 0.0;
+    }
+}
+
+// Squad indices are integers; doubles are truncated
+int64_t Interpreter::toIndex(const RuntimeValue& value) {
+    return static_cast<int64_t>(toCell(value, ValueType::Int));
+}
+
+// Stores a value in a slot of the given type. Slot types hold every value
+// stored in them (see types.h), so this only widens.
+CodeGen::TierCell Interpreter::toCell(const RuntimeValue& value, ValueType type) {
+    if (type == ValueType::String) {
+        if (value.type != RuntimeValue::Type::String) {
+            throw std::runtime_error(value.type == RuntimeValue::Type::Squad ? "Expected a string, got a squad"
+                                                                              : "Expected a string, got a number");
+        }
+        return value.stringValue;
+    }
+    if (isSquad(type)) {
+        if (value.type != RuntimeValue::Type::Squad) {
+            throw std::runtime_error(value.type == RuntimeValue::Type::String ? "Expected a squad, got a string"
+                                                                               : "Expected a squad, got a number");
+        }
+        return reinterpret_cast<CodeGen::TierCell>(value.squadValue);
+    }
+    requireNumber(value);
+    if (type == ValueType::Double) {
+        double number = toDouble(value);
+        CodeGen::TierCell cell;
+        std::memcpy(&cell, &number, sizeof cell);
+        return cell;
+    }
+    if (type == ValueType::Bool) {
+        return toBool(value) ? 1 : 0;
+    }
+    switch (value.type) {
+        case RuntimeValue::Type::Int: return static_cast<CodeGen::TierCell>(value.intValue);
+        case RuntimeValue::Type::Double: return static_cast<CodeGen::TierCell>(static_cast<int64_t>(value.doubleValue));
+        default: return value.boolValue ? 1 : 0;
+    }
+}
+
+RuntimeValue Interpreter::fromCell(CodeGen::TierCell cell, ValueType type) {
+    switch (type) {
+        case ValueType::Double: {
+            double number;
+            std::memcpy(&number, &cell, sizeof number);
+            return RuntimeValue::ofDouble(number);
+        }
+        case ValueType::Bool: return RuntimeValue::ofBool(cell != 0);
+        case ValueType::String: return RuntimeValue::ofString(cell);
+        case ValueType::Squad:
+        case ValueType::IntSquad:
+        case ValueType::DoubleSquad: return RuntimeValue::ofSquad(reinterpret_cast<Squad*>(cell));
+        default: return RuntimeValue::ofInt(static_cast<int64_t>(cell));
+    }
+}
+
+RuntimeValue Interpreter::visitNumber(AST::NumberExprAST* expr) {
+    if (expr->isFloatingPoint()) {
+        return RuntimeValue::ofDouble(expr->getDoubleValue());
+    }
+    return RuntimeValue::ofInt(expr->getIntValue());
+}
+
+RuntimeValue Interpreter::visitString(AST::StringExprAST* expr) {
+    return RuntimeValue::ofString(literals.find(expr)->second);
+}
+
+RuntimeValue Interpreter::visitVariable(AST::VariableExprAST* expr) {
+    uint32_t slot = current->slots.find(expr->getName())->second;
+    return fromCell(frame[slot], current->slotTypes[slot]);
+}
+
+// Same rules as CodeGen::visitBinary: integers stay integers unless either
+// side is a double, and / always divides as doubles. Integer arithmetic
+// wraps like LLVM's add/sub/mul.
+RuntimeValue Interpreter::visitBinary(AST::BinaryExprAST* expr) {
+    using AST::BinaryOp;
+    BinaryOp op = expr->getOp();
+    if (op == BinaryOp::And || op == BinaryOp::Or) {
+        bool lhs = toBool(visit(expr->getLHS()));
+        if (op == BinaryOp::And ? !lhs : lhs) {
+            return RuntimeValue::ofBool(lhs);
+        }
+        return RuntimeValue::ofBool(toBool(visit(expr->getRHS())));
+    }
+
+    RuntimeValue L = visit(expr->getLHS());
+    RuntimeValue R = visit(expr->getRHS());
+    if (L.type == RuntimeValue::Type::String || R.type == RuntimeValue::Type::String) {
+        return stringBinary(op, L, R);
+    }
+    requireNumber(L);
+    requireNumber(R);
+
+    if (L.type == RuntimeValue::Type::Double || R.type == RuntimeValue::Type::Double) {
+        double l = toDouble(L);
+        double r = toDouble(R);
+        switch (op) {
+            case BinaryOp::Add: return RuntimeValue::ofDouble(l + r);
+            case BinaryOp::Sub: return RuntimeValue::ofDouble(l - r);
+            case BinaryOp::Mul: return RuntimeValue::ofDouble(l * r);
+            case BinaryOp::Div: return RuntimeValue::ofDouble(l / r);
+            case BinaryOp::Mod: return RuntimeValue::ofDouble(std::fmod(l, r));
+            case BinaryOp::Less: return RuntimeValue::ofBool(l < r);
+            case BinaryOp::LessEqual: return RuntimeValue::ofBool(l <= r);
+            case BinaryOp::Greater: return RuntimeValue::ofBool(l > r);
+            case BinaryOp::GreaterEqual: return RuntimeValue::ofBool(l >= r);
+            case BinaryOp::Equal: return RuntimeValue::ofBool(l == r);
+            case BinaryOp::NotEqual: return RuntimeValue::ofBool(!(l == r));
+            default: break;
+        }
+    } else {
+        auto asInt = [](const RuntimeValue& value) {
+            return value.type == RuntimeValue::Type::Bool ? int64_t(value.boolValue) : value.intValue;
+        };
+        int64_t l = asInt(L);
+        int64_t r = asInt(R);
+        auto wrap = [](uint64_t value) { return RuntimeValue::ofInt(static_cast<int64_t>(value)); };
+        switch (op) {
+            case BinaryOp::Add: return wrap(uint64_t(l) + uint64_t(r));
+            case BinaryOp::Sub: return wrap(uint64_t(l) - uint64_t(r));
+            case BinaryOp::Mul: return wrap(uint64_t(l) * uint64_t(r));
+            case BinaryOp::Div: return RuntimeValue::ofDouble(double(l) / double(r));
+            case BinaryOp::Mod:
+                if (r == 0) {
+                    throw std::runtime_error("Division by zero");
+                }
+                return RuntimeValue::ofInt(r == -1 ? 0 : l % r);
+            case BinaryOp::Less: return RuntimeValue::ofBool(l < r);
+            case BinaryOp::LessEqual: return RuntimeValue::ofBool(l <= r);
+            case BinaryOp::Greater: return RuntimeValue::ofBool(l > r);
+            case BinaryOp::GreaterEqual: return RuntimeValue::ofBool(l >= r);
+            case BinaryOp::Equal: return RuntimeValue::ofBool(l == r);
+            case BinaryOp::NotEqual: return RuntimeValue::ofBool(l != r);
+            default: break;
+        }
+    }
+    throw std::runtime_error("Invalid binary operator");
+}
+
+RuntimeValue Interpreter::visitUnary(AST::UnaryExprAST* expr) {
+    RuntimeValue operand = visit(expr->getOperand());
+    requireNumber(operand);
+    switch (expr->getOp()) {
+        case AST::UnaryOp::Negate:
+            switch (operand.type) {
+                case RuntimeValue::Type::Double: return RuntimeValue::ofDouble(-operand.doubleValue);
+                case RuntimeValue::Type::Int:
+                    return RuntimeValue::ofInt(static_cast<int64_t>(0 - uint64_t(operand.intValue)));
+                default: return operand;  // i1 negation is the identity
+            }
+            break;
+        case AST::UnaryOp::Not:
+            return RuntimeValue::ofBool(!toBool(operand));
+    }
+    throw std::runtime_error("Invalid unary operator");
+}
+
+RuntimeValue Interpreter::visitCall(AST::CallExprAST* expr) {
+    if (expr->getCallee() == "yap") {
+        // Prints like CodeGen's yap call, then a newline, once every
+        // argument is evaluated
+        std::vector<RuntimeValue> values;
+        for (AST::ExprAST* arg : expr->getArgs()) {
+            values.push_back(visit(arg));
+        }
+        int64_t printed = 0;
+        for (const RuntimeValue& value : values) {
+            switch (value.type) {
+                case RuntimeValue::Type::Int: printed += brainrot_print_int(value.intValue); break;
+                case RuntimeValue::Type::Double: printed += brainrot_print_double(value.doubleValue); break;
+                case RuntimeValue::Type::Bool: printed += brainrot_print_int(value.boolValue); break;
+                case RuntimeValue::Type::String: printed += brainrot_print_str(value.stringValue); break;
+                case RuntimeValue::Type::Squad: throw std::runtime_error("yap cannot print a squad");
+            }
+        }
+        printed += brainrot_print_string("\n", 1);
+        return RuntimeValue::ofInt(printed);
+    }
+    if (expr->getCallee() == "squad") {
+        return RuntimeValue::ofSquad(newSquad(toIndex(visit(expr->getArgs()[0]))));
+    }
+    if (isMinMax(types, expr->getCallee())) {
+        RuntimeValue a = visit(expr->getArgs()[0]);
+        RuntimeValue b = visit(expr->getArgs()[1]);
+        requireNumber(a);
+        requireNumber(b);
+        bool isMin = expr->getCallee() == "min";
+        if (a.type == RuntimeValue::Type::Double || b.type == RuntimeValue::Type::Double) {
+            double l = toDouble(a);
+            double r = toDouble(b);
+            return RuntimeValue::ofDouble((isMin ? r < l : r > l) ? r : l);
+        }
+        int64_t l = a.type == RuntimeValue::Type::Bool ? int64_t(a.boolValue) : a.intValue;
+        int64_t r = b.type == RuntimeValue::Type::Bool ? int64_t(b.boolValue) : b.intValue;
+        return RuntimeValue::ofInt((isMin ? r < l : r > l) ? r : l);
+    }
+    return callFunction(functionIndex.find(expr->getCallee())->second, expr);
+}
+
+RuntimeValue Interpreter::visitGrouping(AST::GroupingExprAST* expr) {
+    return visit(expr->getExpression());
+}
+
+RuntimeValue Interpreter::visitAssign(AST::AssignExprAST* expr) {
+    RuntimeValue value = visit(expr->getValue());
+    uint32_t slot = current->slots.find(expr->getName())->second;
+    frame[slot] = toCell(value, current->slotTypes[slot]);
+    return fromCell(frame[slot], current->slotTypes[slot]);
+}
+
+Squad* Interpreter::squadIn(std::string_view name) const {
+    return reinterpret_cast<Squad*>(frame[current->slots.find(name)->second]);
+}
+
+// Elements are stored as cells of the squad's element type
+RuntimeValue Interpreter::visitSquad(AST::SquadExprAST* expr) {
+    std::vector<RuntimeValue> values;
+    for (AST::ExprAST* element : expr->getElements()) {
+        values.push_back(visit(element));
+    }
+    ValueType element = elementType(current->types->squad(expr));
+    Squad* squad = newSquad(static_cast<int64_t>(values.size()));
+    for (size_t i = 0; i < values.size(); ++i) {
+        squad->data[i] = toCell(values[i], element);
+    }
+    return RuntimeValue::ofSquad(squad);
+}
+
+RuntimeValue Interpreter::visitIndex(AST::IndexExprAST* expr) {
+    int64_t index = toIndex(visit(expr->getIndex()));
+    uint64_t& element = squadElement(squadIn(expr->getName()), index);
+    return fromCell(element, elementType(current->types->variable(expr->getName())));
+}
+
+RuntimeValue Interpreter::visitIndexAssign(AST::IndexAssignExprAST* expr) {
+    int64_t index = toIndex(visit(expr->getIndex()));
+    RuntimeValue value = visit(expr->getValue());
+    uint64_t& element = squadElement(squadIn(expr->getName()), index);
+    ValueType type = elementType(current->types->variable(expr->getName()));
+    element = toCell(value, type);
+    return fromCell(element, type);
+}
+
+RuntimeValue Interpreter::visitLength(AST::LengthExprAST* expr) {
+    uint64_t cell = frame[current->slots.find(expr->getName())->second];
+    if (current->types->variable(expr->getName()) == ValueType::String) {
+        return RuntimeValue::ofInt(brainrot_string_length(cell));
+    }
+    return RuntimeValue::ofInt(reinterpret_cast<Squad*>(cell)->length);
+}
+
+Completion Interpreter::visitYap(AST::YapStmtAST* stmt) {
+    // All arguments are evaluated first, as in CodeGen
+    std::vector<RuntimeValue> values;
+    for (AST::ExprAST* arg : stmt->getArgs()) {
+        values.push_back(visit(arg));
+        if (values.back().type == RuntimeValue::Type::Squad) {
+            throw std::runtime_error("yap cannot print a squad");
+        }
+    }
+    for (const RuntimeValue& value : values) {
+        switch (value.type) {
+            case RuntimeValue::Type::Int: brainrot_print_int(value.intValue); break;
+            case RuntimeValue::Type::Double: brainrot_print_double(value.doubleValue); break;
+            case RuntimeValue::Type::Bool: brainrot_print_int(value.boolValue); break;
+            case RuntimeValue::Type::String: brainrot_print_str(value.stringValue); break;
+            case RuntimeValue::Type::Squad: break;  // Rejected above
+        }
+    }
+    brainrot_print_string("\n", 1);
+    return Completion::Normal;
+}
+
+Completion Interpreter::visitSus(AST::SusStmtAST* stmt) {
+    if (toBool(visit(stmt->getCondition()))) {
+        return runBody(stmt->getThenBlock());
+    }
+    return runBody(stmt->getElseBlock());
+}
+
+Completion Interpreter::visitBet(AST::BetStmtAST* stmt) {
+    if (stmt->getInit()) {
+        visit(stmt->getInit());
+    }
+
+    LoopInfo& loop = loops.find(stmt)->second;
+    for (;;) {
+        // Loop header: once the compiled loop is ready, it takes over the
+        // frame and runs the remaining iterations
+        if (CodeGen::TierLoop native = loop.native.load(std::memory_order_acquire)) {
+            if (native(frame)) {
+                returnValue = fromCell(frame[current->slotNames.size()], current->types->result);
+                return Completion::Return;
+            }
+            return Completion::Normal;
+        }
+
+        if (stmt->getCondition() && !toBool(visit(stmt->getCondition()))) {
+            return Completion::Normal;
+        }
+        if (runBody(stmt->getBody()) == Completion::Return) {
+            return Completion::Return;
+        }
+        if (stmt->getIncrement()) {
+            visit(stmt->getIncrement());
+        }
+
+        if (++loop.iterations >= hotIterations && !loop.queued) {
+            loop.queued = true;
+            queueJob({loop.owner, stmt});
+        }
+    }
+}
+
+// Top-level functions are entered through calls; nested ones were
+// rejected by the Resolver
+Completion Interpreter::visitBruh(AST::BruhAST*) {
+    return Completion::Normal;
+}
+
+Completion Interpreter::visitSigma(AST::SigmaAST*) {
+    return Completion::Normal;
+}
+
+Completion Interpreter::visitCook(AST::CookAST* cook) {
+    return runBody(cook->getBody());
+}
+
+Completion Interpreter::visitExprStmt(AST::ExprStmtAST* stmt) {
+    visit(stmt->getExpr());
+    return Completion::Normal;
+}
+
+Completion Interpreter::visitVarDecl(AST::VarDeclStmtAST* stmt) {
+    RuntimeValue value = visit(stmt->getInitializer());
+    uint32_t slot = current->slots.find(stmt->getName())->second;
+    frame[slot] = toCell(value, current->slotTypes[slot]);
+    return Completion::Normal;
+}
+
+Completion Interpreter::visitSolulu(AST::SoluluStmtAST* stmt) {
+    returnValue = stmt->getValue() ? visit(stmt->getValue()) : defaultValue(current->types->result);
+    return Completion::Return;
+}
+
+Completion Interpreter::visitYoink(AST::YoinkStmtAST* stmt) {
+    int64_t index = toIndex(visit(stmt->getIndex()));
+    RuntimeValue value = visit(stmt->getValue());
+    ValueType type = elementType(current->types->variable(stmt->getName()));
+    squadInsert(squadIn(stmt->getName()), index, toCell(value, type));
+    return Completion::Normal;
+}
+
+Completion Interpreter::visitYeet(AST::YeetStmtAST* stmt) {
+    int64_t index = toIndex(visit(stmt->getIndex()));
+    squadRemove(squadIn(stmt->getName()), index);
+    return Completion::Normal;
+}
@@ -1,45 +1,385 @@
+#include "arena.h"
+#include "brainrot_rt.h"
+#include "bytecode.h"
 #include "lexer.h"
 #include "parser.h"
 #include "codegen.h"
+#include "fold.h"
+#include "interpreter.h"
+#include "object_cache.h"
+#include "source.h"
+#include "thread_pool.h"
+#include "token_stream.h"
+#include "vm.h"
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
 #include <iostream>
-#include <fstream>
-#include <sstream>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
 
 namespace {
-    std::string readFile(const std::string& path) {
-        std::ifstream file(path);
-        if (!file) {
-            throw std::runtime_error("Could not open file: " + path);
+    // What runs the program: LLVM-compiled native code or the bytecode VM
+    enum class Backend { JIT, VM };
+
+    struct DriverOptions {
+        std::string inputPath;
+        bool threadedLexer = false;  // Lex on a producer thread while parsing
+        unsigned jobs = 1;           // Threads for the parallel front end, 0 = all cores
+        bool stats = false;          // Report per-phase timings on stderr
+        bool dumpFlatAst = false;    // Print the flat AST instead of running
+        size_t maxNesting = Parser::defaultMaxNesting;
+        CodeGenOptions codegen;      // -O level, pass timing and remarks
+        std::string outputPath;      // -o; an executable unless another kind is asked for
+        bool compileOnly = false;    // -c: stop at the object file
+        bool emitLLVM = false;       // Write textual LLVM IR
+        bool emitAsm = false;        // Write target assembly
+        bool tiered = false;         // Interpret first, compile hot code in the background
+        Backend backend = Backend::JIT;
+        int64_t threads = 0;         // goated bet workers; 0 leaves the runtime's default
+        int64_t grain = 0;           // goated bet iterations per chunk; 0 likewise
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    double millisecondsSince(Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    void printUsage(const char* program) {
+        std::cerr << "Usage: " << program << " [options] <source_file>\n"
+                  << "Options:\n"
+                  << "  --lex-thread    Overlap lexing and parsing on two threads\n"
+                  << "  --jobs=N        Lex and parse in parallel on N threads (0 = all cores)\n"
+                  << "  --stats         Print per-phase timings to stderr\n"
+                  << "  --dump-flat-ast Print the flat AST and exit\n"
+                  << "  --max-nesting=N Reject expressions or blocks nested deeper than N (default and at most "
+                  << Parser::defaultMaxNesting << ")\n"
+                  << "  -O0 .. -O3      Optimization level for the generated code (default -O0)\n"
+                  << "  --time-passes   Print the time spent in each optimization pass\n"
+                  << "  --opt-remarks=F Write optimization remarks to F as YAML\n"
+                  << "  -c              Compile to an object file instead of running\n"
+                  << "  -o <file>       Output file; without -c, link an executable\n"
+                  << "  --emit-llvm     Write LLVM IR instead of running\n"
+                  << "  --emit-asm      Write assembly instead of running\n"
+                  << "  --cache-dir=D   Keep compiled code in D and reuse it across runs\n"
+                  << "  --cache-size=MB Evict least recently used entries past MB (default 256)\n"
+                  << "  --lazy          Compile each function on its first call (no object cache)\n"
+                  << "  --speculate     --lazy, and compile likely callees on background threads\n"
+                  << "  --tiered        Start in the interpreter, compile hot functions and loops\n"
+                  << "  --backend=B     Run on the LLVM JIT (jit, default) or the bytecode VM (vm)\n"
+                  << "  --threads=N     Run goated bet loops on N threads (default: all cores)\n"
+                  << "  --grain=N       Hand goated bet iterations to threads N at a time\n";
+    }
+
+    // Reads the value of a numeric option, a whole number no larger than
+    // max; anything else is reported and rejected
+    template <typename T>
+    bool parseCount(std::string_view option, std::string_view text, uint64_t max, T& value) {
+        uint64_t parsed = 0;
+        const char* end = text.data() + text.size();
+        auto [stop, error] = std::from_chars(text.data(), end, parsed);
+        if (text.empty() || error != std::errc() || stop != end || parsed > max) {
+            std::cerr << "Invalid value for " << option << ": '" << text << "' (expected 0 to " << max << ")\n";
+            return false;
+        }
+        value = static_cast<T>(parsed);
+        return true;
+    }
+
+    bool parseArguments(int argc, char* argv[], DriverOptions& options) {
+        for (int i = 1; i < argc; ++i) {
+            std::string_view arg = argv[i];
+            if (arg == "--lex-thread") {
+                options.threadedLexer = true;
+            } else if (arg == "--stats") {
+                options.stats = true;
+            } else if (arg == "--dump-flat-ast") {
+                options.dumpFlatAst = true;
+            } else if (arg.substr(0, 14) == "--max-nesting=") {
+                // Only the parser is iterative; the passes after it recurse
+                if (!parseCount("--max-nesting", arg.substr(14), Parser::defaultMaxNesting, options.maxNesting)) {
+                    return false;
+                }
+            } else if (arg.size() == 3 && arg[0] == '-' && arg[1] == 'O' && arg[2] >= '0' &&
+                       arg[2] <= '3') {
+                options.codegen.optLevel = static_cast<unsigned>(arg[2] - '0');
+            } else if (arg == "-c") {
+                options.compileOnly = true;
+            } else if (arg == "-o") {
+                if (++i == argc) {
+                    std::cerr << "Missing file name after -o\n";
+                    return false;
+                }
+                options.outputPath = argv[i];
+            } else if (arg == "--emit-llvm") {
+                options.emitLLVM = true;
+            } else if (arg == "--emit-asm") {
+                options.emitAsm = true;
+            } else if (arg.substr(0, 12) == "--cache-dir=") {
+                options.codegen.cacheDir = std::string(arg.substr(12));
+            } else if (arg.substr(0, 13) == "--cache-size=") {
+                uint64_t megabytes = 0;
+                if (!parseCount("--cache-size", arg.substr(13), std::numeric_limits<uint64_t>::max() >> 20,
+                                megabytes)) {
+                    return false;
+                }
+                options.codegen.cacheMaxBytes = megabytes << 20;
+            } else if (arg == "--lazy") {
+                options.codegen.lazy = true;
+            } else if (arg == "--speculate") {
+                options.codegen.lazy = true;
+                options.codegen.speculate = true;
+            } else if (arg == "--tiered") {
+                options.tiered = true;
+            } else if (arg.substr(0, 10) == "--backend=") {
+                std::string_view backend = arg.substr(10);
+                if (backend == "jit") {
+                    options.backend = Backend::JIT;
+                } else if (backend == "vm") {
+                    options.backend = Backend::VM;
+                } else {
+                    std::cerr << "Unknown backend: " << backend << '\n';
+                    return false;
+                }
+            } else if (arg == "--time-passes") {
+                options.codegen.timePasses = true;
+            } else if (arg.substr(0, 14) == "--opt-remarks=") {
+                options.codegen.remarksFile = std::string(arg.substr(14));
+            } else if (arg.substr(0, 7) == "--jobs=") {
+                if (!parseCount("--jobs", arg.substr(7), std::numeric_limits<unsigned>::max(), options.jobs)) {
+                    return false;
+                }
+            } else if (arg.substr(0, 10) == "--threads=") {
+                if (!parseCount("--threads", arg.substr(10), std::numeric_limits<int64_t>::max(), options.threads)) {
+                    return false;
+                }
+            } else if (arg.substr(0, 8) == "--grain=") {
+                if (!parseCount("--grain", arg.substr(8), std::numeric_limits<int64_t>::max(), options.grain)) {
+                    return false;
+                }
+            } else if (!arg.empty() && arg[0] == '-') {
+                std::cerr << "Unknown option: " << arg << '\n';
+                return false;
+            } else if (options.inputPath.empty()) {
+                options.inputPath = std::string(arg);
+            } else {
+                return false;
+            }
         }
-        return std::string(
-            std::istreambuf_iterator<char>(file),
-            std::istreambuf_iterator<char>()
-        );
+        return !options.inputPath.empty();
+    }
+
+    bool isAheadOfTime(const DriverOptions& options) {
+        return options.compileOnly || options.emitLLVM || options.emitAsm ||
+               !options.outputPath.empty();
+    }
+
+    // Names an output after the input, as C compilers do: prog.skibidi -> prog.o
+    std::string defaultOutputPath(const std::string& inputPath, const char* extension) {
+        return std::filesystem::path(inputPath).filename().replace_extension(extension).string();
+    }
+
+    // Bytecode does not depend on the target, so its cache entries are
+    // keyed by the source alone. They share the object cache's directory.
+    std::unique_ptr<DiskObjectCache> openBytecodeCache(const DriverOptions& options, std::string_view source) {
+        if (options.codegen.cacheDir.empty()) {
+            return nullptr;
+        }
+        return std::make_unique<DiskObjectCache>(options.codegen.cacheDir,
+                                                 DiskObjectCache::programKey(source, 0, "bytecode", ""),
+                                                 options.codegen.cacheMaxBytes);
+    }
+
+    // Ahead-of-time path: write the requested file, or an object file that
+    // is linked into an executable and then removed
+    bool compileAheadOfTime(CodeGen& codegen, const DriverOptions& options) {
+        if (options.emitLLVM || options.emitAsm) {
+            const char* extension = options.emitLLVM ? ".ll" : ".s";
+            std::string path = options.outputPath.empty()
+                                   ? defaultOutputPath(options.inputPath, extension)
+                                   : options.outputPath;
+            return codegen.emitFile(path, options.emitLLVM ? OutputKind::LLVMIR : OutputKind::Assembly);
+        }
+        if (options.compileOnly) {
+            std::string path = options.outputPath.empty()
+                                   ? defaultOutputPath(options.inputPath, ".o")
+                                   : options.outputPath;
+            return codegen.emitFile(path, OutputKind::Object);
+        }
+
+        std::string objectPath = options.outputPath + ".o";
+        bool linked = codegen.emitFile(objectPath, OutputKind::Object) &&
+                      linkExecutable(objectPath, options.outputPath);
+        std::remove(objectPath.c_str());
+        return linked;
     }
 }
 
 int main(int argc, char *argv[]) {
-    if (argc != 2) {
-        std::cerr << "Usage: " << argv[0] << " <source_file>\n";
+    DriverOptions options;
+    if (!parseArguments(argc, argv, options)) {
+        printUsage(argv[0]);
         return 1;
     }
 
+    // Executables written with -o read BRAINROT_THREADS and BRAINROT_GRAIN
+    // instead
+    if (options.threads > 0 || options.grain > 0) {
+        brainrot_parallel_configure(options.threads, options.grain);
+    }
+
     try {
-        const auto source = readFile(argv[1]);
+        // Map the file; tokens and lexemes refer into this buffer
+        SourceFile source(options.inputPath);
+
+        // With a warm object cache the program runs straight away, without
+        // being lexed, parsed or compiled. Tiered runs only set LLVM up
+        // once something is hot, and the VM never does; files are always
+        // written by LLVM.
+        bool useVM = options.backend == Backend::VM && !isAheadOfTime(options) && !options.dumpFlatAst;
+        bool tiered = options.tiered && !useVM && !isAheadOfTime(options);
+        std::unique_ptr<DiskObjectCache> bytecodeCache;
+        if (useVM) {
+            bytecodeCache = openBytecodeCache(options, source.contents());
+            auto entry = bytecodeCache ? bytecodeCache->load("bytecode") : nullptr;
+            if (entry) {
+                // A damaged entry fails verification and is recompiled
+                auto bytecode = Bytecode::deserialize(
+                    std::string_view(entry->getBufferStart(), entry->getBufferSize()));
+                if (bytecode) {
+                    if (options.stats) {
+                        std::cerr << "[stats] bytecode cache: hit\n";
+                    }
+                    VM(*bytecode).run();
+                    return 0;
+                }
+            }
+        }
+        std::optional<CodeGen> codegen;
+        if (!tiered && !useVM) {
+            codegen.emplace(options.codegen);
+            if (!isAheadOfTime(options) && !options.dumpFlatAst &&
+                codegen->executeCached(source.contents())) {
+                if (options.stats) {
+                    std::cerr << "[stats] object cache: hit\n";
+                }
+                return 0;
+            }
+        }
+        
+        auto frontEndStart = Clock::now();
+
+        // Either lex everything up front across the thread pool, or let the
+        // parser pull tokens on demand so only a small window of them is
+        // alive at any time
+        Lexer lexer(source.contents());
+        std::unique_ptr<ThreadPool> pool;
+        TokenBuffer tokenBuffer;
+        std::unique_ptr<TokenStream> tokens;
+        if (options.jobs != 1) {
+            pool = std::make_unique<ThreadPool>(options.jobs);
+            tokenBuffer = scanTokensParallel(source.contents(), *pool);
+            tokens = std::make_unique<TokenStream>(tokenBuffer);
+        } else {
+            tokens = std::make_unique<TokenStream>(lexer, options.threadedLexer);
+        }
+        
+        if (options.dumpFlatAst) {
+            AST::FlatAST flat;
+            FlatParser parser(*tokens, flat);
+            parser.setMaxNesting(options.maxNesting);
+            parser.parseProgram();
+            if (options.stats) {
+                std::cerr << "[stats] flat ast: " << flat.size() << " nodes, "
+                          << flat.memoryUsage() << " bytes\n";
+            }
+            flat.dump(std::cout);
+            return 0;
+        }
+
+        // The AST lives in this arena and is freed with it in one go. With a
+        // pool, top-level declarations are parsed in parallel as well.
+        Arena arena;
+        AST::ProgramAST* ast;
+        size_t tokenCount;
+        if (pool) {
+            ast = parseProgramParallel(tokenBuffer, arena, *pool, options.maxNesting);
+            tokenCount = tokenBuffer.size();
+        } else {
+            Parser parser(*tokens, arena);
+            parser.setMaxNesting(options.maxNesting);
+            ast = parser.parseProgram();
+            tokenCount = tokens->position();
+        }
         
-        Lexer lexer(source);
-        auto tokens = lexer.scanTokens();
+        if (options.stats) {
+            // With streaming, lexing runs inside the parse loop, so the two
+            // phases are reported together
+            double ms = millisecondsSince(frontEndStart);
+            std::cerr << "[stats] lex+parse: " << tokenCount << " tokens in " << ms << " ms ("
+                      << (ms > 0 ? tokenCount / ms / 1000.0 : 0.0) << " Mtok/s)\n";
+            std::cerr << "[stats] ast arena: " << arena.getBytesUsed() << " bytes used, "
+                      << arena.getBytesReserved() << " reserved\n";
+        }
+
+        // Every backend gets the folded tree
+        auto foldStart = Clock::now();
+        FoldStats folded;
+        ast = foldConstants(ast, arena, folded);
+        if (options.stats) {
+            std::cerr << "[stats] fold: " << folded.nodes << " nodes folded, " << folded.branches
+                      << " branches and " << folded.loops << " loops removed in "
+                      << millisecondsSince(foldStart) << " ms\n";
+        }
         
-        Parser parser(tokens);
-        auto ast = parser.parseCook();
+        if (useVM) {
+            auto compileStart = Clock::now();
+            Bytecode bytecode = compileBytecode(ast);
+            if (options.stats) {
+                std::cerr << "[stats] bytecode: " << bytecode.code.size() << " words in "
+                          << millisecondsSince(compileStart) << " ms\n";
+            }
+            if (bytecodeCache) {
+                bytecodeCache->store("bytecode", bytecode.serialize());
+            }
+            VM(bytecode).run();
+            return 0;
+        }
+
+        if (tiered) {
+            Interpreter interpreter(ast, options.codegen);
+            interpreter.run();
+            if (options.stats) {
+                std::cerr << "[stats] tiered: " << interpreter.compiledFunctions() << " functions, "
+                          << interpreter.compiledLoops() << " loops compiled\n";
+            }
+            return 0;
+        }
+
+        auto codegenStart = Clock::now();
+        codegen->generateCode(ast);
+        if (options.stats) {
+            std::cerr << "[stats] codegen: " << millisecondsSince(codegenStart) << " ms\n";
+        }
         
-        CodeGen codegen;
-        codegen.generateCode(ast.get());
-        codegen.executeCode();
+        if (isAheadOfTime(options)) {
+            return compileAheadOfTime(*codegen, options) ? 0 : 1;
+        }
+
+        codegen->executeCode();
         
         return 0;
     } catch (const std::exception& e) {
+        // Output printed before a runtime error comes first, as it does
+        // when compiled code fails a bounds check
+        brainrot_flush();
+        std::fflush(stdout);
         std::cerr << "Error: " << e.what() << '\n';
         return 1;
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,164 @@
+#include "object_cache.h"
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/SHA256.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/Support/xxhash.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+namespace {
+    // Bump when the layout of cache entries changes
+    constexpr const char* cacheFormat = "skibidi-objcache-1";
+
+    // Temporary files this old belong to a writer that died mid-write
+    constexpr auto orphanAge = std::chrono::hours(1);
+
+    // Identifies this build of the compiler. Any rebuild changes the
+    // executable's size or timestamp, which retires objects produced by
+    // older code generators.
+    std::string compilerBuild() {
+        static int anchor;
+        std::string path = llvm::sys::fs::getMainExecutable(nullptr, &anchor);
+        llvm::sys::fs::file_status status;
+        if (path.empty() || llvm::sys::fs::status(path, status)) {
+            return LLVM_VERSION_STRING;
+        }
+        auto modified = status.getLastModificationTime().time_since_epoch().count();
+        return std::string(LLVM_VERSION_STRING) + ":" + std::to_string(status.getSize()) + ":" +
+               std::to_string(modified);
+    }
+
+    std::string sha256Hex(llvm::StringRef data) {
+        auto digest = llvm::SHA256::hash(llvm::arrayRefFromStringRef(data));
+        return llvm::toHex(digest, true);
+    }
+}
+
+DiskObjectCache::DiskObjectCache(std::string directory, std::string programKey, uint64_t maxBytes)
+    : directory(std::move(directory)), key(std::move(programKey)), maxBytes(maxBytes) {
+    // A directory that cannot be created just makes every lookup miss
+    llvm::sys::fs::create_directories(this->directory);
+}
+
+std::string DiskObjectCache::programKey(std::string_view source, unsigned optLevel,
+                                        const std::string& cpu, const std::string& features) {
+    // Hash the source on its own first so it is never copied
+    std::string material = sha256Hex(llvm::StringRef(source.data(), source.size()));
+    material += '\n';
+    material += cacheFormat;
+    material += '\n' + compilerBuild();
+    material += "\n-O" + std::to_string(optLevel);
+    material += '\n' + cpu;
+    material += '\n' + features;
+    return sha256Hex(material);
+}
+
+std::string DiskObjectCache::entryPath(llvm::StringRef moduleName) const {
+    llvm::SmallString<256> path(directory);
+    llvm::sys::path::append(path, key + "-" + llvm::utohexstr(llvm::xxHash64(moduleName), true) + ".o");
+    return std::string(path);
+}
+
+std::unique_ptr<llvm::MemoryBuffer> DiskObjectCache::load(llvm::StringRef moduleName) {
+    std::string path = entryPath(moduleName);
+    int fd;
+    if (llvm::sys::fs::openFileForRead(path, fd)) {
+        return nullptr;
+    }
+
+    // The modification time doubles as the last use for eviction
+    llvm::sys::fs::setLastAccessAndModificationTime(fd, std::chrono::system_clock::now());
+    auto bufferOrError = llvm::MemoryBuffer::getOpenFile(fd, path, -1, false);
+    llvm::sys::fs::file_t file = fd;
+    llvm::sys::fs::closeFile(file);
+    if (!bufferOrError) {
+        return nullptr;
+    }
+    return std::move(*bufferOrError);
+}
+
+std::unique_ptr<llvm::MemoryBuffer> DiskObjectCache::getObject(const llvm::Module* module) {
+    return load(module->getModuleIdentifier());
+}
+
+void DiskObjectCache::notifyObjectCompiled(const llvm::Module* module, llvm::MemoryBufferRef object) {
+    store(module->getModuleIdentifier(), object.getBuffer());
+}
+
+void DiskObjectCache::store(llvm::StringRef name, llvm::StringRef data) {
+    // Write under a unique name and rename into place, so other processes
+    // see either no entry or a complete one
+    llvm::SmallString<256> model(directory);
+    llvm::sys::path::append(model, "%%%%%%%%%%%%.tmp");
+    int fd;
+    llvm::SmallString<256> tempPath;
+    if (llvm::sys::fs::createUniqueFile(model, fd, tempPath)) {
+        return;
+    }
+
+    bool written;
+    {
+        llvm::raw_fd_ostream out(fd, true);
+        out << data;
+        out.close();
+        written = !out.has_error();
+        out.clear_error();
+    }
+    if (!written || llvm::sys::fs::rename(tempPath, entryPath(name))) {
+        llvm::sys::fs::remove(tempPath);
+        return;
+    }
+
+    evict();
+}
+
+// Deletes the least recently used entries until the cache fits in maxBytes.
+// Entries another process removes first are simply skipped.
+void DiskObjectCache::evict() {
+    struct Entry {
+        std::string path;
+        uint64_t size;
+        llvm::sys::TimePoint<> used;
+    };
+    std::vector<Entry> entries;
+    uint64_t total = 0;
+    auto now = std::chrono::system_clock::now();
+
+    std::error_code ec;
+    for (llvm::sys::fs::directory_iterator it(directory, ec), end; it != end && !ec;
+         it.increment(ec)) {
+        llvm::sys::fs::file_status status;
+        if (llvm::sys::fs::status(it->path(), status) ||
+            status.type() != llvm::sys::fs::file_type::regular_file) {
+            continue;
+        }
+
+        llvm::StringRef extension = llvm::sys::path::extension(it->path());
+        if (extension == ".tmp") {
+            if (now - status.getLastModificationTime() > orphanAge) {
+                llvm::sys::fs::remove(it->path());
+            }
+        } else if (extension == ".o") {
+            entries.push_back({it->path(), status.getSize(), status.getLastModificationTime()});
+            total += status.getSize();
+        }
+    }
+    if (total <= maxBytes) {
+        return;
+    }
+
+    std::sort(entries.begin(), entries.end(),
+              [](const Entry& a, const Entry& b) { return a.used < b.used; });
+    for (const Entry& entry : entries) {
+        if (total <= maxBytes) {
+            break;
+        }
+        llvm::sys::fs::remove(entry.path);
+        total -= entry.size;
+    }
+}
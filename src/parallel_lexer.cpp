@@ -0,0 +1,132 @@
+#include "lexer.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <sstream>
+
+namespace {
+
+// Chunks smaller than this are not worth a task of their own
+constexpr size_t minChunkSize = 1 << 20;
+
+// Splitting into more chunks than threads evens out the load when string
+// repair makes some chunks larger than others
+constexpr size_t chunksPerThread = 4;
+
+struct ChunkCounts {
+    size_t quotes = 0;
+    size_t newlines = 0;
+};
+
+// A place where lexing may start: just past a newline and outside any
+// string literal. `line` is the line number of that position.
+struct Boundary {
+    size_t offset;
+    size_t line;
+
+    bool operator<(const Boundary& other) const { return offset < other.offset; }
+    bool operator==(const Boundary& other) const { return offset == other.offset; }
+};
+
+ChunkCounts countChunk(std::string_view source, size_t begin, size_t end) {
+    const scan::Kernels& kernels = scan::kernels();
+    ChunkCounts counts;
+    const char* p = source.data() + begin;
+    const char* last = source.data() + end;
+    while ((p = kernels.findQuote(p, last, &counts.newlines)) < last) {
+        ++counts.quotes;
+        ++p;
+    }
+    return counts;
+}
+
+// Moves a candidate boundary that lies inside a string literal forward to
+// the first newline that is outside any string. String literals have no
+// escapes, so every '"' toggles between code and string.
+Boundary leaveString(std::string_view source, Boundary boundary) {
+    bool inString = true;
+    size_t pos = boundary.offset;
+    size_t line = boundary.line;
+    for (; pos < source.size(); ++pos) {
+        char c = source[pos];
+        if (c == '"') {
+            inString = !inString;
+        } else if (c == '\n') {
+            ++line;
+            if (!inString) return {pos + 1, line};
+        }
+    }
+    return {source.size(), line};
+}
+
+}
+
+TokenBuffer scanTokensParallel(std::string_view source, ThreadPool& pool) {
+    size_t chunkCount = std::min<size_t>(pool.size() * chunksPerThread,
+                                         source.size() / minChunkSize);
+    if (chunkCount < 2) {
+        return Lexer(source).scanTokens();
+    }
+
+    // Initial boundaries just past the first newline after each even split
+    std::vector<size_t> splits{0};
+    for (size_t i = 1; i < chunkCount; ++i) {
+        size_t newline = source.find('\n', source.size() * i / chunkCount);
+        if (newline == std::string_view::npos) break;
+        if (newline + 1 > splits.back() && newline + 1 < source.size()) {
+            splits.push_back(newline + 1);
+        }
+    }
+    splits.push_back(source.size());
+
+    // Pre-pass: quote parity and newline counts for each initial chunk
+    std::vector<ChunkCounts> counts(splits.size() - 1);
+    pool.run(counts.size(), [&](size_t i) {
+        counts[i] = countChunk(source, splits[i], splits[i + 1]);
+    });
+
+    // Repair boundaries that land inside a string literal. The parity of
+    // the quotes before a split tells whether it does.
+    std::vector<Boundary> boundaries{{0, 1}};
+    size_t quotesBefore = 0;
+    size_t lineAt = 1;
+    for (size_t i = 1; i + 1 < splits.size(); ++i) {
+        quotesBefore += counts[i - 1].quotes;
+        lineAt += counts[i - 1].newlines;
+        Boundary boundary{splits[i], lineAt};
+        if (quotesBefore % 2 != 0) {
+            boundary = leaveString(source, boundary);
+        }
+        if (boundary.offset < source.size()) {
+            boundaries.push_back(boundary);
+        }
+    }
+    std::sort(boundaries.begin(), boundaries.end());
+    boundaries.erase(std::unique(boundaries.begin(), boundaries.end()), boundaries.end());
+
+    // Lex the repaired chunks concurrently. Diagnostics are buffered per
+    // chunk and replayed in source order.
+    size_t chunks = boundaries.size();
+    std::vector<TokenBuffer> chunkTokens(chunks, TokenBuffer(source));
+    std::vector<std::ostringstream> chunkDiagnostics(chunks);
+    pool.run(chunks, [&](size_t i) {
+        size_t end = i + 1 < chunks ? boundaries[i + 1].offset : source.size();
+        Lexer lexer(source, boundaries[i].offset, end, boundaries[i].line, chunkDiagnostics[i]);
+        TokenBuffer& tokens = chunkTokens[i];
+        tokens.reserve((end - boundaries[i].offset) / 4);
+        for (Token token = lexer.nextToken(); token.type != TOK_EOF; token = lexer.nextToken()) {
+            tokens.push(token);
+        }
+    });
+
+    size_t total = 1;
+    for (const auto& tokens : chunkTokens) total += tokens.size();
+
+    TokenBuffer result(source);
+    result.reserve(total);
+    for (size_t i = 0; i < chunks; ++i) {
+        result.append(chunkTokens[i]);
+        std::cerr << chunkDiagnostics[i].str();
+    }
+    result.push(TOK_EOF, source.size(), 0);
+    return result;
+}
@@ -0,0 +1,252 @@
+#include "parallel_loop.h"
+#include "ast_visitor.h"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace {
+    bool isVariable(AST::ExprAST* expr, std::string_view name) {
+        auto variable = AST::dyn_cast<AST::VariableExprAST>(expr);
+        return variable && variable->getName() == name;
+    }
+
+    // Names declared anywhere in a body, nested loops' counters included
+    void collectDeclarations(const AST::StmtList& body, std::vector<std::string_view>& names) {
+        for (AST::StmtAST* stmt : body) {
+            if (auto decl = AST::dyn_cast<AST::VarDeclStmtAST>(stmt)) {
+                names.push_back(decl->getName());
+            } else if (auto sus = AST::dyn_cast<AST::SusStmtAST>(stmt)) {
+                collectDeclarations(sus->getThenBlock(), names);
+                collectDeclarations(sus->getElseBlock(), names);
+            } else if (auto bet = AST::dyn_cast<AST::BetStmtAST>(stmt)) {
+                if (auto init = AST::dyn_cast<AST::VarDeclStmtAST>(bet->getInit())) {
+                    names.push_back(init->getName());
+                }
+                collectDeclarations(bet->getBody(), names);
+            }
+        }
+    }
+
+    // Walks the body, sorting every variable it touches into private,
+    // reduced and shared, and rejecting whatever iterations could race on
+    class LoopChecker : public AST::Visitor<LoopChecker> {
+    public:
+        LoopChecker(ParallelLoop& loop, const ProgramTypes& program) : loop(loop), program(program) {}
+
+        void visitBody(const AST::StmtList& body) {
+            for (AST::StmtAST* stmt : body) visit(stmt);
+        }
+
+        // Reductions must never be read but by their own updates
+        void finish() {
+            for (std::string_view name : reads) {
+                if (reduction(name)) {
+                    throw std::runtime_error("Reduction '" + std::string(name) +
+                                             "' cannot be read inside its goated bet");
+                }
+                if (std::find(loop.captured.begin(), loop.captured.end(), name) == loop.captured.end()) {
+                    loop.captured.push_back(name);
+                }
+            }
+        }
+
+        void visitNumber(AST::NumberExprAST*) {}
+        void visitString(AST::StringExprAST*) {}
+        void visitVariable(AST::VariableExprAST* expr) { read(expr->getName()); }
+        void visitBinary(AST::BinaryExprAST* expr) { visit(expr->getLHS()); visit(expr->getRHS()); }
+        void visitUnary(AST::UnaryExprAST* expr) { visit(expr->getOperand()); }
+        void visitCall(AST::CallExprAST* expr) {
+            for (AST::ExprAST* arg : expr->getArgs()) visit(arg);
+        }
+        void visitGrouping(AST::GroupingExprAST* expr) { visit(expr->getExpression()); }
+        void visitAssign(AST::AssignExprAST* expr) {
+            assign(expr->getName());
+            visit(expr->getValue());
+        }
+        void visitSquad(AST::SquadExprAST* expr) {
+            for (AST::ExprAST* element : expr->getElements()) visit(element);
+        }
+        void visitIndex(AST::IndexExprAST* expr) {
+            read(expr->getName());
+            visit(expr->getIndex());
+        }
+        void visitIndexAssign(AST::IndexAssignExprAST* expr) {
+            read(expr->getName());
+            visit(expr->getIndex());
+            visit(expr->getValue());
+        }
+        void visitLength(AST::LengthExprAST* expr) { read(expr->getName()); }
+
+        void visitYap(AST::YapStmtAST* stmt) {
+            for (AST::ExprAST* arg : stmt->getArgs()) visit(arg);
+        }
+        void visitSus(AST::SusStmtAST* stmt) {
+            visit(stmt->getCondition());
+            visitBody(stmt->getThenBlock());
+            visitBody(stmt->getElseBlock());
+        }
+        void visitBet(AST::BetStmtAST* stmt) {
+            if (stmt->getInit()) visit(stmt->getInit());
+            if (stmt->getCondition()) visit(stmt->getCondition());
+            visitBody(stmt->getBody());
+            if (stmt->getIncrement()) visit(stmt->getIncrement());
+        }
+        void visitBruh(AST::BruhAST*) {}
+        void visitSigma(AST::SigmaAST*) {}
+        void visitCook(AST::CookAST*) {}
+        void visitExprStmt(AST::ExprStmtAST* stmt) {
+            if (AST::ExprAST* operand = reductionOperand(stmt->getExpr())) {
+                visit(operand);
+            } else {
+                visit(stmt->getExpr());
+            }
+        }
+        void visitVarDecl(AST::VarDeclStmtAST* stmt) {
+            assign(stmt->getName());
+            visit(stmt->getInitializer());
+        }
+        void visitSolulu(AST::SoluluStmtAST*) {
+            throw std::runtime_error("solulu cannot leave a goated bet");
+        }
+        void visitYoink(AST::YoinkStmtAST* stmt) {
+            resize(stmt->getName());
+            visit(stmt->getIndex());
+            visit(stmt->getValue());
+        }
+        void visitYeet(AST::YeetStmtAST* stmt) {
+            resize(stmt->getName());
+            visit(stmt->getIndex());
+        }
+
+    private:
+        ParallelLoop& loop;
+        const ProgramTypes& program;
+        std::vector<std::string_view> reads;  // Of variables from outside the body
+
+        bool local(std::string_view name) const {
+            return name == loop.counter || std::find(loop.locals.begin(), loop.locals.end(), name) != loop.locals.end();
+        }
+
+        ParallelLoop::Reduction* reduction(std::string_view name) {
+            for (ParallelLoop::Reduction& reduction : loop.reductions) {
+                if (reduction.name == name) return &reduction;
+            }
+            return nullptr;
+        }
+
+        void read(std::string_view name) {
+            if (!local(name)) {
+                reads.push_back(name);
+            }
+        }
+
+        void assign(std::string_view name) {
+            if (name == loop.counter) {
+                throw std::runtime_error("goated bet cannot change its counter '" + std::string(name) + "'");
+            }
+            if (!local(name)) {
+                throw std::runtime_error("'" + std::string(name) +
+                                         "' is assigned in a goated bet but is not a sum, min or max reduction");
+            }
+        }
+
+        void resize(std::string_view name) {
+            if (!local(name)) {
+                throw std::runtime_error("goated bet cannot resize '" + std::string(name) +
+                                         "', which its iterations share");
+            }
+            read(name);
+        }
+
+        // For x = x + e, x = min(x, e) or x = max(x, e) with x from outside
+        // the body, records the reduction and returns e; else null
+        AST::ExprAST* reductionOperand(AST::ExprAST* expr) {
+            auto assign = AST::dyn_cast<AST::AssignExprAST>(expr);
+            if (!assign || local(assign->getName())) {
+                return nullptr;
+            }
+            std::string_view name = assign->getName();
+            AST::ExprAST* value = assign->getValue();
+            while (auto grouping = AST::dyn_cast<AST::GroupingExprAST>(value)) {
+                value = grouping->getExpression();
+            }
+
+            ParallelLoop::Reduce kind;
+            AST::ExprAST* lhs;
+            AST::ExprAST* rhs;
+            if (auto sum = AST::dyn_cast<AST::BinaryExprAST>(value); sum && sum->getOp() == AST::BinaryOp::Add) {
+                kind = ParallelLoop::Reduce::Sum;
+                lhs = sum->getLHS();
+                rhs = sum->getRHS();
+            } else if (auto call = AST::dyn_cast<AST::CallExprAST>(value);
+                       call && isMinMax(program, call->getCallee()) && call->getArgs().size() == 2) {
+                kind = call->getCallee() == "min" ? ParallelLoop::Reduce::Min : ParallelLoop::Reduce::Max;
+                lhs = call->getArgs()[0];
+                rhs = call->getArgs()[1];
+            } else {
+                return nullptr;
+            }
+            AST::ExprAST* operand = isVariable(lhs, name) ? rhs : isVariable(rhs, name) ? lhs : nullptr;
+            if (!operand) {
+                return nullptr;
+            }
+
+            if (ParallelLoop::Reduction* existing = reduction(name)) {
+                if (existing->kind != kind) {
+                    throw std::runtime_error("Reduction '" + std::string(name) +
+                                             "' mixes sum, min and max in a goated bet");
+                }
+            } else {
+                loop.reductions.push_back({name, kind, ValueType::Unknown});
+            }
+            return operand;
+        }
+    };
+}
+
+bool isIncrement(AST::StmtAST* stmt, std::string_view counter) {
+    auto exprStmt = AST::dyn_cast<AST::ExprStmtAST>(stmt);
+    auto assign = exprStmt ? AST::dyn_cast<AST::AssignExprAST>(exprStmt->getExpr()) : nullptr;
+    auto sum = assign ? AST::dyn_cast<AST::BinaryExprAST>(assign->getValue()) : nullptr;
+    if (!sum || assign->getName() != counter || sum->getOp() != AST::BinaryOp::Add) {
+        return false;
+    }
+    auto isOne = [](AST::ExprAST* expr) {
+        auto number = AST::dyn_cast<AST::NumberExprAST>(expr);
+        return number && !number->isFloatingPoint() && number->getIntValue() == 1;
+    };
+    return (isVariable(sum->getLHS(), counter) && isOne(sum->getRHS())) ||
+           (isOne(sum->getLHS()) && isVariable(sum->getRHS(), counter));
+}
+
+ParallelLoop analyzeParallelLoop(AST::BetStmtAST* stmt, const ProgramTypes& program, const FunctionTypes& types) {
+    auto init = AST::dyn_cast<AST::VarDeclStmtAST>(stmt->getInit());
+    auto condition = AST::dyn_cast<AST::BinaryExprAST>(stmt->getCondition());
+    if (!init || !condition ||
+        (condition->getOp() != AST::BinaryOp::Less && condition->getOp() != AST::BinaryOp::LessEqual) ||
+        !isVariable(condition->getLHS(), init->getName()) || !isIncrement(stmt->getIncrement(), init->getName())) {
+        throw std::runtime_error("goated bet must count up by one, as in goated bet (pookie i = 0, i < n, i = i + 1)");
+    }
+
+    ParallelLoop loop;
+    loop.counter = init->getName();
+    loop.start = init->getInitializer();
+    loop.end = condition->getRHS();
+    loop.inclusive = condition->getOp() == AST::BinaryOp::LessEqual;
+    if (types.variable(loop.counter) != ValueType::Int) {
+        throw std::runtime_error("goated bet counter '" + std::string(loop.counter) + "' must be an integer");
+    }
+
+    collectDeclarations(stmt->getBody(), loop.locals);
+    LoopChecker checker(loop, program);
+    checker.visitBody(stmt->getBody());
+    checker.finish();
+
+    for (ParallelLoop::Reduction& reduction : loop.reductions) {
+        reduction.type = types.variable(reduction.name);
+        if (reduction.type != ValueType::Int && reduction.type != ValueType::Double) {
+            throw std::runtime_error("Reduction '" + std::string(reduction.name) + "' must be a number");
+        }
+    }
+    return loop;
+}
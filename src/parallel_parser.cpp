@@ -0,0 +1,161 @@
+#include "parser.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <deque>
+
+namespace {
+
+// Programs with fewer tokens than this are parsed serially
+constexpr size_t minParallelTokens = 1 << 16;
+
+// Each task parses at least this many tokens' worth of declarations
+constexpr size_t minBatchTokens = 1 << 14;
+
+// More batches than threads evens out uneven declaration sizes
+constexpr size_t batchesPerThread = 4;
+
+// Tokens [begin, end) of one top-level declaration
+struct DeclarationRange {
+    size_t begin;
+    size_t end;
+    bool isCook;
+};
+
+// Contiguous run of declarations parsed by one task into its own arena.
+// Kept in a deque since an Arena cannot be moved.
+struct Batch {
+    size_t firstRange;
+    size_t rangeCount;
+    Arena arena;
+    std::vector<AST::StmtPtr> declarations;
+};
+
+// Splits the token buffer at top-level declarations by matching braces on
+// the token types alone. Returns false for anything that is not a plain
+// sequence of bruh/sigma/cook blocks (optionally ended by `ghost;`), in
+// which case the caller parses serially and reports the error properly.
+bool findDeclarations(const TokenBuffer& tokens, std::vector<DeclarationRange>& ranges) {
+    size_t count = tokens.size();
+    size_t i = 0;
+    while (i < count && tokens.type(i) != TOK_EOF) {
+        TokenType type = tokens.type(i);
+        if (type == TOK_GHOST) {
+            // The buffer always ends with TOK_EOF
+            return i + 2 < count && tokens.type(i + 1) == TOK_SEMICOLON &&
+                   tokens.type(i + 2) == TOK_EOF;
+        }
+        if (type != TOK_BRUH && type != TOK_SIGMA && type != TOK_COOK) {
+            return false;
+        }
+
+        // The body is the first brace block after the keyword
+        size_t begin = i;
+        while (i < count && tokens.type(i) != TOK_LEFT_BRACE) {
+            if (tokens.type(i) == TOK_EOF) return false;
+            ++i;
+        }
+        size_t depth = 0;
+        for (; i < count; ++i) {
+            TokenType t = tokens.type(i);
+            if (t == TOK_LEFT_BRACE) {
+                ++depth;
+            } else if (t == TOK_RIGHT_BRACE) {
+                if (--depth == 0) break;
+            } else if (t == TOK_EOF) {
+                return false;
+            }
+        }
+        if (i == count) return false;
+        ++i;
+        ranges.push_back({begin, i, type == TOK_COOK});
+    }
+    return true;
+}
+
+// Groups consecutive ranges into batches of roughly equal token counts
+std::deque<Batch> makeBatches(const std::vector<DeclarationRange>& ranges, size_t totalTokens,
+                               size_t threads) {
+    size_t target = std::max(minBatchTokens, totalTokens / (threads * batchesPerThread));
+    std::deque<Batch> batches;
+    size_t first = 0;
+    size_t tokensInBatch = 0;
+    for (size_t i = 0; i < ranges.size(); ++i) {
+        tokensInBatch += ranges[i].end - ranges[i].begin;
+        if (tokensInBatch >= target || i + 1 == ranges.size()) {
+            batches.emplace_back();
+            batches.back().firstRange = first;
+            batches.back().rangeCount = i + 1 - first;
+            first = i + 1;
+            tokensInBatch = 0;
+        }
+    }
+    return batches;
+}
+
+void parseBatch(const TokenBuffer& tokens, const std::vector<DeclarationRange>& ranges,
+                Batch& batch, size_t maxNesting) {
+    const DeclarationRange& first = ranges[batch.firstRange];
+    const DeclarationRange& last = ranges[batch.firstRange + batch.rangeCount - 1];
+    TokenStream stream(tokens, first.begin, last.end);
+    Parser parser(stream, batch.arena);
+    parser.setMaxNesting(maxNesting);
+
+    batch.declarations.reserve(batch.rangeCount);
+    for (size_t i = 0; i < batch.rangeCount; ++i) {
+        const DeclarationRange& range = ranges[batch.firstRange + i];
+        batch.declarations.push_back(parser.parseDeclaration());
+        // A declaration that stops short of its closing brace is a syntax
+        // error the serial parser will describe
+        if (stream.position() != range.end - first.begin) {
+            throw std::runtime_error("Declaration did not end at its closing brace");
+        }
+    }
+}
+
+AST::ProgramAST* parseSerially(const TokenBuffer& tokens, Arena& arena, size_t maxNesting) {
+    TokenStream stream(tokens);
+    Parser parser(stream, arena);
+    parser.setMaxNesting(maxNesting);
+    return parser.parseProgram();
+}
+
+}
+
+AST::ProgramAST* parseProgramParallel(const TokenBuffer& tokens, Arena& arena, ThreadPool& pool,
+                                      size_t maxNesting) {
+    std::vector<DeclarationRange> ranges;
+    if (pool.size() < 2 || tokens.size() < minParallelTokens ||
+        !findDeclarations(tokens, ranges) || ranges.size() < 2 ||
+        std::count_if(ranges.begin(), ranges.end(),
+                      [](const DeclarationRange& r) { return r.isCook; }) != 1) {
+        return parseSerially(tokens, arena, maxNesting);
+    }
+
+    std::deque<Batch> batches = makeBatches(ranges, tokens.size(), pool.size());
+    try {
+        pool.run(batches.size(), [&](size_t i) { parseBatch(tokens, ranges, batches[i], maxNesting); });
+    } catch (const std::exception&) {
+        // Which batch fails first depends on scheduling; re-parse serially
+        // so the error reported is always the first one in the file
+        return parseSerially(tokens, arena, maxNesting);
+    }
+
+    // Merge in source order
+    std::vector<AST::StmtPtr> declarations;
+    declarations.reserve(ranges.size());
+    AST::CookAST* cook = nullptr;
+    for (Batch& batch : batches) {
+        arena.adopt(batch.arena);
+        for (size_t i = 0; i < batch.rangeCount; ++i) {
+            AST::StmtPtr declaration = batch.declarations[i];
+            if (ranges[batch.firstRange + i].isCook) {
+                cook = AST::cast<AST::CookAST>(declaration);
+            }
+            declarations.push_back(declaration);
+        }
+    }
+
+    AST::StmtList list(arena.copyArray(declarations.data(), declarations.size()),
+                       declarations.size());
+    return arena.make<AST::ProgramAST>(list, cook);
+}
@@ -1,34 +1,119 @@
 #include "parser.h"
 #include <stdexcept>
 #include <iostream>
+#include <algorithm>
+#include <array>
 
-// Constructor - Takes a vector of tokens to parse
-Parser::Parser(std::vector<Token> tokens) : tokens(std::move(tokens)) {}
+namespace {
+
+constexpr uint8_t unaryPrecedence = 7;
+constexpr uint8_t plainAssign = 1;
+constexpr uint8_t compoundAssign = 2;
+
+// What a token means in operator position. Binary operators have a
+// precedence above zero (all of them are left-associative); assignment
+// tokens are recognised when they follow an identifier.
+struct OperatorInfo {
+    uint8_t precedence = 0;
+    AST::BinaryOp op = AST::BinaryOp::Add;
+    uint8_t assign = 0;  // plainAssign or compoundAssign
+};
+
+constexpr std::array<OperatorInfo, TOK_EOF + 1> makeOperatorTable() {
+    std::array<OperatorInfo, TOK_EOF + 1> table{};
+    table[TOK_OR_OR] = {1, AST::BinaryOp::Or};
+    table[TOK_AND_AND] = {2, AST::BinaryOp::And};
+    table[TOK_EQUAL_EQUAL] = {3, AST::BinaryOp::Equal};
+    table[TOK_BANG_EQUAL] = {3, AST::BinaryOp::NotEqual};
+    table[TOK_LESS] = {4, AST::BinaryOp::Less};
+    table[TOK_LESS_EQUAL] = {4, AST::BinaryOp::LessEqual};
+    table[TOK_GREATER] = {4, AST::BinaryOp::Greater};
+    table[TOK_GREATER_EQUAL] = {4, AST::BinaryOp::GreaterEqual};
+    table[TOK_PLUS] = {5, AST::BinaryOp::Add};
+    table[TOK_MINUS] = {5, AST::BinaryOp::Sub};
+    table[TOK_STAR] = {6, AST::BinaryOp::Mul};
+    table[TOK_SLASH] = {6, AST::BinaryOp::Div};
+    table[TOK_PERCENT] = {6, AST::BinaryOp::Mod};
+
+    table[TOK_EQUAL] = {0, AST::BinaryOp::Add, plainAssign};
+    table[TOK_PLUS_EQUAL] = {0, AST::BinaryOp::Add, compoundAssign};
+    table[TOK_MINUS_EQUAL] = {0, AST::BinaryOp::Sub, compoundAssign};
+    table[TOK_STAR_EQUAL] = {0, AST::BinaryOp::Mul, compoundAssign};
+    table[TOK_SLASH_EQUAL] = {0, AST::BinaryOp::Div, compoundAssign};
+    table[TOK_PERCENT_EQUAL] = {0, AST::BinaryOp::Mod, compoundAssign};
+    return table;
+}
+
+constexpr std::array<OperatorInfo, TOK_EOF + 1> binaryOperators = makeOperatorTable();
+
+static_assert(binaryOperators[TOK_STAR].precedence > binaryOperators[TOK_PLUS].precedence,
+              "multiplication binds tighter than addition");
+static_assert(unaryPrecedence > binaryOperators[TOK_STAR].precedence,
+              "prefix operators bind tightest");
+
+}
+
+// Constructor - Parses from a token stream owned by the caller
+template <typename Builder>
+BasicParser<Builder>::BasicParser(TokenStream& tokens, Builder builder)
+    : tokens(tokens), builder(builder) {}
+
+// Constructor - Takes a fully scanned token buffer and streams over it
+template <typename Builder>
+BasicParser<Builder>::BasicParser(TokenBuffer buffer, Builder builder)
+    : ownedBuffer(std::move(buffer)),
+      ownedStream(std::make_unique<TokenStream>(ownedBuffer)),
+      tokens(*ownedStream),
+      builder(builder) {}
+
+// Hands the items pushed on a scratch stack since `mark` to the builder as
+// one list. The scratch stacks are reused across the whole parse, so
+// building lists does not allocate once they have grown to the deepest
+// nesting.
+template <typename Builder>
+template <typename T, typename List>
+List BasicParser<Builder>::finishList(std::vector<T>& scratch, size_t mark,
+                                      List (Builder::*makeList)(const T*, size_t)) {
+    List list = (builder.*makeList)(scratch.data() + mark, scratch.size() - mark);
+    scratch.resize(mark);
+    return list;
+}
 
 // Helper method to move forward in the token stream
-Token Parser::advance() {
-    if (!isAtEnd()) current++;
+template <typename Builder>
+const Token& BasicParser<Builder>::advance() {
+    if (!isAtEnd()) tokens.advance();
     return previous();
 }
 
 // Check if we've reached the end of our token stream
-bool Parser::isAtEnd() const {
-    return peek().type == TOK_EOF;
+template <typename Builder>
+bool BasicParser<Builder>::isAtEnd() const {
+    return tokens.peek().type == TOK_EOF;
 }
 
 // Peek at the current token without consuming it
-Token Parser::peek() const {
-    return tokens[current];
+template <typename Builder>
+const Token& BasicParser<Builder>::peek() const {
+    return tokens.peek();
+}
+
+// Materialize a token's text as a view into the source buffer
+template <typename Builder>
+std::string_view BasicParser<Builder>::lexeme(const Token& token) const {
+    return token.lexeme(tokens.source());
 }
 
 // Get the most recently consumed token
-Token Parser::previous() const {
-    return tokens[current - 1];
+template <typename Builder>
+const Token& BasicParser<Builder>::previous() const {
+    return tokens.previous();
 }
 
 // Try to match the current token with an expected type
 // Returns true and advances if matched, false otherwise
-bool Parser::match(TokenType type) {
+template <typename Builder>
+bool BasicParser<Builder>::match(TokenType type) {
     if (check(type)) {
         advance();
         return true;
@@ -37,334 +122,576 @@ bool Parser::match(TokenType type) {
 }
 
 // Check if current token matches expected type without consuming it
-bool Parser::check(TokenType type) const {
-    if (isAtEnd()) return false;
-    return peek().type == type;
+template <typename Builder>
+bool BasicParser<Builder>::check(TokenType type) const {
+    TokenType current = tokens.peek().type;
+    return current == type && current != TOK_EOF;
 }
 
-// Consume a token if it matches expected type, otherwise throw error
-Token Parser::consume(TokenType type, const std::string& message) {
+// Consume a token if it matches expected type, otherwise throw error.
+// The message is only turned into a std::string on the failure path.
+template <typename Builder>
+const Token& BasicParser<Builder>::consume(TokenType type, const char* message) {
     if (check(type)) return advance();
     throw std::runtime_error(message);
 }
 
+// Parse a whole program - top-level declarations around the cook block
+template <typename Builder>
+auto BasicParser<Builder>::parseProgram() -> Program {
+    size_t mark = stmtScratch.size();
+    Root cook = Builder::none();
+    bool haveCook = false;
+
+    while (!isAtEnd()) {
+        // 'ghost;' ends the program
+        if (match(TOK_GHOST)) {
+            consume(TOK_SEMICOLON, "Expected ';' after 'ghost'");
+            if (!isAtEnd()) {
+                throw std::runtime_error("Unexpected code after 'ghost;'");
+            }
+            break;
+        }
+
+        if (check(TOK_COOK)) {
+            if (haveCook) {
+                throw std::runtime_error("Program has more than one 'cook' block");
+            }
+            cook = parseCook();
+            haveCook = true;
+            stmtScratch.push_back(cook);
+        } else {
+            stmtScratch.push_back(parseDeclaration());
+        }
+    }
+
+    if (!haveCook) {
+        throw std::runtime_error("Expected 'cook' block in program");
+    }
+    StmtList declarations = finishList(stmtScratch, mark, &Builder::stmtList);
+    return builder.program(declarations, cook);
+}
+
+// Parse one top-level declaration
+template <typename Builder>
+auto BasicParser<Builder>::parseDeclaration() -> Stmt {
+    if (check(TOK_COOK)) return parseCook();
+    if (match(TOK_BRUH)) return bruhStatement();
+    if (match(TOK_SIGMA)) return sigmaDeclaration();
+    throw std::runtime_error("Expected 'bruh', 'sigma' or 'cook' at top level");
+}
+
 // Parse the main cook{} function - Entry point of our program
-std::unique_ptr<AST::CookAST> Parser::parseCook() {
+template <typename Builder>
+auto BasicParser<Builder>::parseCook() -> Root {
     // Every program must start with 'cook'
     if (!match(TOK_COOK)) {
         throw std::runtime_error("Expected 'cook' at start of program");
     }
     
     // Parse the body of our main function
-    AST::StmtList body;
     consume(TokenType::TOK_LEFT_BRACE, "Expected '{' after 'cook'");
+    size_t mark = stmtScratch.size();
     
     // Keep parsing statements until we hit the closing brace
     while (!check(TokenType::TOK_RIGHT_BRACE) && !isAtEnd()) {
-        body.push_back(statement());
+        Stmt stmt = statement();
+        stmtScratch.push_back(stmt);
     }
     
     consume(TokenType::TOK_RIGHT_BRACE, "Expected '}' after block");
-    return std::make_unique<AST::CookAST>(std::move(body));
+    StmtList body = finishList(stmtScratch, mark, &Builder::stmtList);
+    return builder.cook(body);
 }
 
 // Parse any type of statement - This is where the magic happens!
-AST::StmtPtr Parser::statement() {
+template <typename Builder>
+auto BasicParser<Builder>::statement() -> Stmt {
     // Handle different types of statements based on their keywords
     if (match(TOK_YAP)) return yapStatement();     // yap("Hello!")
     if (match(TOK_FR)) return frStatement();       // fr (condition) { ... }
-    if (match(TOK_BET)) return betStatement();     // bet loops
+    if (match(TOK_BET)) return betStatement(false);  // bet loops
+    if (match(TOK_GOATED)) {
+        // goated bet: a bet whose iterations run in parallel
+        consume(TOK_BET, "Expected 'bet' after 'goated'");
+        return betStatement(true);
+    }
     if (match(TOK_POOKIE)) {
         // Handle pookie (variable) declarations
         Token name = consume(TOK_IDENTIFIER, "Expected variable name after 'pookie'");
         consume(TOK_EQUAL, "Expected '=' after variable name");
-        AST::ExprPtr initializer = expression();
+        Expr initializer = expression();
         consume(TOK_SEMICOLON, "Expected ';' after variable declaration");
-        return std::make_unique<AST::VarDeclStmtAST>(name.lexeme, std::move(initializer));
+        return builder.varDecl(lexeme(name), initializer);
     }
     if (match(TOK_NO_CAP)) {
         // Handle if-else statements with our funky 'no_cap/cap' syntax
         consume(TOK_LEFT_PAREN, "Expected '(' after 'no_cap'");
-        AST::ExprPtr condition = expression();
+        Expr condition = expression();
         consume(TOK_RIGHT_PAREN, "Expected ')' after condition");
         
-        AST::StmtList thenBlock = block();
-        AST::StmtList elseBlock;
+        StmtList thenBlock = block();
+        StmtList elseBlock = match(TOK_CAP) ? block() : builder.stmtList(nullptr, 0);
         
-        if (match(TOK_CAP)) {
-            elseBlock = block();
-        }
-        
-        return std::make_unique<AST::SusStmtAST>(
-            std::move(condition),
-            std::move(thenBlock),
-            std::move(elseBlock)
+        return builder.sus(
+            condition,
+            thenBlock,
+            elseBlock
         );
     }
     if (match(TOK_BRUH)) return bruhStatement();
+    if (match(TOK_SOLULU)) return soluluStatement();
+    if (match(TOK_YOINK)) return yoinkStatement();   // yoink xs[i] = v;
+    if (match(TOK_YEET)) return yeetStatement();     // yeet xs[i];
     
-    throw std::runtime_error("Expected statement");
+    // Anything else is an expression evaluated for its effect: x = 1;
+    Expr expr = expression();
+    consume(TOK_SEMICOLON, "Expected ';' after expression");
+    return builder.exprStmt(expr);
 }
 
-// Parse expressions - this handles all our mathematical and logical operations
-AST::ExprPtr Parser::expression() {
-    return equality();  // Start with equality as it has lowest precedence
+// Parse expressions - this handles all our mathematical and logical operations.
+// Operator precedence parsing driven by binaryOperators: operands and
+// pending operators go on explicit stacks, so parentheses, prefix
+// operators and assignment chains nest without recursion, and each
+// operator costs one table lookup.
+template <typename Builder>
+auto BasicParser<Builder>::expression() -> Expr {
+    return subexpression().expr;
 }
 
-// Handle equality comparisons (== and !=)
-AST::ExprPtr Parser::equality() {
-    // Start with comparison expression
-    AST::ExprPtr expr = comparison();
-    
-    // Keep chaining equality operators as long as we find them
-    while (match(TOK_EQUAL_EQUAL) || match(TOK_BANG_EQUAL)) {
-        Token op = previous();
-        AST::ExprPtr right = comparison();
-        expr = std::make_unique<AST::BinaryExprAST>(
-            op.lexeme[0],
-            std::move(expr),
-            std::move(right)
-        );
+template <typename Builder>
+auto BasicParser<Builder>::subexpression() -> Operand {
+    size_t operandBase = operands.size();
+    size_t operatorBase = operators.size();
+    size_t openParens = 0;
+
+    for (;;) {
+        // Operand position: prefix operators, '(' and assignment targets.
+        // An element read is only told apart from an element assignment
+        // after its index, so it may end up as the operand itself.
+        Operand element{Builder::none(), 0};
+        bool haveElement = false;
+        for (;;) {
+            TokenType type = peek().type;
+            if (type == TOK_MINUS || type == TOK_BANG) {
+                advance();
+                AST::UnaryOp op = type == TOK_MINUS ? AST::UnaryOp::Negate : AST::UnaryOp::Not;
+                operators.push_back({Pending::Unary, unaryPrecedence, static_cast<uint8_t>(op)});
+            } else if (type == TOK_LEFT_PAREN) {
+                advance();
+                operators.push_back({Pending::Paren, 0, 0});
+                ++openParens;
+            } else if (type == TOK_IDENTIFIER && binaryOperators[tokens.peekAhead(1).type].assign) {
+                // Only a whole (sub)expression can be assigned to
+                if (operators.size() > operatorBase && operators.back().kind != Pending::Paren &&
+                    operators.back().kind != Pending::Assign && operators.back().kind != Pending::IndexAssign) {
+                    throw std::runtime_error("Invalid assignment target.");
+                }
+                std::string_view name = lexeme(advance());
+                const OperatorInfo& info = binaryOperators[advance().type];
+                operators.push_back({Pending::Assign, 0, static_cast<uint8_t>(info.op),
+                                     info.assign == compoundAssign, name});
+            } else if (type == TOK_IDENTIFIER && tokens.peekAhead(1).type == TOK_LEFT_BRACKET) {
+                std::string_view name = lexeme(advance());
+                Operand index = subscript();
+                const OperatorInfo& info = binaryOperators[peek().type];
+                if (!info.assign) {
+                    element = {builder.index(name, index.expr), index.depth + 1};
+                    haveElement = true;
+                    break;
+                }
+                if (operators.size() > operatorBase && operators.back().kind != Pending::Paren &&
+                    operators.back().kind != Pending::Assign && operators.back().kind != Pending::IndexAssign) {
+                    throw std::runtime_error("Invalid assignment target.");
+                }
+                advance();
+                operators.push_back({Pending::IndexAssign, 0, static_cast<uint8_t>(info.op),
+                                     info.assign == compoundAssign, name, index.expr, index.depth});
+            } else {
+                break;
+            }
+            if (operators.size() - operatorBase > maxNesting) {
+                throw std::runtime_error("Expression nesting exceeds the limit of " +
+                                         std::to_string(maxNesting));
+            }
+        }
+        Operand operand = haveElement ? element : primary();
+        pushOperand(operand.expr, operand.depth);
+
+        // Operator position: ')' closes the innermost group
+        while (openParens > 0 && check(TOK_RIGHT_PAREN)) {
+            advance();
+            while (operators.back().kind != Pending::Paren) reduce();
+            operators.pop_back();
+            --openParens;
+            Operand inner = operands.back();
+            operands.pop_back();
+            pushOperand(builder.grouping(inner.expr), inner.depth + 1);
+        }
+
+        const OperatorInfo& info = binaryOperators[peek().type];
+        if (info.precedence == 0) {
+            if (info.assign) throw std::runtime_error("Invalid assignment target.");
+            break;
+        }
+        advance();
+
+        // Everything pending that binds at least as tightly is complete;
+        // '(' and assignments have precedence 0 and stop the reduction
+        while (operators.size() > operatorBase && operators.back().precedence >= info.precedence) {
+            reduce();
+        }
+        operators.push_back({Pending::Binary, info.precedence, static_cast<uint8_t>(info.op)});
+    }
+
+    if (openParens > 0) {
+        throw std::runtime_error("Expect ')' after expression.");
+    }
+    while (operators.size() > operatorBase) reduce();
+
+    Operand result = operands.back();
+    operands.resize(operandBase);
+    return result;
+}
+
+// Pushes a finished subtree, enforcing the nesting limit
+template <typename Builder>
+void BasicParser<Builder>::pushOperand(Expr expr, uint32_t depth) {
+    if (depth > maxNesting) {
+        throw std::runtime_error("Expression nesting exceeds the limit of " +
+                                 std::to_string(maxNesting));
+    }
+    operands.push_back({expr, depth});
+}
+
+// Applies the operator on top of the stack to its operands
+template <typename Builder>
+void BasicParser<Builder>::reduce() {
+    PendingOperator pending = operators.back();
+    operators.pop_back();
+    Operand right = operands.back();
+    operands.pop_back();
+
+    switch (pending.kind) {
+        case Pending::Unary:
+            pushOperand(builder.unary(static_cast<AST::UnaryOp>(pending.op), right.expr),
+                        right.depth + 1);
+            break;
+        case Pending::Binary: {
+            Operand left = operands.back();
+            operands.pop_back();
+            pushOperand(builder.binary(static_cast<AST::BinaryOp>(pending.op), left.expr, right.expr),
+                        std::max(left.depth, right.depth) + 1);
+            break;
+        }
+        case Pending::Assign:
+            // `x op= v` is sugar for `x = x op v`
+            if (pending.compound) {
+                Expr current = builder.variable(pending.name);
+                right.expr = builder.binary(static_cast<AST::BinaryOp>(pending.op), current, right.expr);
+                ++right.depth;
+            }
+            pushOperand(builder.assign(pending.name, right.expr), right.depth + 1);
+            break;
+        case Pending::IndexAssign:
+            // `xs[i] op= v` is sugar for `xs[i] = xs[i] op v`, so the index
+            // is evaluated twice
+            if (pending.compound) {
+                Expr current = builder.index(pending.name, pending.index);
+                right.expr = builder.binary(static_cast<AST::BinaryOp>(pending.op), current, right.expr);
+                right.depth = std::max(right.depth, pending.indexDepth + 1) + 1;
+            }
+            pushOperand(builder.indexAssign(pending.name, pending.index, right.expr),
+                        std::max(right.depth, pending.indexDepth) + 1);
+            break;
+        case Pending::Paren:
+            break;
     }
-    
-    return expr;
 }
 
 // Parse a block of code surrounded by { }
-AST::StmtList Parser::block() {
+template <typename Builder>
+auto BasicParser<Builder>::block() -> StmtList {
     // Make sure we start with an opening brace
     consume(TOK_LEFT_BRACE, "Expected '{' at start of block");
-    AST::StmtList statements;
+    if (++blockDepth > maxNesting) {
+        throw std::runtime_error("Block nesting exceeds the limit of " + std::to_string(maxNesting));
+    }
+    size_t mark = stmtScratch.size();
     
     // Keep parsing statements until we hit the closing brace
     while (!check(TOK_RIGHT_BRACE) && !isAtEnd()) {
-        statements.push_back(statement());
+        Stmt stmt = statement();
+        stmtScratch.push_back(stmt);
     }
     
     // Make sure we end with a closing brace
     consume(TOK_RIGHT_BRACE, "Expected '}' after block");
-    return statements;
+    --blockDepth;
+    return finishList(stmtScratch, mark, &Builder::stmtList);
 }
 
 // Handle our print statement 'yap'
-AST::StmtPtr Parser::yapStatement() {
+template <typename Builder>
+auto BasicParser<Builder>::yapStatement() -> Stmt {
     // yap takes arguments in parentheses
     consume(TOK_LEFT_PAREN, "Expected '(' after 'yap'");
-    std::vector<AST::ExprPtr> args;
+    size_t mark = exprScratch.size();
     
     // Parse comma-separated arguments
     if (!check(TOK_RIGHT_PAREN)) {
         do {
-            args.push_back(expression());
+            Expr arg = expression();
+            exprScratch.push_back(arg);
         } while (match(TOK_COMMA));
     }
     
     // Clean up with closing parenthesis and semicolon
     consume(TOK_RIGHT_PAREN, "Expected ')' after arguments");
     consume(TOK_SEMICOLON, "Expected ';' after yap statement");
+    ExprList args = finishList(exprScratch, mark, &Builder::exprList);
     
-    return std::make_unique<AST::YapStmtAST>(std::move(args));
+    return builder.yap(args);
 }
 
 // Handle our for loop 'bet' statement
-AST::StmtPtr Parser::betStatement() {
+template <typename Builder>
+auto BasicParser<Builder>::betStatement(bool parallel) -> Stmt {
     // bet loops look like: bet (init, condition, increment) { body }
     consume(TOK_LEFT_PAREN, "Expected '(' after 'bet'");
     
     // Parse initialization part
-    AST::StmtPtr init;
+    Stmt init;
     if (match(TOK_POOKIE)) {
         // Handle new variable declaration as initializer
         Token name = consume(TOK_IDENTIFIER, "Expected variable name");
         consume(TOK_EQUAL, "Expected '=' after variable name");
-        AST::ExprPtr initializer = expression();
-        init = std::make_unique<AST::VarDeclStmtAST>(name.lexeme, std::move(initializer));
+        Expr initializer = expression();
+        init = builder.varDecl(lexeme(name), initializer);
     } else {
-        // Handle assignment as initializer
-        Token name = consume(TOK_IDENTIFIER, "Expected variable name");
-        consume(TOK_EQUAL, "Expected '=' after variable name");
-        AST::ExprPtr value = expression();
-        init = std::make_unique<AST::ExprStmtAST>(
-            std::make_unique<AST::AssignExprAST>(name.lexeme, std::move(value))
-        );
+        // Handle an expression (usually an assignment) as initializer
+        init = builder.exprStmt(expression());
     }
     consume(TOK_COMMA, "Expected ',' after initialization");
     
     // Parse condition
-    AST::ExprPtr condition = expression();
+    Expr condition = expression();
     consume(TOK_COMMA, "Expected ',' after condition");
     
-    // Parse increment
-    Token name = consume(TOK_IDENTIFIER, "Expected variable name");
-    consume(TOK_EQUAL, "Expected '=' after variable name");
-    AST::ExprPtr value = expression();
-    AST::StmtPtr increment = std::make_unique<AST::ExprStmtAST>(
-        std::make_unique<AST::AssignExprAST>(name.lexeme, std::move(value))
-    );
+    // Parse increment, e.g. i = i + 1 or i += 1
+    Stmt increment = builder.exprStmt(expression());
     
     consume(TOK_RIGHT_PAREN, "Expected ')' after for clauses");
     
     // Parse body
-    AST::StmtList body = block();
+    StmtList body = block();
     
-    return std::make_unique<AST::BetStmtAST>(
-        std::move(init),
-        std::move(condition),
-        std::move(increment),
-        std::move(body)
+    return builder.bet(
+        init,
+        condition,
+        increment,
+        body,
+        parallel
     );
 }
 
 // Handle function declarations with 'bruh'
-AST::StmtPtr Parser::bruhStatement() {
+template <typename Builder>
+auto BasicParser<Builder>::bruhStatement() -> Stmt {
     // Parse function: bruh name(params) { body }
     Token name = consume(TOK_IDENTIFIER, "Expected function name after 'bruh'");
     consume(TOK_LEFT_PAREN, "Expected '(' after function name");
     
-    std::vector<std::string> parameters;
+    size_t mark = nameScratch.size();
     if (!check(TOK_RIGHT_PAREN)) {
         do {
-            Token param = consume(TOK_IDENTIFIER, "Expected parameter name");
-            parameters.push_back(param.lexeme);
+            // Parameters may be spelled `pookie name`, like declarations
+            match(TOK_POOKIE);
+            const Token& param = consume(TOK_IDENTIFIER, "Expected parameter name");
+            nameScratch.push_back(lexeme(param));
         } while (match(TOK_COMMA));
     }
     consume(TOK_RIGHT_PAREN, "Expected ')' after parameters");
+    NameList parameters = finishList(nameScratch, mark, &Builder::nameList);
     
     // Parse function body
-    AST::StmtList body = block();
+    StmtList body = block();
     
-    return std::make_unique<AST::BruhAST>(
-        name.lexeme,
-        std::move(parameters),
-        std::move(body)
+    return builder.bruh(
+        lexeme(name),
+        parameters,
+        body
     );
 }
 
-// Handle comparison expressions like greater than and less than
-AST::ExprPtr Parser::comparison() {
-    AST::ExprPtr expr = term();
-    
-    while (match({TOK_GREATER, TOK_GREATER_EQUAL, TOK_LESS, TOK_LESS_EQUAL})) {
-        Token op = previous();
-        AST::ExprPtr right = term();
-        expr = std::make_unique<AST::BinaryExprAST>(
-            op.lexeme[0],
-            std::move(expr),
-            std::move(right)
-        );
+// Handle return statements: solulu value; or solulu;
+template <typename Builder>
+auto BasicParser<Builder>::soluluStatement() -> Stmt {
+    Expr value = Builder::none();
+    if (!check(TOK_SEMICOLON)) {
+        value = expression();
     }
-    
-    return expr;
+    consume(TOK_SEMICOLON, "Expected ';' after solulu");
+    return builder.solulu(value);
 }
 
-// Handle term expressions like addition and subtraction
-AST::ExprPtr Parser::term() {
-    AST::ExprPtr expr = factor();
+// Handle class declarations with 'sigma'
+template <typename Builder>
+auto BasicParser<Builder>::sigmaDeclaration() -> Stmt {
+    // Parse class: sigma Name { pookie fields and bruh methods }
+    Token name = consume(TOK_IDENTIFIER, "Expected class name after 'sigma'");
+    consume(TOK_LEFT_BRACE, "Expected '{' after class name");
 
-    while (match(TOK_PLUS) || match(TOK_MINUS)) {
-        Token op = previous();
-        AST::ExprPtr right = factor();
-        expr = std::make_unique<AST::BinaryExprAST>(
-            op.lexeme[0],
-            std::move(expr),
-            std::move(right)
-        );
+    size_t mark = stmtScratch.size();
+    while (!check(TOK_RIGHT_BRACE) && !isAtEnd()) {
+        if (!check(TOK_POOKIE) && !check(TOK_BRUH)) {
+            throw std::runtime_error("Expected 'pookie' or 'bruh' in sigma body");
+        }
+        Stmt member = statement();
+        stmtScratch.push_back(member);
     }
+    consume(TOK_RIGHT_BRACE, "Expected '}' after sigma body");
+    StmtList members = finishList(stmtScratch, mark, &Builder::stmtList);
 
-    return expr;
+    return builder.sigma(lexeme(name), members);
 }
 
-// Add the match method that takes an initializer list
-bool Parser::match(std::initializer_list<TokenType> types) {
-    for (TokenType type : types) {
-        if (check(type)) {
-            advance();
-            return true;
+// Handle primary expressions like numbers, identifiers, and strings
+template <typename Builder>
+auto BasicParser<Builder>::primary() -> Operand {
+    const Token& token = advance();
+    switch (token.type) {
+        case TOK_NUMBER_LITERAL:
+            // The lexer already decoded the literal
+            if (token.isFloat) {
+                return {builder.floatLiteral(token.value.floatValue), 1};
+            }
+            return {builder.intLiteral(token.value.intValue), 1};
+        case TOK_IDENTIFIER: {
+            std::string_view name = lexeme(token);
+            if (check(TOK_LEFT_PAREN)) {
+                return call(name);
+            }
+            if (match(TOK_DOT)) {
+                if (lexeme(consume(TOK_IDENTIFIER, "Expected property name after '.'")) != "length") {
+                    throw std::runtime_error("Unknown squad property: " + std::string(lexeme(previous())));
+                }
+                return {builder.length(name), 1};
+            }
+            return {builder.variable(name), 1};
         }
+        case TOK_STRING_LITERAL:
+            return {builder.string(lexeme(token)), 1};
+        case TOK_LEFT_BRACKET:
+            return squadLiteral();
+        case TOK_SQUAD:
+            // squad(n) is a squad of n zeroes, built like a call
+            if (!check(TOK_LEFT_PAREN)) {
+                throw std::runtime_error("Expected '(' after 'squad'");
+            }
+            return call("squad");
+        default:
+            throw std::runtime_error("Expected expression.");
     }
-    return false;
 }
 
-// Handle factor expressions like multiplication and division
-AST::ExprPtr Parser::factor() {
-    AST::ExprPtr expr = unary();
-
-    while (match(TOK_STAR) || match(TOK_SLASH)) {
-        Token op = previous();
-        AST::ExprPtr right = unary();
-        expr = std::make_unique<AST::BinaryExprAST>(
-            op.lexeme[0],
-            std::move(expr),
-            std::move(right)
-        );
+// Parse the argument list of a call: name(arg, ...). Arguments are full
+// expressions parsed recursively, so call nesting also counts against the
+// limit before the arguments' heights are known.
+template <typename Builder>
+auto BasicParser<Builder>::call(std::string_view callee) -> Operand {
+    consume(TOK_LEFT_PAREN, "Expected '(' after function name");
+    if (++callDepth > maxNesting) {
+        throw std::runtime_error("Call nesting exceeds the limit of " + std::to_string(maxNesting));
     }
-
-    return expr;
+    size_t mark = exprScratch.size();
+    uint32_t depth = 0;
+    if (!check(TOK_RIGHT_PAREN)) {
+        do {
+            Operand arg = subexpression();
+            depth = std::max(depth, arg.depth);
+            exprScratch.push_back(arg.expr);
+        } while (match(TOK_COMMA));
+    }
+    consume(TOK_RIGHT_PAREN, "Expected ')' after arguments");
+    --callDepth;
+    return {builder.call(callee, finishList(exprScratch, mark, &Builder::exprList)), depth + 1};
 }
 
-AST::ExprPtr Parser::unary() {
-    if (match(TOK_MINUS) || match(TOK_BANG)) {
-        Token op = previous();
-        AST::ExprPtr right = unary();
-        return std::make_unique<AST::UnaryExprAST>(op.lexeme[0], std::move(right));
+// Parse the index of a squad element: [index]. Like call arguments, the
+// index is a full expression parsed recursively.
+template <typename Builder>
+auto BasicParser<Builder>::subscript() -> Operand {
+    consume(TOK_LEFT_BRACKET, "Expected '[' after squad name");
+    if (++callDepth > maxNesting) {
+        throw std::runtime_error("Index nesting exceeds the limit of " + std::to_string(maxNesting));
     }
-
-    return primary();
+    Operand index = subexpression();
+    consume(TOK_RIGHT_BRACKET, "Expected ']' after index");
+    --callDepth;
+    return index;
 }
 
-// Handle primary expressions like numbers, identifiers, and strings
-AST::ExprPtr Parser::primary() {
-    if (match(TOK_NUMBER_LITERAL)) {
-        Token numToken = previous();
-        try {
-            if (numToken.isFloat) {
-                double value = std::stod(numToken.lexeme);
-                return std::make_unique<AST::NumberExprAST>(value);
-            } else {
-                int value = std::stoi(numToken.lexeme);
-                return std::make_unique<AST::NumberExprAST>(value);
-            }
-        } catch (const std::exception& e) {
-            std::cerr << "Error parsing number '" << numToken.lexeme << "': " << e.what() << std::endl;
-            throw;
-        }
+// Parse a squad literal after its '[': [a, b, c] or []
+template <typename Builder>
+auto BasicParser<Builder>::squadLiteral() -> Operand {
+    if (++callDepth > maxNesting) {
+        throw std::runtime_error("Squad nesting exceeds the limit of " + std::to_string(maxNesting));
     }
-    
-    if (match(TOK_IDENTIFIER)) {
-        return std::make_unique<AST::VariableExprAST>(previous().lexeme);
-    }
-
-    if (match(TOK_STRING_LITERAL)) {
-        return std::make_unique<AST::StringExprAST>(previous().lexeme);
+    size_t mark = exprScratch.size();
+    uint32_t depth = 0;
+    if (!check(TOK_RIGHT_BRACKET)) {
+        do {
+            Operand element = subexpression();
+            depth = std::max(depth, element.depth);
+            exprScratch.push_back(element.expr);
+        } while (match(TOK_COMMA));
     }
+    consume(TOK_RIGHT_BRACKET, "Expected ']' after squad elements");
+    --callDepth;
+    return {builder.squad(finishList(exprScratch, mark, &Builder::exprList)), depth + 1};
+}
 
-    if (match(TOK_LEFT_PAREN)) {
-        AST::ExprPtr expr = expression();
-        consume(TOK_RIGHT_PAREN, "Expect ')' after expression.");
-        return std::make_unique<AST::GroupingExprAST>(std::move(expr));
-    }
+// Handle insertion: yoink name[index] = value;
+template <typename Builder>
+auto BasicParser<Builder>::yoinkStatement() -> Stmt {
+    std::string_view name = lexeme(consume(TOK_IDENTIFIER, "Expected squad name after 'yoink'"));
+    Expr index = subscript().expr;
+    consume(TOK_EQUAL, "Expected '=' after index");
+    Expr value = expression();
+    consume(TOK_SEMICOLON, "Expected ';' after yoink");
+    return builder.yoink(name, index, value);
+}
 
-    throw std::runtime_error("Expected expression.");
+// Handle removal: yeet name[index];
+template <typename Builder>
+auto BasicParser<Builder>::yeetStatement() -> Stmt {
+    std::string_view name = lexeme(consume(TOK_IDENTIFIER, "Expected squad name after 'yeet'"));
+    Expr index = subscript().expr;
+    consume(TOK_SEMICOLON, "Expected ';' after yeet");
+    return builder.yeet(name, index);
 }
 
 // Handle our if-else statement 'fr'
-AST::StmtPtr Parser::frStatement() {
+template <typename Builder>
+auto BasicParser<Builder>::frStatement() -> Stmt {
     consume(TOK_LEFT_PAREN, "Expected '(' after 'fr'");
-    AST::ExprPtr condition = expression();
+    Expr condition = expression();
     consume(TOK_RIGHT_PAREN, "Expected ')' after condition");
     
     // Parse the main if block
-    AST::StmtList thenBlock = block();
-    AST::StmtList elseBlock;
-    
+    StmtList thenBlock = block();
+
     // Check for else (cap)
-    if (match(TOK_CAP)) {
-        elseBlock = block();
-    }
+    StmtList elseBlock = match(TOK_CAP) ? block() : builder.stmtList(nullptr, 0);
     
-    return std::make_unique<AST::SusStmtAST>(
-        std::move(condition),
-        std::move(thenBlock),
-        std::move(elseBlock)
+    return builder.sus(
+        condition,
+        thenBlock,
+        elseBlock
     );
-}
\ No newline at end of file
+}
+
+template class BasicParser<AST::TreeBuilder>;
+template class BasicParser<AST::FlatBuilder>;
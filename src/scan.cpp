@@ -0,0 +1,270 @@
+#include "scan.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define SCAN_X86 1
+#endif
+
+namespace scan {
+namespace {
+
+inline bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+inline bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+inline bool isIdentifierChar(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || isDigit(c) || c == '_';
+}
+
+// Scalar reference kernels
+
+const char* skipWhitespaceScalar(const char* p, const char* end, size_t* newlines) {
+    size_t lines = 0;
+    for (; p < end && isSpace(*p); ++p) {
+        lines += (*p == '\n');
+    }
+    *newlines += lines;
+    return p;
+}
+
+const char* identifierEndScalar(const char* p, const char* end) {
+    while (p < end && isIdentifierChar(*p)) ++p;
+    return p;
+}
+
+const char* digitsEndScalar(const char* p, const char* end) {
+    while (p < end && isDigit(*p)) ++p;
+    return p;
+}
+
+const char* findQuoteScalar(const char* p, const char* end, size_t* newlines) {
+    size_t lines = 0;
+    for (; p < end && *p != '"'; ++p) {
+        lines += (*p == '\n');
+    }
+    *newlines += lines;
+    return p;
+}
+
+#ifdef SCAN_X86
+
+// Bias that maps the byte range [lo, lo + n) onto [-128, -128 + n), so an
+// unsigned range check becomes a single signed compare
+inline char rangeBias(char lo) {
+    return static_cast<char>(static_cast<unsigned char>(0x80 - static_cast<unsigned char>(lo)));
+}
+
+inline char rangeLimit(int count) {
+    return static_cast<char>(-128 + count);
+}
+
+// SSE2 kernels (part of the x86-64 baseline, no target attribute needed)
+
+inline __m128i whitespaceMask16(__m128i v, __m128i newlineMask) {
+    __m128i spaces = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                                  _mm_cmpeq_epi8(v, _mm_set1_epi8('\t')));
+    __m128i returns = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\r')), newlineMask);
+    return _mm_or_si128(spaces, returns);
+}
+
+inline __m128i inRange16(__m128i v, char lo, int count) {
+    __m128i biased = _mm_add_epi8(v, _mm_set1_epi8(rangeBias(lo)));
+    return _mm_cmplt_epi8(biased, _mm_set1_epi8(rangeLimit(count)));
+}
+
+inline __m128i digitMask16(__m128i v) {
+    return inRange16(v, '0', 10);
+}
+
+inline __m128i identifierMask16(__m128i v) {
+    __m128i letters = inRange16(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 26);
+    __m128i underscore = _mm_cmpeq_epi8(v, _mm_set1_epi8('_'));
+    return _mm_or_si128(_mm_or_si128(letters, digitMask16(v)), underscore);
+}
+
+const char* skipWhitespaceSSE2(const char* p, const char* end, size_t* newlines) {
+    if (p < end && !isSpace(*p)) return p;
+    size_t lines = 0;
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i newlineMask = _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'));
+        unsigned stop = ~static_cast<unsigned>(_mm_movemask_epi8(whitespaceMask16(v, newlineMask))) & 0xFFFFu;
+        unsigned newlineBits = static_cast<unsigned>(_mm_movemask_epi8(newlineMask));
+        if (stop) {
+            unsigned index = static_cast<unsigned>(__builtin_ctz(stop));
+            lines += static_cast<size_t>(__builtin_popcount(newlineBits & ((1u << index) - 1)));
+            *newlines += lines;
+            return p + index;
+        }
+        lines += static_cast<size_t>(__builtin_popcount(newlineBits));
+        p += 16;
+    }
+    *newlines += lines;
+    return skipWhitespaceScalar(p, end, newlines);
+}
+
+const char* identifierEndSSE2(const char* p, const char* end) {
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        unsigned stop = ~static_cast<unsigned>(_mm_movemask_epi8(identifierMask16(v))) & 0xFFFFu;
+        if (stop) return p + __builtin_ctz(stop);
+        p += 16;
+    }
+    return identifierEndScalar(p, end);
+}
+
+const char* digitsEndSSE2(const char* p, const char* end) {
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        unsigned stop = ~static_cast<unsigned>(_mm_movemask_epi8(digitMask16(v))) & 0xFFFFu;
+        if (stop) return p + __builtin_ctz(stop);
+        p += 16;
+    }
+    return digitsEndScalar(p, end);
+}
+
+const char* findQuoteSSE2(const char* p, const char* end, size_t* newlines) {
+    size_t lines = 0;
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        unsigned quoteBits = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('"'))));
+        unsigned newlineBits = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))));
+        if (quoteBits) {
+            unsigned index = static_cast<unsigned>(__builtin_ctz(quoteBits));
+            lines += static_cast<size_t>(__builtin_popcount(newlineBits & ((1u << index) - 1)));
+            *newlines += lines;
+            return p + index;
+        }
+        lines += static_cast<size_t>(__builtin_popcount(newlineBits));
+        p += 16;
+    }
+    *newlines += lines;
+    return findQuoteScalar(p, end, newlines);
+}
+
+// AVX2 kernels. These handle 32-byte blocks and leave the tail to SSE2.
+
+#define SCAN_AVX2 __attribute__((target("avx2")))
+
+SCAN_AVX2 inline __m256i inRange32(__m256i v, char lo, int count) {
+    __m256i biased = _mm256_add_epi8(v, _mm256_set1_epi8(rangeBias(lo)));
+    return _mm256_cmpgt_epi8(_mm256_set1_epi8(rangeLimit(count)), biased);
+}
+
+SCAN_AVX2 inline __m256i digitMask32(__m256i v) {
+    return inRange32(v, '0', 10);
+}
+
+SCAN_AVX2 inline __m256i identifierMask32(__m256i v) {
+    __m256i letters = inRange32(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), 'a', 26);
+    __m256i underscore = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_'));
+    return _mm256_or_si256(_mm256_or_si256(letters, digitMask32(v)), underscore);
+}
+
+SCAN_AVX2 const char* skipWhitespaceAVX2(const char* p, const char* end, size_t* newlines) {
+    if (p < end && !isSpace(*p)) return p;
+    size_t lines = 0;
+    while (end - p >= 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i newlineMask = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'));
+        __m256i spaces = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                                         _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t')));
+        __m256i returns = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')), newlineMask);
+        unsigned stop = ~static_cast<unsigned>(_mm256_movemask_epi8(_mm256_or_si256(spaces, returns)));
+        unsigned newlineBits = static_cast<unsigned>(_mm256_movemask_epi8(newlineMask));
+        if (stop) {
+            unsigned index = static_cast<unsigned>(__builtin_ctz(stop));
+            unsigned below = index == 0 ? 0u : newlineBits & (~0u >> (32 - index));
+            lines += static_cast<size_t>(__builtin_popcount(below));
+            *newlines += lines;
+            return p + index;
+        }
+        lines += static_cast<size_t>(__builtin_popcount(newlineBits));
+        p += 32;
+    }
+    *newlines += lines;
+    return skipWhitespaceSSE2(p, end, newlines);
+}
+
+SCAN_AVX2 const char* identifierEndAVX2(const char* p, const char* end) {
+    while (end - p >= 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        unsigned stop = ~static_cast<unsigned>(_mm256_movemask_epi8(identifierMask32(v)));
+        if (stop) return p + __builtin_ctz(stop);
+        p += 32;
+    }
+    return identifierEndSSE2(p, end);
+}
+
+SCAN_AVX2 const char* digitsEndAVX2(const char* p, const char* end) {
+    while (end - p >= 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        unsigned stop = ~static_cast<unsigned>(_mm256_movemask_epi8(digitMask32(v)));
+        if (stop) return p + __builtin_ctz(stop);
+        p += 32;
+    }
+    return digitsEndSSE2(p, end);
+}
+
+SCAN_AVX2 const char* findQuoteAVX2(const char* p, const char* end, size_t* newlines) {
+    size_t lines = 0;
+    while (end - p >= 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        unsigned quoteBits = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"'))));
+        unsigned newlineBits = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))));
+        if (quoteBits) {
+            unsigned index = static_cast<unsigned>(__builtin_ctz(quoteBits));
+            unsigned below = index == 0 ? 0u : newlineBits & (~0u >> (32 - index));
+            lines += static_cast<size_t>(__builtin_popcount(below));
+            *newlines += lines;
+            return p + index;
+        }
+        lines += static_cast<size_t>(__builtin_popcount(newlineBits));
+        p += 32;
+    }
+    *newlines += lines;
+    return findQuoteSSE2(p, end, newlines);
+}
+
+#undef SCAN_AVX2
+
+const Kernels sse2Kernels = {
+    "sse2", skipWhitespaceSSE2, identifierEndSSE2, digitsEndSSE2, findQuoteSSE2
+};
+
+const Kernels avx2Kernels = {
+    "avx2", skipWhitespaceAVX2, identifierEndAVX2, digitsEndAVX2, findQuoteAVX2
+};
+
+#endif // SCAN_X86
+
+const Kernels scalar = {
+    "scalar", skipWhitespaceScalar, identifierEndScalar, digitsEndScalar, findQuoteScalar
+};
+
+const Kernels& selectKernels() {
+#ifdef SCAN_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return avx2Kernels;
+    return sse2Kernels;
+#else
+    return scalar;
+#endif
+}
+
+} // namespace
+
+const Kernels& kernels() {
+    static const Kernels& selected = selectKernels();
+    return selected;
+}
+
+const Kernels& scalarKernels() {
+    return scalar;
+}
+
+}
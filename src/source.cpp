@@ -0,0 +1,60 @@
+#include "source.h"
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SOURCE_USE_MMAP 1
+#endif
+
+SourceFile::SourceFile(const std::string& path) {
+#ifdef SOURCE_USE_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open file: " + path);
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Could not stat file: " + path);
+    }
+
+    // Empty files cannot be mapped; leave the view empty
+    if (st.st_size > 0) {
+        void* addr = ::mmap(nullptr, static_cast<size_t>(st.st_size),
+                            PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr != MAP_FAILED) {
+            // The lexer reads front to back exactly once
+            ::madvise(addr, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+            data = static_cast<const char*>(addr);
+            length = static_cast<size_t>(st.st_size);
+            mapped = true;
+        }
+    }
+    ::close(fd);
+    if (mapped || st.st_size == 0) return;
+#endif
+
+    // Fall back to reading the whole file into memory
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Could not open file: " + path);
+    }
+    fallback.assign(std::istreambuf_iterator<char>(file),
+                    std::istreambuf_iterator<char>());
+    data = fallback.data();
+    length = fallback.size();
+}
+
+SourceFile::~SourceFile() {
+#ifdef SOURCE_USE_MMAP
+    if (mapped) {
+        ::munmap(const_cast<char*>(data), length);
+    }
+#endif
+}
@@ -0,0 +1,65 @@
+#include "squad.h"
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace {
+    [[noreturn]] void outOfBounds(int64_t index, int64_t length) {
+        throw std::runtime_error("Squad index " + std::to_string(index) + " out of bounds for length " +
+                                 std::to_string(length));
+    }
+
+    // Fails with the message compiled code prints when it runs out
+    void* allocate(void* block, size_t count, size_t size) {
+        void* result = nullptr;
+        if (count <= SIZE_MAX / size) {
+            result = block ? std::realloc(block, count * size) : std::calloc(count, size);
+        }
+        if (!result) {
+            throw std::runtime_error("Out of memory");
+        }
+        return result;
+    }
+}
+
+Squad* newSquad(int64_t length) {
+    length = length < 0 ? 0 : length;
+    auto squad = static_cast<Squad*>(allocate(nullptr, 1, sizeof(Squad)));
+    squad->length = length;
+    squad->capacity = length;
+    squad->data = length > 0 ? static_cast<uint64_t*>(allocate(nullptr, length, sizeof(uint64_t))) : nullptr;
+    return squad;
+}
+
+uint64_t& squadElement(Squad* squad, int64_t index) {
+    // One unsigned comparison also rejects negative indices
+    if (uint64_t(index) >= uint64_t(squad->length)) {
+        outOfBounds(index, squad->length);
+    }
+    return squad->data[index];
+}
+
+void squadInsert(Squad* squad, int64_t index, uint64_t value) {
+    if (uint64_t(index) > uint64_t(squad->length)) {
+        outOfBounds(index, squad->length);
+    }
+    if (squad->length == squad->capacity) {
+        // Same growth as compiled code: at least 4, then doubling
+        int64_t capacity = squad->capacity < 4 ? 4 : squad->capacity * 2;
+        squad->data = static_cast<uint64_t*>(allocate(squad->data, capacity, sizeof(uint64_t)));
+        squad->capacity = capacity;
+    }
+    std::memmove(squad->data + index + 1, squad->data + index, (squad->length - index) * sizeof(uint64_t));
+    squad->data[index] = value;
+    ++squad->length;
+}
+
+void squadRemove(Squad* squad, int64_t index) {
+    if (uint64_t(index) >= uint64_t(squad->length)) {
+        outOfBounds(index, squad->length);
+    }
+    std::memmove(squad->data + index, squad->data + index + 1, (squad->length - index - 1) * sizeof(uint64_t));
+    --squad->length;
+}
@@ -0,0 +1,89 @@
+#include "thread_pool.h"
+
+ThreadPool::ThreadPool(unsigned threads) {
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+    }
+    // The calling thread also works, so spawn one fewer
+    for (unsigned i = 1; i < threads; ++i) {
+        workers.emplace_back([this] { workerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::run(size_t count, const std::function<void(size_t)>& task) {
+    if (count == 0) return;
+
+    if (workers.empty() || count == 1) {
+        for (size_t i = 0; i < count; ++i) task(i);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &task;
+        jobCount = count;
+        nextIndex.store(0, std::memory_order_relaxed);
+        error = nullptr;
+        ++generation;
+        busyWorkers = static_cast<unsigned>(workers.size());
+    }
+    wake.notify_all();
+
+    drain(task, count);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this] { return busyWorkers == 0; });
+    job = nullptr;
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+// Claims and runs task indices until the batch is exhausted
+void ThreadPool::drain(const std::function<void(size_t)>& task, size_t count) {
+    for (;;) {
+        size_t index = nextIndex.fetch_add(1, std::memory_order_relaxed);
+        if (index >= count) return;
+        try {
+            task(index);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!error) error = std::current_exception();
+        }
+    }
+}
+
+void ThreadPool::workerLoop() {
+    size_t seenGeneration = 0;
+    for (;;) {
+        const std::function<void(size_t)>* task;
+        size_t count;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seenGeneration; });
+            if (stopping) return;
+            seenGeneration = generation;
+            task = job;
+            count = jobCount;
+        }
+
+        drain(*task, count);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            --busyWorkers;
+        }
+        idle.notify_one();
+    }
+}
@@ -0,0 +1,122 @@
+#include "token_stream.h"
+#include <vector>
+
+// Runs a Lexer on its own thread and hands tokens over through a bounded
+// single-producer/single-consumer ring. Both sides move tokens in batches
+// so the atomics are touched once per batch, not once per token.
+class TokenStream::Producer {
+public:
+    static constexpr size_t capacity = 1 << 14;  // Power of two
+    static constexpr size_t batchSize = 256;
+
+    explicit Producer(Lexer& lexer) : ring(capacity), thread([this, &lexer] { run(lexer); }) {}
+
+    ~Producer() {
+        stopping.store(true, std::memory_order_relaxed);
+        thread.join();
+    }
+
+    Token pop() {
+        if (readIndex == readLimit) {
+            // Wait for the producer to publish more tokens
+            while ((readLimit = tail.load(std::memory_order_acquire)) == readIndex) {
+                std::this_thread::yield();
+            }
+        }
+        Token token = ring[readIndex & (capacity - 1)];
+        ++readIndex;
+        // Hand consumed slots back a batch at a time
+        if ((readIndex & (batchSize - 1)) == 0 || readIndex == readLimit) {
+            head.store(readIndex, std::memory_order_release);
+        }
+        return token;
+    }
+
+private:
+    std::vector<Token> ring;
+    std::atomic<size_t> head{0};   // Next slot the consumer will read
+    std::atomic<size_t> tail{0};   // Next slot the producer will write
+    std::atomic<bool> stopping{false};
+    size_t readIndex = 0;          // Consumer-private
+    size_t readLimit = 0;          // Consumer-private cache of tail
+    std::thread thread;
+
+    void run(Lexer& lexer) {
+        size_t writeIndex = 0;
+        bool done = false;
+        while (!done && !stopping.load(std::memory_order_relaxed)) {
+            // Wait for room for a full batch
+            while (writeIndex - head.load(std::memory_order_acquire) > capacity - batchSize) {
+                if (stopping.load(std::memory_order_relaxed)) return;
+                std::this_thread::yield();
+            }
+            for (size_t i = 0; i < batchSize && !done; ++i) {
+                Token token = lexer.nextToken();
+                ring[writeIndex & (capacity - 1)] = token;
+                ++writeIndex;
+                done = token.type == TOK_EOF;
+            }
+            tail.store(writeIndex, std::memory_order_release);
+        }
+    }
+};
+
+TokenStream::TokenStream(Lexer& lexer, bool threaded)
+    : src(lexer.getSource()), lexer(&lexer) {
+    if (threaded) {
+        producer = std::make_unique<Producer>(lexer);
+    }
+    window.fill({TOK_EOF, 0, 0, false});
+    fill(1);
+}
+
+TokenStream::TokenStream(const TokenBuffer& buffer)
+    : TokenStream(buffer, 0, buffer.size()) {}
+
+TokenStream::TokenStream(const TokenBuffer& buffer, size_t begin, size_t end)
+    : src(buffer.source()), buffer(&buffer), bufferNext(begin), bufferEnd(end) {
+    window.fill({TOK_EOF, 0, 0, false});
+    fill(1);
+}
+
+TokenStream::~TokenStream() = default;
+
+// Pulls the next token from whichever source backs this stream
+Token TokenStream::pull() {
+    // Keep returning the final TOK_EOF once the source is drained
+    if (exhausted) return window[(filled - 1) & (windowSize - 1)];
+
+    Token token;
+    if (producer) {
+        token = producer->pop();
+    } else if (lexer) {
+        token = lexer->nextToken();
+    } else if (bufferNext < bufferEnd) {
+        token = (*buffer)[bufferNext++];
+    } else {
+        // End of a sub-range: report EOF where the next token would start
+        uint32_t offset = bufferNext < buffer->size() ? (*buffer)[bufferNext].offset
+                                                      : static_cast<uint32_t>(src.size());
+        token = {TOK_EOF, offset, 0, false};
+    }
+    exhausted = token.type == TOK_EOF;
+    return token;
+}
+
+// Makes sure `count` tokens past the last consumed one are in the window
+void TokenStream::fill(size_t count) {
+    while (filled < consumed + count) {
+        window[filled & (windowSize - 1)] = pull();
+        ++filled;
+    }
+}
+
+const Token& TokenStream::peekAhead(size_t ahead) {
+    fill(ahead + 1);
+    return window[(consumed + ahead) & (windowSize - 1)];
+}
+
+void TokenStream::advance() {
+    ++consumed;
+    fill(1);
+}
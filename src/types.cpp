@@ -0,0 +1,301 @@
+#include "types.h"
+#include "ast_visitor.h"
+
+namespace {
+    bool isNumber(ValueType type) {
+        return type == ValueType::Bool || type == ValueType::Int || type == ValueType::Double;
+    }
+
+    // Types only ever grow, so passing over the program until nothing
+    // changes terminates, after a few passes in practice
+    class Inference : public AST::Visitor<Inference, ValueType, void> {
+    public:
+        explicit Inference(ProgramTypes& types) : types(types) {}
+
+        void run(AST::ProgramAST* program) {
+            for (AST::StmtAST* declaration : program->getDeclarations()) {
+                if (auto bruh = AST::dyn_cast<AST::BruhAST>(declaration)) {
+                    auto [it, inserted] = types.functions.try_emplace(bruh->getName());
+                    if (inserted) {
+                        bruhs.emplace(bruh->getName(), bruh);
+                        for (std::string_view param : bruh->getParams()) {
+                            it->second.variables.try_emplace(param, ValueType::Unknown);
+                        }
+                    }
+                }
+            }
+
+            do {
+                changed = false;
+                for (AST::StmtAST* declaration : program->getDeclarations()) {
+                    if (auto bruh = AST::dyn_cast<AST::BruhAST>(declaration)) {
+                        function = &types.functions.find(bruh->getName())->second;
+                        visitBody(bruh->getBody());
+                    } else {
+                        function = &types.main;
+                        visit(declaration);
+                    }
+                }
+            } while (changed);
+
+            finish(types.main, nullptr);
+            for (auto& [name, functionTypes] : types.functions) {
+                finish(functionTypes, bruhs.find(name)->second);
+            }
+        }
+
+        ValueType visitNumber(AST::NumberExprAST* expr) {
+            return expr->isFloatingPoint() ? ValueType::Double : ValueType::Int;
+        }
+
+        ValueType visitString(AST::StringExprAST*) {
+            return ValueType::String;
+        }
+
+        ValueType visitVariable(AST::VariableExprAST* expr) {
+            return visitName(expr->getName());
+        }
+
+        // As CodeGen computes them: comparisons and logic give truth
+        // values, / always divides as doubles, and other arithmetic is on
+        // integers unless a double is involved
+        ValueType visitBinary(AST::BinaryExprAST* expr) {
+            using AST::BinaryOp;
+            ValueType L = visit(expr->getLHS());
+            ValueType R = visit(expr->getRHS());
+            switch (expr->getOp()) {
+                case BinaryOp::Add:
+                    // Adding anything to a string appends it
+                    if (L == ValueType::String || R == ValueType::String) {
+                        return ValueType::String;
+                    }
+                    return L == ValueType::Double || R == ValueType::Double ? ValueType::Double : ValueType::Int;
+                case BinaryOp::Sub:
+                case BinaryOp::Mul:
+                case BinaryOp::Mod:
+                    if (L == ValueType::String || R == ValueType::String) {
+                        return ValueType::Unknown;
+                    }
+                    return L == ValueType::Double || R == ValueType::Double ? ValueType::Double : ValueType::Int;
+                case BinaryOp::Div:
+                    return ValueType::Double;
+                default:
+                    return ValueType::Bool;
+            }
+        }
+
+        ValueType visitUnary(AST::UnaryExprAST* expr) {
+            ValueType operand = visit(expr->getOperand());
+            return expr->getOp() == AST::UnaryOp::Not ? ValueType::Bool : operand;
+        }
+
+        ValueType visitCall(AST::CallExprAST* expr) {
+            if (expr->getCallee() == "squad") {
+                for (AST::ExprAST* arg : expr->getArgs()) {
+                    visit(arg);
+                }
+                ValueType& squad = function->squads[expr];
+                widen(squad, ValueType::Squad);
+                return squad;
+            }
+            if (isMinMax(types, expr->getCallee())) {
+                ValueType result = ValueType::Int;
+                for (AST::ExprAST* arg : expr->getArgs()) {
+                    ValueType type = visit(arg);
+                    if (!isNumber(type)) {
+                        result = ValueType::Unknown;
+                    } else if (type == ValueType::Double && result != ValueType::Unknown) {
+                        result = ValueType::Double;
+                    }
+                }
+                return result;
+            }
+            auto it = expr->getCallee() == "yap" ? types.functions.end() : types.functions.find(expr->getCallee());
+            if (it == types.functions.end()) {
+                for (AST::ExprAST* arg : expr->getArgs()) {
+                    visit(arg);
+                }
+                // yap evaluates to the printf count
+                return expr->getCallee() == "yap" ? ValueType::Int : ValueType::Unknown;
+            }
+
+            const AST::NodeList<std::string_view>& params = bruhs.find(expr->getCallee())->second->getParams();
+            for (size_t i = 0; i < expr->getArgs().size(); ++i) {
+                ValueType arg = visit(expr->getArgs()[i]);
+                if (i < params.size()) {
+                    store(it->second.variables[params[i]], expr->getArgs()[i], arg);
+                }
+            }
+            return it->second.result;
+        }
+
+        ValueType visitGrouping(AST::GroupingExprAST* expr) {
+            return visit(expr->getExpression());
+        }
+
+        ValueType visitAssign(AST::AssignExprAST* expr) {
+            ValueType value = visit(expr->getValue());
+            ValueType& variable = function->variables[expr->getName()];
+            store(variable, expr->getValue(), value);
+            return variable;
+        }
+
+        ValueType visitSquad(AST::SquadExprAST* expr) {
+            ValueType& squad = function->squads[expr];
+            widen(squad, ValueType::Squad);
+            for (AST::ExprAST* element : expr->getElements()) {
+                widen(squad, squadOf(visit(element)));
+            }
+            return squad;
+        }
+
+        ValueType visitIndex(AST::IndexExprAST* expr) {
+            visit(expr->getIndex());
+            return elementType(visitName(expr->getName()));
+        }
+
+        ValueType visitIndexAssign(AST::IndexAssignExprAST* expr) {
+            visit(expr->getIndex());
+            ValueType& variable = function->variables[expr->getName()];
+            widen(variable, squadOf(visit(expr->getValue())));
+            return elementType(variable);
+        }
+
+        ValueType visitLength(AST::LengthExprAST*) {
+            return ValueType::Int;
+        }
+
+        void visitYap(AST::YapStmtAST* stmt) {
+            for (AST::ExprAST* arg : stmt->getArgs()) {
+                visit(arg);
+            }
+        }
+
+        void visitSus(AST::SusStmtAST* stmt) {
+            visit(stmt->getCondition());
+            visitBody(stmt->getThenBlock());
+            visitBody(stmt->getElseBlock());
+        }
+
+        void visitBet(AST::BetStmtAST* stmt) {
+            if (stmt->getInit()) visit(stmt->getInit());
+            if (stmt->getCondition()) visit(stmt->getCondition());
+            visitBody(stmt->getBody());
+            if (stmt->getIncrement()) visit(stmt->getIncrement());
+        }
+
+        void visitBruh(AST::BruhAST*) {}
+        void visitSigma(AST::SigmaAST*) {}
+        void visitCook(AST::CookAST* cook) { visitBody(cook->getBody()); }
+        void visitExprStmt(AST::ExprStmtAST* stmt) { visit(stmt->getExpr()); }
+
+        void visitVarDecl(AST::VarDeclStmtAST* stmt) {
+            ValueType value = visit(stmt->getInitializer());
+            store(function->variables[stmt->getName()], stmt->getInitializer(), value);
+        }
+
+        void visitSolulu(AST::SoluluStmtAST* stmt) {
+            if (stmt->getValue()) {
+                store(function->result, stmt->getValue(), visit(stmt->getValue()));
+            }
+        }
+
+        void visitYoink(AST::YoinkStmtAST* stmt) {
+            visit(stmt->getIndex());
+            widen(function->variables[stmt->getName()], squadOf(visit(stmt->getValue())));
+        }
+
+        void visitYeet(AST::YeetStmtAST* stmt) {
+            visit(stmt->getIndex());
+        }
+
+    private:
+        ProgramTypes& types;
+        std::unordered_map<std::string_view, AST::BruhAST*> bruhs;
+        FunctionTypes* function = nullptr;
+        bool changed = false;
+
+        void visitBody(const AST::StmtList& body) {
+            for (AST::StmtAST* stmt : body) visit(stmt);
+        }
+
+        ValueType visitName(std::string_view name) {
+            auto it = function->variables.find(name);
+            return it == function->variables.end() ? ValueType::Unknown : it->second;
+        }
+
+        // Numbers only widen to numbers, strings to strings and squads to
+        // squads
+        void widen(ValueType& type, ValueType value) {
+            bool related = type == ValueType::Unknown || (isNumber(type) && isNumber(value)) ||
+                           (isSquad(type) && isSquad(value));
+            if (value != ValueType::Unknown && related && value > type) {
+                type = value;
+                changed = true;
+            }
+        }
+
+        // Where the squad an expression evaluates to is held, if anywhere
+        ValueType* placeOf(AST::ExprAST* expr) {
+            if (auto variable = AST::dyn_cast<AST::VariableExprAST>(expr)) {
+                auto it = function->variables.find(variable->getName());
+                return it == function->variables.end() ? nullptr : &it->second;
+            }
+            if (auto assign = AST::dyn_cast<AST::AssignExprAST>(expr)) {
+                return &function->variables[assign->getName()];
+            }
+            if (auto grouping = AST::dyn_cast<AST::GroupingExprAST>(expr)) {
+                return placeOf(grouping->getExpression());
+            }
+            if (auto call = AST::dyn_cast<AST::CallExprAST>(expr)) {
+                if (call->getCallee() == "squad") {
+                    return &function->squads[expr];
+                }
+                auto it = types.functions.find(call->getCallee());
+                return it == types.functions.end() ? nullptr : &it->second.result;
+            }
+            if (AST::isa<AST::SquadExprAST>(expr)) {
+                return &function->squads[expr];
+            }
+            return nullptr;
+        }
+
+        // Stores the value of expr in target. A stored squad is shared, so
+        // its type also widens wherever it came from.
+        void store(ValueType& target, AST::ExprAST* expr, ValueType value) {
+            widen(target, value);
+            if (isSquad(target)) {
+                if (ValueType* place = placeOf(expr)) {
+                    widen(*place, target);
+                }
+            }
+        }
+
+        // What nothing was stored in is an integer 0, and a squad nothing
+        // was stored in holds integers
+        static void finish(FunctionTypes& function, AST::BruhAST* bruh) {
+            auto settle = [](ValueType& type) {
+                if (type == ValueType::Unknown) type = ValueType::Int;
+                if (type == ValueType::Squad) type = ValueType::IntSquad;
+            };
+            settle(function.result);
+            for (auto& [name, type] : function.variables) {
+                settle(type);
+            }
+            for (auto& [expr, type] : function.squads) {
+                settle(type);
+            }
+            if (bruh) {
+                for (std::string_view param : bruh->getParams()) {
+                    function.params.push_back(function.variables.find(param)->second);
+                }
+            }
+        }
+    };
+}
+
+ProgramTypes inferTypes(AST::ProgramAST* program) {
+    ProgramTypes types;
+    Inference(types).run(program);
+    return types;
+}
@@ -0,0 +1,227 @@
+#include "vm.h"
+#include "brainrot_rt.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+// Label addresses are a GNU extension; -DVM_SWITCH_DISPATCH forces the
+// portable switch
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(VM_SWITCH_DISPATCH)
+#define VM_THREADED_DISPATCH 1
+#endif
+
+VM::VM(const Bytecode& bytecode) : bytecode(bytecode) {
+    for (const std::string& string : bytecode.strings) {
+        strings.push_back(brainrot_string_constant(string.data(), static_cast<int64_t>(string.size())));
+    }
+}
+
+int VM::run() {
+    // Same banner as CodeGen::runMain; the program's output goes through
+    // the runtime like the compiled code's does
+    std::printf("Executing main function...\n");
+    std::fflush(stdout);
+    int result = static_cast<int32_t>(execute());
+    brainrot_flush();
+    std::printf("Program finished with code: %d\n", result);
+    std::fflush(stdout);
+    return result;
+}
+
+// Sets up the frame of a call at base: the arguments (which a tail call
+// may pass from inside the same frame), cleared variables and the
+// constants. Returns the frame, since growing the stack moves it.
+VM::Slot* VM::enter(uint32_t index, size_t base, size_t arguments) {
+    const BytecodeFunction& function = bytecode.functions[index];
+    size_t top = base + function.registers;
+    if (top > UINT32_MAX) {
+        throw std::runtime_error("Stack overflow");
+    }
+    if (top > registers.size()) {
+        registers.resize(std::max(top, registers.size() * 2));
+    }
+    Slot* frame = registers.data() + base;
+    std::memmove(frame, registers.data() + arguments, function.params * sizeof(Slot));
+    std::memset(frame + function.params, 0, (function.variables - function.params) * sizeof(Slot));
+    std::memcpy(frame + function.variables, function.constants.data(), function.constants.size() * sizeof(Slot));
+    return frame;
+}
+
+double VM::execute() {
+    const uint32_t* code = bytecode.code.data();
+    const BytecodeFunction* functions = bytecode.functions.data();
+    auto current = static_cast<uint32_t>(bytecode.functions.size() - 1);
+    uint32_t base = 0;
+    registers.assign(functions[current].registers, Slot{});
+    frames.clear();
+    Slot* r = enter(current, 0, 0);
+    const uint32_t* pc = code + functions[current].entry;
+    int64_t printed = 0;
+
+#ifdef VM_THREADED_DISPATCH
+    static const void* const dispatchTable[] = {
+#define BYTECODE_OP(name, operands) &&op_##name,
+        BYTECODE_OPS(BYTECODE_OP)
+#undef BYTECODE_OP
+    };
+#define CASE(name) op_##name:
+#define DISPATCH() goto* dispatchTable[*pc]
+    DISPATCH();
+#else
+#define CASE(name) case Op::name:
+#define DISPATCH() continue
+    for (;;) {
+    switch (static_cast<Op>(*pc)) {
+#endif
+
+    CASE(Move) r[pc[1]] = r[pc[2]]; pc += 3; DISPATCH();
+
+    // Integer arithmetic wraps, as LLVM's add, sub and mul do
+#define INT_ARITHMETIC(name, op)                                                           \
+    CASE(name) r[pc[1]].i = static_cast<int64_t>(uint64_t(r[pc[2]].i) op uint64_t(r[pc[3]].i)); \
+    pc += 4;                                                                               \
+    DISPATCH();
+    INT_ARITHMETIC(AddI, +)
+    INT_ARITHMETIC(SubI, -)
+    INT_ARITHMETIC(MulI, *)
+#undef INT_ARITHMETIC
+
+    CASE(ModI) {
+        int64_t divisor = r[pc[3]].i;
+        if (divisor == 0) {
+            throw std::runtime_error("Division by zero");
+        }
+        r[pc[1]].i = divisor == -1 ? 0 : r[pc[2]].i % divisor;
+        pc += 4;
+    }
+    DISPATCH();
+
+#define DOUBLE_ARITHMETIC(name, op)                   \
+    CASE(name) r[pc[1]].d = r[pc[2]].d op r[pc[3]].d; \
+    pc += 4;                                          \
+    DISPATCH();
+    DOUBLE_ARITHMETIC(AddD, +)
+    DOUBLE_ARITHMETIC(SubD, -)
+    DOUBLE_ARITHMETIC(MulD, *)
+    DOUBLE_ARITHMETIC(DivD, /)
+#undef DOUBLE_ARITHMETIC
+
+    CASE(ModD) r[pc[1]].d = std::fmod(r[pc[2]].d, r[pc[3]].d); pc += 4; DISPATCH();
+    CASE(IntToDouble) r[pc[1]].d = static_cast<double>(r[pc[2]].i); pc += 3; DISPATCH();
+    CASE(NegI) r[pc[1]].i = static_cast<int64_t>(0 - uint64_t(r[pc[2]].i)); pc += 3; DISPATCH();
+    CASE(NegD) r[pc[1]].d = -r[pc[2]].d; pc += 3; DISPATCH();
+    CASE(Not) r[pc[1]].i = !r[pc[2]].i; pc += 3; DISPATCH();
+    CASE(IntToBool) r[pc[1]].i = r[pc[2]].i != 0; pc += 3; DISPATCH();
+    CASE(DoubleToBool) r[pc[1]].i = r[pc[2]].d != 0.0 && !std::isnan(r[pc[2]].d); pc += 3; DISPATCH();
+
+    // Each comparison with its fused branches, on integers and doubles
+#define COMPARISON(name, op)                                                                   \
+    CASE(name##I) r[pc[1]].i = r[pc[2]].i op r[pc[3]].i; pc += 4; DISPATCH();                  \
+    CASE(name##D) r[pc[1]].i = r[pc[2]].d op r[pc[3]].d; pc += 4; DISPATCH();                  \
+    CASE(Jump##name##I) pc = r[pc[1]].i op r[pc[2]].i ? code + pc[3] : pc + 4; DISPATCH();     \
+    CASE(Jump##name##D) pc = r[pc[1]].d op r[pc[2]].d ? code + pc[3] : pc + 4; DISPATCH();     \
+    CASE(JumpNot##name##I) pc = r[pc[1]].i op r[pc[2]].i ? pc + 4 : code + pc[3]; DISPATCH();  \
+    CASE(JumpNot##name##D) pc = r[pc[1]].d op r[pc[2]].d ? pc + 4 : code + pc[3]; DISPATCH();  \
+    CASE(AddJump##name##I) {                                                                   \
+        Slot& counter = r[pc[1]];                                                              \
+        counter.i = static_cast<int64_t>(uint64_t(counter.i) + uint64_t(r[pc[2]].i));          \
+        pc = counter.i op r[pc[3]].i ? code + pc[4] : pc + 5;                                  \
+    }                                                                                          \
+    DISPATCH();                                                                                \
+    CASE(AddJump##name##D) {                                                                   \
+        Slot& counter = r[pc[1]];                                                              \
+        counter.d += r[pc[2]].d;                                                               \
+        pc = counter.d op r[pc[3]].d ? code + pc[4] : pc + 5;                                  \
+    }                                                                                          \
+    DISPATCH();
+    COMPARISON(Lt, <)
+    COMPARISON(Le, <=)
+    COMPARISON(Gt, >)
+    COMPARISON(Ge, >=)
+    COMPARISON(Eq, ==)
+    COMPARISON(Ne, !=)
+#undef COMPARISON
+
+    CASE(Jump) pc = code + pc[1]; DISPATCH();
+    CASE(JumpIfTrue) pc = r[pc[1]].i ? code + pc[2] : pc + 3; DISPATCH();
+    CASE(JumpIfFalse) pc = r[pc[1]].i ? pc + 3 : code + pc[2]; DISPATCH();
+
+    CASE(Call) {
+        if (frames.size() == maxFrames) {
+            throw std::runtime_error("Stack overflow");
+        }
+        uint32_t callee = pc[2];
+        size_t calleeBase = size_t(base) + functions[current].registers;
+        frames.push_back({current, base, static_cast<uint32_t>(pc + 4 - code), pc[1]});
+        r = enter(callee, calleeBase, size_t(base) + pc[3]);
+        base = static_cast<uint32_t>(calleeBase);
+        current = callee;
+        pc = code + functions[callee].entry;
+    }
+    DISPATCH();
+
+    CASE(TailCall) {
+        uint32_t callee = pc[1];
+        r = enter(callee, base, size_t(base) + pc[2]);
+        current = callee;
+        pc = code + functions[callee].entry;
+    }
+    DISPATCH();
+
+    CASE(Return) {
+        Slot value = r[pc[1]];
+        if (frames.empty()) {
+            return value.d;  // main returns a double
+        }
+        Frame frame = frames.back();
+        frames.pop_back();
+        current = frame.function;
+        base = frame.base;
+        r = registers.data() + base;
+        r[frame.dst] = value;
+        pc = code + frame.returnPc;
+    }
+    DISPATCH();
+
+    CASE(PrintString) {
+        const std::string& string = bytecode.strings[pc[1]];
+        printed += brainrot_print_string(string.data(), static_cast<int64_t>(string.size()));
+        pc += 2;
+    }
+    DISPATCH();
+    CASE(PrintInt) printed += brainrot_print_int(r[pc[1]].i); pc += 2; DISPATCH();
+    CASE(PrintDouble) printed += brainrot_print_double(r[pc[1]].d); pc += 2; DISPATCH();
+    CASE(PrintFloat) printed += brainrot_print_double(r[pc[1]].d); pc += 2; DISPATCH();
+    CASE(PrintNewline) printed += brainrot_print_string("\n", 1); pc += 1; DISPATCH();
+    CASE(TakePrinted) r[pc[1]].i = printed; printed = 0; pc += 2; DISPATCH();
+
+    // Elements are raw 64-bit cells, read and written through .i
+    CASE(NewSquad) r[pc[1]].s = newSquad(r[pc[2]].i); pc += 3; DISPATCH();
+    CASE(SquadGet) r[pc[1]].i = static_cast<int64_t>(squadElement(r[pc[2]].s, r[pc[3]].i)); pc += 4; DISPATCH();
+    CASE(SquadSet) squadElement(r[pc[1]].s, r[pc[2]].i) = static_cast<uint64_t>(r[pc[3]].i); pc += 4; DISPATCH();
+    CASE(SquadLength) r[pc[1]].i = r[pc[2]].s->length; pc += 3; DISPATCH();
+    CASE(SquadInsert) squadInsert(r[pc[1]].s, r[pc[2]].i, static_cast<uint64_t>(r[pc[3]].i)); pc += 4; DISPATCH();
+    CASE(SquadRemove) squadRemove(r[pc[1]].s, r[pc[2]].i); pc += 3; DISPATCH();
+    CASE(DoubleToInt) r[pc[1]].i = static_cast<int64_t>(r[pc[2]].d); pc += 3; DISPATCH();
+
+    CASE(LoadString) r[pc[1]].w = strings[pc[2]]; pc += 3; DISPATCH();
+    CASE(PrintStr) printed += brainrot_print_str(r[pc[1]].w); pc += 2; DISPATCH();
+    CASE(ConcatS) r[pc[1]].w = brainrot_string_concat(r[pc[2]].w, r[pc[3]].w); pc += 4; DISPATCH();
+    CASE(IntToString) r[pc[1]].w = brainrot_string_from_int(r[pc[2]].i); pc += 3; DISPATCH();
+    CASE(DoubleToString) r[pc[1]].w = brainrot_string_from_double(r[pc[2]].d); pc += 3; DISPATCH();
+    CASE(CompareS) r[pc[1]].i = brainrot_string_compare(r[pc[2]].w, r[pc[3]].w); pc += 4; DISPATCH();
+    CASE(StringLength) r[pc[1]].i = brainrot_string_length(r[pc[2]].w); pc += 3; DISPATCH();
+
+#ifndef VM_THREADED_DISPATCH
+    case Op::Count: break;
+    }
+    break;
+    }
+#endif
+#undef CASE
+#undef DISPATCH
+    // Bytecode is verified before it runs, so no opcode leads here
+    throw std::runtime_error("Invalid bytecode");
+}